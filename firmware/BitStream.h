@@ -0,0 +1,117 @@
+#ifndef _BITSTREAM_H
+#define _BITSTREAM_H
+
+#include <stdint.h>
+
+/** Sequential bit access to byte buffers, with the bit order of the bytes as a compile-time policy
+ *  The cursor keeps the current byte in a register and shifts one bit out (or in) per access:
+ *  there is no index arithmetic, no variable shift and no order test in the per-bit path */
+namespace BitStream
+{
+
+  // Bit 0 of the stream is 0x80 of the first byte (radio FIFO data)
+  struct MsbFirst
+  {
+    static uint8_t take(uint8_t *cache)
+    {
+      uint8_t bit = *cache >> 7;
+      *cache <<= 1;
+      return bit;
+    }
+    static constexpr uint8_t put(uint8_t cache, uint8_t bit) { return (cache << 1) | bit; }
+    // Cache of a byte whose first n bits were already read
+    static constexpr uint8_t skip(uint8_t byte, uint8_t n) { return byte << n; }
+    // Cache of a byte whose first n bits are kept before writing
+    static constexpr uint8_t keep(uint8_t byte, uint8_t n) { return n == 0 ? 0 : byte >> (8 - n); }
+    // Byte of a partial cache of count bits, followed by the remaining bits of byte
+    static constexpr uint8_t merge(uint8_t cache, uint8_t count, uint8_t byte) { return (cache << (8 - count)) | (byte & (0xFF >> count)); }
+  };
+
+  // Bit 0 of the stream is 0x01 of the first byte (InOne packet data)
+  struct LsbFirst
+  {
+    static uint8_t take(uint8_t *cache)
+    {
+      uint8_t bit = *cache & 1;
+      *cache >>= 1;
+      return bit;
+    }
+    static constexpr uint8_t put(uint8_t cache, uint8_t bit) { return (cache >> 1) | (bit << 7); }
+    static constexpr uint8_t skip(uint8_t byte, uint8_t n) { return byte >> n; }
+    static constexpr uint8_t keep(uint8_t byte, uint8_t n) { return n == 0 ? 0 : byte << (8 - n); }
+    static constexpr uint8_t merge(uint8_t cache, uint8_t count, uint8_t byte) { return (cache >> (8 - count)) | (byte & (0xFF << count)); }
+  };
+
+  /** Reads bits from a buffer, starting at a bit offset. Bytes are only fetched when reached */
+  template <class Order>
+  class Reader
+  {
+  public:
+    constexpr Reader(const uint8_t *buffer, uint16_t bitOffset = 0) : m_next(buffer + (bitOffset >> 3) + ((bitOffset & 7) != 0)),
+                                                                    m_cache((bitOffset & 7) != 0 ? Order::skip(buffer[bitOffset >> 3], bitOffset & 7) : 0),
+                                                                    m_remaining((8 - (bitOffset & 7)) & 7)
+    {
+    }
+
+    uint8_t read()
+    {
+      if (this->m_remaining == 0)
+      {
+        this->m_cache = *this->m_next++;
+        this->m_remaining = 8;
+      }
+      this->m_remaining--;
+      return Order::take(&this->m_cache);
+    }
+
+  private:
+    const uint8_t *m_next;
+    uint8_t m_cache;
+    uint8_t m_remaining;
+  };
+
+  /** Writes bits to a buffer, starting at a bit offset
+   *  The bits of the buffer before the offset and after the last written bit are left unchanged, once flushed */
+  template <class Order>
+  class Writer
+  {
+  public:
+    constexpr Writer(uint8_t *buffer, uint16_t bitOffset = 0) : m_next(buffer + (bitOffset >> 3)),
+                                                              m_cache(Order::keep(buffer[bitOffset >> 3], bitOffset & 7)),
+                                                              m_count(bitOffset & 7)
+    {
+    }
+
+    void write(uint8_t bit)
+    {
+      this->m_cache = Order::put(this->m_cache, bit);
+      if (++this->m_count == 8)
+      {
+        *this->m_next++ = this->m_cache;
+        this->m_count = 0;
+      }
+    }
+
+    // Write the count low bits of value, most significant first
+    void write(uint32_t value, uint8_t count)
+    {
+      while (count-- != 0)
+        this->write((uint8_t)(value >> count) & 1);
+    }
+
+    // Store the last partial byte, must be called after the last write
+    void flush()
+    {
+      if (this->m_count != 0)
+        *this->m_next = Order::merge(this->m_cache, this->m_count, *this->m_next);
+    }
+
+  private:
+    uint8_t *m_next;
+    uint8_t m_cache;
+    uint8_t m_count;
+  };
+
+} // namespace BitStream
+
+#endif //_BITSTREAM_H
@@ -5,6 +5,7 @@
 
 #include <Arduino.h>
 #include "cc1101.h"
+#include "Stats.h"
 
 using namespace CC1101;
 
@@ -46,18 +47,25 @@ uint8_t spiTransfer(uint8_t outData)
 
 void spiWaitReady()
 {
-    while (digitalRead(MOSI_PIN) == 0)
+    // The CC1101 pulls SO low once its crystal oscillator is running
+    while (digitalRead(MISO_PIN) == 1)
         ;
 }
 
 /**** Helper class for SPI transactions ****/
 /* When instanciated, driver ssPin low and waits for the SPI bus to be ready */
 /* When going out of scope, releases the ssPin */
+/* Several radios may share the SPI bus, and be accessed both from the main loop and from
+ * their interrupt handlers: interrupts are masked for the duration of the transaction,
+ * so that a transaction is never interleaved with another one */
 class SpiTransaction
 {
 public:
     SpiTransaction(uint8_t ssPin)
     {
+        this->m_sreg = SREG;
+        cli();
+        STATS_SPI_TRANSACTION();
         this->m_ssPin = ssPin;
         digitalWrite(this->m_ssPin, LOW);
         spiWaitReady();
@@ -66,10 +74,12 @@ public:
     ~SpiTransaction()
     {
         digitalWrite(this->m_ssPin, HIGH);
+        SREG = this->m_sreg;
     }
 
 private:
     uint8_t m_ssPin;
+    uint8_t m_sreg;
 };
 
 /**** Radio class implementation ****/
@@ -97,6 +107,8 @@ Radio::Radio(uint8_t ssPin, uint8_t gdo0Pin, uint8_t gdo2Pin)
     this->m_ssPin = ssPin;
     this->m_gdo0Pin = gdo0Pin;
     this->m_gdo2Pin = gdo2Pin;
+    this->m_ccaBusyCount = 0;
+    this->m_ccaFailCount = 0;
 }
 
 bool Radio::begin()
@@ -191,8 +203,75 @@ void Radio::goTransmit()
 {
     this->goIdle();
     this->writeStrobe(StrobeCommand::STX);
-    while (this->getState() != ControlState::IDLE)
-        ;
+    this->waitEndOfTransmit();
+}
+
+/* Transmit the TX FIFO content only if nobody else is transmitting (listen-before-talk)
+ * MCSM1 must enable a CCA mode: the STX strobe is then ignored by the radio while in RX
+ * and the channel is busy. A randomized binary exponential backoff is applied between
+ * attempts. After c_ccaMaxAttempts the transmission is forced, so that a command is never lost.
+ * Returns false if the transmission had to be forced. */
+bool Radio::goTransmitWhenClear()
+{
+    uint8_t backoffWindow = 1;
+    for (uint8_t attempt = 0; attempt < c_ccaMaxAttempts; attempt++)
+    {
+        ControlState state = this->getState();
+        // A strobe accepted after c_ccaDecisionUs must not be aborted by going back to RX
+        if (state == ControlState::RXTX_SWITCH || state == ControlState::TX)
+        {
+            this->waitEndOfTransmit();
+            return true;
+        }
+        // Clear channel assessment is only performed when STX is strobed in RX state
+        if (state != ControlState::RX)
+            this->goReceive();
+        this->writeStrobe(StrobeCommand::STX);
+        // The radio goes through RXTX_SWITCH if the channel is clear, and stays in RX if it is busy
+        uint32_t start = micros();
+        do
+            state = this->getState();
+        while (state == ControlState::RX && micros() - start < c_ccaDecisionUs);
+        if (state != ControlState::RX)
+        {
+            this->waitEndOfTransmit();
+            return true;
+        }
+        // Channel is busy, wait for a random number of slots before trying again
+        this->m_ccaBusyCount++;
+        delay(c_ccaBackoffSlotMs * random(1, backoffWindow + 1));
+        backoffWindow <<= 1;
+    }
+    this->m_ccaFailCount++;
+    this->goTransmit();
+    return false;
+}
+
+bool Radio::isReceiving()
+{
+    // Carrier sense or sync word found bits of PKTSTATUS: a frame is being received
+    return (this->readStatus(StatusRegister::PKTSTATUS) & 0x48) != 0;
+}
+
+/* The RSSI is updated every few bit periods, so the samples are spaced by 1 ms */
+uint32_t Radio::readNoiseSeed()
+{
+    uint32_t seed = 0;
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        seed = (seed << 1 | seed >> 31) ^ this->readStatus(StatusRegister::RSSI);
+        delay(1);
+    }
+    return seed ^ micros();
+}
+
+void Radio::waitEndOfTransmit()
+{
+    // Depending on MCSM1 TXOFF_MODE, the radio goes either to IDLE or RX after transmitting
+    ControlState state;
+    do
+        state = this->getState();
+    while (state != ControlState::IDLE && state != ControlState::RX);
 }
 
 void Radio::readBurst(Register address, uint8_t *data, uint8_t length)
@@ -279,7 +358,7 @@ uint8_t Radio::_readRegister(uint8_t address)
     return spiTransfer(0xFF);
 }
 
-uint8_t Radio::_readBurst(uint8_t address, uint8_t *data, uint8_t length)
+void Radio::_readBurst(uint8_t address, uint8_t *data, uint8_t length)
 {
     SpiTransaction transaction(this->m_ssPin);
 
@@ -288,7 +367,7 @@ uint8_t Radio::_readBurst(uint8_t address, uint8_t *data, uint8_t length)
         data[i] = spiTransfer(0xFF);
 }
 
-uint8_t Radio::_writeBurst(uint8_t address, uint8_t *data, uint8_t length)
+void Radio::_writeBurst(uint8_t address, uint8_t *data, uint8_t length)
 {
     SpiTransaction transaction(this->m_ssPin);
 
@@ -171,6 +171,13 @@ namespace CC1101
         TXFIFO_UNDERFLOW = 0x16
     };
 
+    // Listen-before-talk: number of clear channel assessments before forcing the transmission
+    const uint8_t c_ccaMaxAttempts = 6;
+    // Listen-before-talk: backoff slot duration, the backoff window doubles after each busy assessment
+    const uint8_t c_ccaBackoffSlotMs = 4;
+    // Listen-before-talk: the radio leaves RX within this time once it accepts the STX strobe
+    const uint8_t c_ccaDecisionUs = 100;
+
     class Radio
     {
 
@@ -191,6 +198,13 @@ namespace CC1101
         void goIdle();
         void goReceive();
         void goTransmit();
+        bool goTransmitWhenClear();
+        bool isReceiving();
+        // Random bits from the RSSI noise floor, the radio must be in RX state
+        uint32_t readNoiseSeed();
+
+        uint16_t getCcaBusyCount() { return m_ccaBusyCount; };
+        uint16_t getCcaFailCount() { return m_ccaFailCount; };
 
         void readBurst(Register address, uint8_t *data, uint8_t length);
         void readConfiguration(Configuration *config);
@@ -212,10 +226,14 @@ namespace CC1101
         uint8_t m_ssPin;
         uint8_t m_gdo0Pin;
         uint8_t m_gdo2Pin;
+        uint16_t m_ccaBusyCount;
+        uint16_t m_ccaFailCount;
+
+        void waitEndOfTransmit();
 
         uint8_t _readRegister(uint8_t address);
-        uint8_t _readBurst(uint8_t address, uint8_t *data, uint8_t length);
-        uint8_t _writeBurst(uint8_t address, uint8_t *data, uint8_t length);
+        void _readBurst(uint8_t address, uint8_t *data, uint8_t length);
+        void _writeBurst(uint8_t address, uint8_t *data, uint8_t length);
     };
 
     int8_t rssiToDbm(uint8_t rawRssi);
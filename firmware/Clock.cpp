@@ -0,0 +1,37 @@
+#include "Clock.h"
+
+using namespace Clock;
+
+static uint32_t s_lastMicros = 0;
+static uint32_t s_rolloverCount = 0;
+
+Timestamp Clock::now()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint32_t us = micros();
+  if (us < s_lastMicros)
+    s_rolloverCount++;
+  s_lastMicros = us;
+  uint32_t rolloverCount = s_rolloverCount;
+  SREG = sreg;
+
+  return ((Timestamp)rolloverCount << 32) | us;
+}
+
+void Clock::print(Print *output, Timestamp time)
+{
+  uint32_t high = time >> 32;
+  uint32_t low = time;
+  if (high == 0)
+  {
+    output->print(low, HEX);
+    return;
+  }
+
+  output->print(high, HEX);
+  // Leading zeros of the low word
+  for (uint32_t digit = 0x10000000; digit > 1 && low < digit; digit >>= 4)
+    output->print('0');
+  output->print(low, HEX);
+}
@@ -0,0 +1,30 @@
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+#include <Arduino.h>
+
+namespace Clock
+{
+
+  // Microseconds since startup, micros() extended with a rollover count
+  typedef uint64_t Timestamp;
+
+  /** Read the extended clock, safe to call from an interrupt handler
+   *  The rollover of micros() is detected on the next call: it must be called at least once every 71 minutes */
+  Timestamp now();
+
+  // Times of a received packet, carried on its serial line
+  struct PacketTimes
+  {
+    // Radio interrupt which started the frame
+    Timestamp received;
+    // Packet validated and ready to be printed
+    Timestamp decoded;
+  };
+
+  // Print a timestamp in hexadecimal, without leading zeros
+  void print(Print *output, Timestamp time);
+
+} // namespace Clock
+
+#endif //_CLOCK_H
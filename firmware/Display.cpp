@@ -0,0 +1,74 @@
+#include "Display.h"
+
+using namespace Display;
+
+static const uint8_t c_size = c_rows * c_columns;
+
+Framebuffer::Framebuffer(LiquidCrystal *lcd) : m_lcd(lcd),
+                                               m_column(0),
+                                               m_row(0),
+                                               m_lcdPosition(c_size)
+{
+}
+
+void Framebuffer::begin()
+{
+  this->m_lcd->begin(c_columns, c_rows);
+  this->clear();
+  // The LCD is cleared by begin()
+  memset(this->m_shown, ' ', c_size);
+  this->m_lcdPosition = 0;
+}
+
+void Framebuffer::clear()
+{
+  memset(this->m_frame, ' ', c_size);
+  this->m_column = 0;
+  this->m_row = 0;
+}
+
+void Framebuffer::setCursor(uint8_t column, uint8_t row)
+{
+  this->m_column = column;
+  this->m_row = row < c_rows ? row : c_rows - 1;
+}
+
+size_t Framebuffer::write(uint8_t c)
+{
+  if (c < ' ')
+    return 0;
+  if (this->m_column >= c_columns)
+    return 0;
+  this->m_frame[this->m_row][this->m_column++] = c;
+  return 1;
+}
+
+bool Framebuffer::flushNext()
+{
+  char *frame = &this->m_frame[0][0];
+  char *shown = &this->m_shown[0][0];
+
+  // Scan from the LCD address counter, so that consecutive changes need no cursor move
+  uint8_t start = this->m_lcdPosition < c_size ? this->m_lcdPosition : 0;
+  uint8_t position = start;
+  while (frame[position] == shown[position])
+  {
+    position = (position + 1) % c_size;
+    if (position == start)
+      return false;
+  }
+
+  if (position != this->m_lcdPosition)
+    this->m_lcd->setCursor(position % c_columns, position / c_columns);
+  this->m_lcd->write(frame[position]);
+  shown[position] = frame[position];
+  // The HD44780 address counter does not wrap from the end of a row to the start of the next one
+  this->m_lcdPosition = (position + 1) % c_columns != 0 ? position + 1 : c_size;
+  return true;
+}
+
+void Framebuffer::invalidate()
+{
+  // No character is shown as 0, which cannot be printed to the frame
+  memset(this->m_shown, 0, c_size);
+}
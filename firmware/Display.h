@@ -0,0 +1,48 @@
+#ifndef _DISPLAY_H
+#define _DISPLAY_H
+
+#include <Arduino.h>
+#include <LiquidCrystal.h>
+
+namespace Display
+{
+
+  const uint8_t c_columns = 16;
+  const uint8_t c_rows = 2;
+
+  /** Character framebuffer of a HD44780 LCD
+   *  Printing only updates the frame in RAM. Each LCD write busy-waits on the controller, so the frame is
+   *  copied one character at a time by flushNext(), and only where it differs from what the LCD shows */
+  class Framebuffer : public Print
+  {
+  public:
+    Framebuffer(LiquidCrystal *lcd);
+
+    // Initialize and clear the LCD, which takes a few ms
+    void begin();
+
+    // Fill the frame with spaces and move the cursor home
+    void clear();
+    void setCursor(uint8_t column, uint8_t row);
+    // Characters past the end of the row are dropped, as are control characters
+    size_t write(uint8_t c);
+    using Print::write;
+
+    // Write the next differing character to the LCD. Returns false if the LCD is up to date
+    bool flushNext();
+    // Redraw the whole frame, in case the LCD content was corrupted
+    void invalidate();
+
+  private:
+    LiquidCrystal *m_lcd;
+    char m_frame[c_rows][c_columns];
+    char m_shown[c_rows][c_columns];
+    uint8_t m_column;
+    uint8_t m_row;
+    // LCD address counter, as a position in the frame. c_rows * c_columns when unknown
+    uint8_t m_lcdPosition;
+  };
+
+} // namespace Display
+
+#endif //_DISPLAY_H
@@ -0,0 +1,31 @@
+#ifndef _IDEO_H
+#define _IDEO_H
+
+#include <stdint.h>
+
+namespace Ideo
+{
+
+  // device, command and params are the over-the-air fields (10 bytes)
+  // channel is the sync channel (SYNC0) of the unit the packet is sent to / received from
+  struct TxPacketData
+  {
+    char device;
+    uint8_t command;
+    char params[8];
+    uint8_t channel;
+  };
+
+  struct RxPacketData
+  {
+    char device;
+    uint8_t command;
+    char params[8];
+    int8_t rssi;
+    uint8_t lqi;
+    uint8_t channel;
+  };
+
+} // namespace Ideo
+
+#endif //_IDEO_H
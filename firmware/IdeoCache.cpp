@@ -0,0 +1,128 @@
+#include <Arduino.h>
+#include "IdeoCache.h"
+
+using namespace Ideo;
+
+// Commands that only read the unit state, and whose response can be cached
+static const uint8_t cacheableCommands[] = {0x31, 0x32, 0x33};
+static const char emptyParams[] PROGMEM = "00000000";
+
+ResponseCache::ResponseCache() : m_ttl(c_defaultCacheTtl),
+                                 m_maxAge(c_defaultCacheMaxAge)
+{
+  this->invalidate();
+}
+
+bool ResponseCache::isCacheable(const TxPacketData *tx)
+{
+  if (memcmp_P(tx->params, emptyParams, 8) != 0)
+    return false;
+  for (uint8_t i = 0; i < sizeof(cacheableCommands); i++)
+    if (tx->command == cacheableCommands[i])
+      return true;
+  return false;
+}
+
+CacheState ResponseCache::lookup(const TxPacketData *tx, RxPacketData *rx)
+{
+  Entry *entry = this->find(tx->device, tx->command);
+  if (entry == NULL)
+    return CacheState::Missing;
+
+  uint32_t age = millis() - entry->time;
+  if (age > this->m_maxAge)
+  {
+    entry->isValid = false;
+    return CacheState::Missing;
+  }
+
+  memcpy(rx, &entry->packet, sizeof(RxPacketData));
+  if (age > this->m_ttl)
+  {
+    entry->isRefreshPending = true;
+    return CacheState::Stale;
+  }
+  return CacheState::Fresh;
+}
+
+void ResponseCache::store(const RxPacketData *rx)
+{
+  TxPacketData query;
+  query.device = rx->device;
+  query.command = rx->command;
+  memcpy_P(query.params, emptyParams, 8);
+  // Only keep actual answers to query commands
+  if (!isCacheable(&query) || memcmp_P(rx->params, emptyParams, 8) == 0)
+    return;
+
+  Entry *entry = this->find(rx->device, rx->command);
+  if (entry == NULL)
+  {
+    // Use a free entry, or evict the oldest one
+    entry = &this->m_entries[0];
+    for (uint8_t i = 0; i < c_cacheSize && entry->isValid; i++)
+    {
+      if (!this->m_entries[i].isValid || this->m_entries[i].time - entry->time > 0x80000000UL)
+        entry = &this->m_entries[i];
+    }
+  }
+  memcpy(&entry->packet, rx, sizeof(RxPacketData));
+  entry->time = millis();
+  entry->refreshTime = entry->time;
+  entry->isValid = true;
+  entry->isRefreshPending = false;
+}
+
+void ResponseCache::invalidate()
+{
+  for (uint8_t i = 0; i < c_cacheSize; i++)
+  {
+    this->m_entries[i].isValid = false;
+    this->m_entries[i].isRefreshPending = false;
+  }
+}
+
+/* Get the next entry to be refreshed: either requested by the host while stale, or past its TTL
+ * A unit which does not answer is asked again once per TTL, until its response is older than the max age */
+bool ResponseCache::nextRefresh(TxPacketData *tx)
+{
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < c_cacheSize; i++)
+  {
+    Entry *entry = &this->m_entries[i];
+    if (!entry->isValid)
+      continue;
+    if (now - entry->time > this->m_maxAge)
+    {
+      entry->isValid = false;
+      continue;
+    }
+    if ((entry->isRefreshPending || now - entry->time > this->m_ttl) && now - entry->refreshTime > this->m_ttl)
+    {
+      entry->refreshTime = now;
+      entry->isRefreshPending = false;
+      tx->device = entry->packet.device;
+      tx->command = entry->packet.command;
+      memcpy_P(tx->params, emptyParams, 8);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ResponseCache::setTtl(uint32_t ttl, uint32_t maxAge)
+{
+  this->m_ttl = ttl;
+  this->m_maxAge = maxAge;
+}
+
+ResponseCache::Entry *ResponseCache::find(char device, uint8_t command)
+{
+  for (uint8_t i = 0; i < c_cacheSize; i++)
+  {
+    Entry *entry = &this->m_entries[i];
+    if (entry->isValid && entry->packet.device == device && entry->packet.command == command)
+      return entry;
+  }
+  return NULL;
+}
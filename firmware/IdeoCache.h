@@ -0,0 +1,59 @@
+#ifndef _IDEOCACHE_H
+#define _IDEOCACHE_H
+
+#include "Ideo.h"
+
+namespace Ideo
+{
+
+  // One entry per query command
+  const uint8_t c_cacheSize = 3;
+  // Responses younger than this are served without any RF exchange
+  const uint32_t c_defaultCacheTtl = 30000;
+  // Older responses are still served, but refreshed in the background. Past this age they are dropped
+  const uint32_t c_defaultCacheMaxAge = 300000;
+
+  enum class CacheState : uint8_t
+  {
+    Missing,
+    Fresh,
+    Stale
+  };
+
+  /** Last responses of a unit to the Ideo query commands (temperatures, status)
+   *  Stale entries are served immediately and refreshed in the background */
+  class ResponseCache
+  {
+  public:
+    ResponseCache();
+
+    static bool isCacheable(const TxPacketData *tx);
+
+    CacheState lookup(const TxPacketData *tx, RxPacketData *rx);
+    void store(const RxPacketData *rx);
+    void invalidate();
+    bool nextRefresh(TxPacketData *tx);
+
+    void setTtl(uint32_t ttl, uint32_t maxAge);
+
+  private:
+    struct Entry
+    {
+      RxPacketData packet;
+      // Time of the response, and of the last refresh request
+      uint32_t time;
+      uint32_t refreshTime;
+      bool isValid;
+      bool isRefreshPending;
+    };
+
+    Entry *find(char device, uint8_t command);
+
+    Entry m_entries[c_cacheSize];
+    uint32_t m_ttl;
+    uint32_t m_maxAge;
+  };
+
+} // namespace Ideo
+
+#endif //_IDEOCACHE_H
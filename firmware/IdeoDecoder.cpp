@@ -0,0 +1,73 @@
+#include <Arduino.h>
+#include "IdeoDecoder.h"
+#include "IdeoManager.h"
+#include "IdeoSerial.h"
+#include "SerialLine.h"
+
+using namespace Ideo;
+using SerialLine::packetOutput;
+
+// Responses known to the decoder, stored in flash
+static constexpr CommandLayout commandLayouts[] PROGMEM = {
+    // Inside air temperatures: inlet, outlet
+    {0x31, 'I', 2, {{16, 16, FieldType::Tenths}, {0, 16, FieldType::Tenths}}},
+    // Outside air temperatures: inlet, outlet
+    {0x32, 'O', 2, {{16, 16, FieldType::Tenths}, {0, 16, FieldType::Tenths}}},
+    // Status: airflow state, bypass state
+    {0x33, 'S', 2, {{16, 4, FieldType::Enum}, {12, 4, FieldType::Enum}}},
+};
+
+bool Decoder::findLayout(uint8_t command, CommandLayout *layout)
+{
+  for (uint8_t i = 0; i < sizeof(commandLayouts) / sizeof(CommandLayout); i++)
+  {
+    if (pgm_read_byte(&commandLayouts[i].command) == command)
+    {
+      memcpy_P(layout, &commandLayouts[i], sizeof(CommandLayout));
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Decoder::isEmptyResponse(const RxPacketData *rx)
+{
+  for (uint8_t i = 0; i < 8; i++)
+    if (rx->params[i] != '0')
+      return false;
+  return true;
+}
+
+uint32_t Decoder::parseParams(const char *params)
+{
+  return (uint32_t)parseUint16(params) << 16 | parseUint16(&params[4]);
+}
+
+int32_t Decoder::decodeField(uint32_t params, const Field *field)
+{
+  uint32_t value = (params >> field->shift) & ((1UL << field->width) - 1);
+  // Fixed-point values are two's complement
+  if (field->type == FieldType::Tenths && (value & (1UL << (field->width - 1))))
+    return (int32_t)value - (int32_t)(1UL << field->width);
+  return value;
+}
+
+/* Print the typed record of a response, returns false if the command has no known layout */
+bool Decoder::print(const RxPacketData *rx)
+{
+  CommandLayout layout;
+  if (!findLayout(rx->command, &layout))
+    return false;
+
+  uint32_t params = parseParams(rx->params);
+  packetOutput.print(c_typedRecordMarker);
+  packetOutput.print(layout.tag);
+  packetOutput.print(',');
+  SerialParser::printDevice(rx);
+  for (uint8_t i = 0; i < layout.fieldCount; i++)
+  {
+    packetOutput.print(',');
+    packetOutput.print(decodeField(params, &layout.fields[i]));
+  }
+  return true;
+}
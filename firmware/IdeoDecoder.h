@@ -0,0 +1,49 @@
+#ifndef _IDEODECODER_H
+#define _IDEODECODER_H
+
+#include "Ideo.h"
+
+namespace Ideo
+{
+
+  enum class FieldType : uint8_t
+  {
+    Tenths,   // Signed fixed-point value, in tenths (temperatures in 0.1 degC)
+    Enum,     // State value, mapped to an enum by the host
+    Unsigned, // Plain unsigned value
+  };
+
+  struct Field
+  {
+    uint8_t shift;
+    uint8_t width;
+    FieldType type;
+  };
+
+  const uint8_t c_maxFieldCount = 2;
+  // First character of a typed record, raw records start with the device ID
+  const char c_typedRecordMarker = '#';
+
+  /** Layout of the params of a command response
+   *  Decoded responses are output as "#<tag>,<device>[@<channel>],<field>[,<field>]" */
+  struct CommandLayout
+  {
+    uint8_t command;
+    char tag;
+    uint8_t fieldCount;
+    Field fields[c_maxFieldCount];
+  };
+
+  class Decoder
+  {
+  public:
+    static bool findLayout(uint8_t command, CommandLayout *layout);
+    static bool isEmptyResponse(const RxPacketData *rx);
+    static uint32_t parseParams(const char *params);
+    static int32_t decodeField(uint32_t params, const Field *field);
+    static bool print(const RxPacketData *rx);
+  };
+
+} // namespace Ideo
+
+#endif //_IDEODECODER_H
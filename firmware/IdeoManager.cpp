@@ -1,7 +1,11 @@
 #include <Arduino.h>
 #include "IdeoManager.h"
+#include "IdeoSerial.h"
+#include "SerialLine.h"
 
 using namespace Ideo;
+using SerialLine::packetOutput;
+using SerialLine::debugOutput;
 
 // Rf settings for CC1101
 CC1101::Configuration ideoRfSettings = {
@@ -37,11 +41,13 @@ CC1101::Configuration ideoRfSettings = {
     // Set deviation to 76.171875kHz (req: 75kHz)
     0x54, // DEVIATN       Modem Deviation Setting
     0x07, // MCSM2         Main Radio Control State Machine Configuration
-    0x0F, // MCSM1         Main Radio Control State Machine Configuration
+    // CCA mode: clear if RSSI below threshold unless currently receiving a packet
+    0x3F, // MCSM1         Main Radio Control State Machine Configuration
     0x18, // MCSM0         Main Radio Control State Machine Configuration
     0x16, // FOCCFG        Frequency Offset Compensation Configuration
     0x6C, // BSCFG         Bit Synchronization Configuration
     0x07, // AGCCTRL2      AGC Control
+    // Carrier sense: relative threshold off, absolute threshold at MAGN_TARGET (CCA busy above it)
     0x40, // AGCCTRL1      AGC Control
     0x91, // AGCCTRL0      AGC Control
     0x87, // WOREVT1       High Byte Event0 Timeout
@@ -85,7 +91,7 @@ struct RawRxPacket
   uint8_t lqi;
 };
 
-static const char nibbleLut[] = "0123456789ABCDEF";
+static const char nibbleLut[] PROGMEM = "0123456789ABCDEF";
 
 uint16_t computeChecksum(const RawPacket *pkt)
 {
@@ -96,16 +102,25 @@ uint16_t computeChecksum(const RawPacket *pkt)
   chk += pkt->command;
   for (uint8_t i = 0; i < 8; i++)
     chk += pkt->params[i];
-  return (nibbleLut[chk >> 4]) | (nibbleLut[chk & 0xF] << 8);
+  return pgm_read_byte(&nibbleLut[chk >> 4]) | (pgm_read_byte(&nibbleLut[chk & 0xF]) << 8);
 }
 
-Manager::Manager(uint8_t ssPin, uint8_t irqPin) : m_radio(ssPin, 255, irqPin), // Not using GDO0
-                                                  m_commandResponseTimeout(250)
+Manager::Manager(uint8_t ssPin, uint8_t irqPin) : Protocol::Manager(irqPin, c_serialChannel),
+                                                  m_radio(ssPin, 255, irqPin), // Not using GDO0
+                                                  m_commandResponseTimeout(c_defaultUnitTimeout),
+                                                  m_channel(0),
+                                                  m_unitCount(0),
+                                                  m_pollIndex(0),
+                                                  m_refreshUnit(NULL),
+                                                  m_refreshTime(0),
+                                                  m_cacheTtl(c_defaultCacheTtl),
+                                                  m_cacheMaxAge(c_defaultCacheMaxAge)
 {
 }
 
 void Manager::begin(uint8_t channel)
 {
+  this->m_channel = channel;
   // Initialize CC1101 module
   this->m_radio.begin();
   this->m_radio.writeConfiguration(&ideoRfSettings);
@@ -123,6 +138,7 @@ void Manager::getLastPacket(RxPacketData *packet)
 
 void Manager::rfRxCallback()
 {
+  Clock::Timestamp received = Clock::now();
   RawRxPacket rxPacket;
   this->m_radio.readRxFifo((uint8_t *)&rxPacket, sizeof(RawRxPacket));
 
@@ -134,6 +150,9 @@ void Manager::rfRxCallback()
     memcpy(&this->m_lastRxPacket, &rxPacket.device, 10);
     this->m_lastRxPacket.rssi = CC1101::rssiToDbm(rxPacket.rssi);
     this->m_lastRxPacket.lqi = rxPacket.lqi & 0x7F;
+    this->m_lastRxPacket.channel = this->m_channel;
+    this->m_lastPacketTimes.received = received;
+    this->m_lastPacketTimes.decoded = Clock::now();
   }
 
   if (this->m_radio.isRxOverflow())
@@ -155,12 +174,279 @@ void Manager::sendPacket(TxPacketData *packet)
 
   this->m_radio.writeTxFifo((uint8_t *)&txPacket, sizeof(RawPacket));
 
-  this->m_radio.writeStrobe(CC1101::StrobeCommand::STX);
-
   // Radio goes automatically in RX mode after transmitting
   // Ensure we have finished transmitting before returning
-  while (this->m_radio.getState() != CC1101::ControlState::RX)
-    ;
+  SerialLine::holdInput();
+  this->m_radio.goTransmitWhenClear();
+  SerialLine::releaseInput();
+}
+
+void Manager::printLastPacket()
+{
+  RxPacketData rxPacket;
+  this->getLastPacket(&rxPacket);
+  if (this->completeRefresh(&rxPacket))
+    return;
+  Unit *unit = this->findUnit(rxPacket.channel, rxPacket.device);
+  if (unit != NULL)
+    unit->cache.store(&rxPacket);
+  this->printSerialPrefix();
+  SerialParser::printDevice(&rxPacket);
+  packetOutput.print(',');
+  packetOutput.print(rxPacket.command >> 4, HEX);
+  packetOutput.print(rxPacket.command & 0xF, HEX);
+  packetOutput.print(',');
+  Ideo::printParams(rxPacket.params);
+  packetOutput.print(',');
+  packetOutput.print(rxPacket.rssi);
+  packetOutput.print(',');
+  packetOutput.print(rxPacket.lqi);
+  this->printSerialSuffix(&this->m_lastPacketTimes);
+}
+
+/* Up to c_maxBatchSize commands may be sent on one line, separated by ';'
+ * The radio is acquired once for the whole batch, and the responses are grouped on one line */
+void Manager::processSerialCommand(const char *message)
+{
+  SerialLine::Parser parser(message);
+  if (parser.readKeyword(F("units")))
+  {
+    this->printUnits();
+    return;
+  }
+  if (parser.readKeyword(F("cache")))
+  {
+    this->processCacheCommand(&parser);
+    return;
+  }
+
+  RxPacketData rx[c_maxBatchSize];
+  uint8_t count = 0;
+  bool isRadioAcquired = false;
+
+  // Commands of a batch are separated by ';'
+  bool isRecordAvailable = true;
+  while (isRecordAvailable && count < c_maxBatchSize)
+  {
+    TxPacketData tx;
+    Unit *unit = NULL;
+    if (SerialParser::parseMessage(&parser, &tx))
+    {
+      unit = this->findUnit(tx.channel, tx.device, true);
+      if (unit == NULL)
+        packetOutput.println(F("Too many Ideo units."));
+    }
+    if (unit != NULL)
+    {
+      // Answer queries from the cache without touching the radio, stale entries get refreshed by poll()
+      if (ResponseCache::isCacheable(&tx))
+      {
+        if (unit->cache.lookup(&tx, &rx[count]) != CacheState::Missing)
+        {
+          count++;
+          isRecordAvailable = parser.nextRecord();
+          continue;
+        }
+      }
+      else
+      {
+        // Any other command may change the unit state
+        unit->cache.invalidate();
+      }
+
+      if (!isRadioAcquired)
+      {
+        this->acquireRadio();
+        isRadioAcquired = true;
+      }
+      if (!this->unitCommandResponse(unit, &tx, &rx[count]))
+      {
+        // Report an empty answer rather than garbage
+        rx[count].device = tx.device;
+        rx[count].command = tx.command;
+        rx[count].channel = tx.channel;
+        memset(rx[count].params, '0', 8);
+      }
+      count++;
+    }
+    isRecordAvailable = parser.nextRecord();
+  }
+
+  if (isRadioAcquired)
+    this->releaseRadio();
+
+  // No line at all when every response is empty
+  if (SerialParser::isPrintable(rx, count))
+  {
+    this->printSerialPrefix();
+    SerialParser::print(rx, count);
+  }
+}
+
+/* "cache" prints the cache lifetimes, "cache,<ttl ms>,<max age ms>" sets them for all the units */
+void Manager::processCacheCommand(SerialLine::Parser *parser)
+{
+  if (!parser->isEndOfRecord())
+  {
+    uint32_t ttl;
+    uint32_t maxAge;
+    if (!parser->readUInt(&ttl, 0xFFFFFFFF) || !parser->readUInt(&maxAge, 0xFFFFFFFF))
+    {
+      parser->printError();
+      return;
+    }
+    this->m_cacheTtl = ttl;
+    this->m_cacheMaxAge = maxAge;
+    for (uint8_t i = 0; i < this->m_unitCount; i++)
+      this->m_units[i].cache.setTtl(ttl, maxAge);
+  }
+  packetOutput.print(F("Cache TTL "));
+  packetOutput.print(this->m_cacheTtl);
+  packetOutput.print(F(" ms, max age "));
+  packetOutput.print(this->m_cacheMaxAge);
+  packetOutput.println(F(" ms"));
+}
+
+/* Refresh one stale cache entry at a time while we own the radio, visiting the units in turn
+ * The request is only sent here: its response is matched in the receive path by completeRefresh(), and
+ * the scheduler keeps our listen slot until it arrives or the unit times out */
+void Manager::poll()
+{
+  if (this->m_refreshUnit != NULL)
+  {
+    // The host did not ask for this request, so a unit which does not answer is not reported
+    if (millis() - this->m_refreshTime >= this->m_refreshUnit->timeout)
+    {
+      this->m_refreshUnit->timeoutCount++;
+      this->m_refreshUnit = NULL;
+    }
+    return;
+  }
+
+  for (uint8_t i = 0; i < this->m_unitCount; i++)
+  {
+    Unit *unit = &this->m_units[this->m_pollIndex];
+    this->m_pollIndex = (this->m_pollIndex + 1) % this->m_unitCount;
+
+    if (unit->cache.nextRefresh(&this->m_refreshTx))
+    {
+      this->m_refreshTx.channel = unit->channel;
+      this->selectChannel(unit->channel);
+      this->sendPacket(&this->m_refreshTx);
+      this->m_refreshUnit = unit;
+      this->m_refreshTime = millis();
+      return;
+    }
+  }
+}
+
+/* Take the response to the pending background refresh, if rx is one */
+bool Manager::completeRefresh(const RxPacketData *rx)
+{
+  Unit *unit = this->m_refreshUnit;
+  if (unit == NULL || rx->channel != unit->channel || rx->device != this->m_refreshTx.device ||
+      rx->command != this->m_refreshTx.command)
+    return false;
+
+  this->m_refreshUnit = NULL;
+  this->onUnitResponse(unit, rx);
+  if (SerialParser::isPrintable(rx))
+  {
+    this->printSerialPrefix();
+    SerialParser::print(rx);
+  }
+  return true;
+}
+
+Unit *Manager::findUnit(uint8_t channel, char device, bool create)
+{
+  for (uint8_t i = 0; i < this->m_unitCount; i++)
+    if (this->m_units[i].channel == channel && this->m_units[i].device == device)
+      return &this->m_units[i];
+
+  if (!create || this->m_unitCount >= c_maxUnits)
+    return NULL;
+
+  Unit *unit = &this->m_units[this->m_unitCount++];
+  unit->channel = channel;
+  unit->device = device;
+  unit->timeout = c_defaultUnitTimeout;
+  unit->responseCount = 0;
+  unit->timeoutCount = 0;
+  unit->lastRssi = 0;
+  unit->minRssi = 127;
+  unit->maxRssi = -128;
+  unit->rssiSum = 0;
+  unit->cache.invalidate();
+  unit->cache.setTtl(this->m_cacheTtl, this->m_cacheMaxAge);
+  return unit;
+}
+
+void Manager::printUnits()
+{
+  for (uint8_t i = 0; i < this->m_unitCount; i++)
+  {
+    Unit *unit = &this->m_units[i];
+    packetOutput.print(F("Unit "));
+    packetOutput.print(unit->device);
+    packetOutput.print('@');
+    packetOutput.print(unit->channel);
+    packetOutput.print(F(": "));
+    packetOutput.print(unit->responseCount);
+    packetOutput.print(F(" responses, "));
+    packetOutput.print(unit->timeoutCount);
+    packetOutput.print(F(" timeouts ("));
+    packetOutput.print(unit->timeout);
+    packetOutput.print(F(" ms)"));
+    if (unit->responseCount != 0)
+    {
+      packetOutput.print(F(", RSSI last/min/avg/max: "));
+      packetOutput.print(unit->lastRssi);
+      packetOutput.print('/');
+      packetOutput.print(unit->minRssi);
+      packetOutput.print('/');
+      packetOutput.print(unit->rssiSum / unit->responseCount);
+      packetOutput.print('/');
+      packetOutput.print(unit->maxRssi);
+    }
+    packetOutput.println();
+  }
+}
+
+/* Switch the sync word to a unit channel, without reconfiguring the radio */
+void Manager::selectChannel(uint8_t channel)
+{
+  if (channel == this->m_channel)
+    return;
+  this->m_radio.goIdle();
+  this->m_radio.writeRegister(CC1101::Register::SYNC0, channel);
+  this->m_radio.goReceive();
+  this->m_channel = channel;
+}
+
+bool Manager::unitCommandResponse(Unit *unit, TxPacketData *tx, RxPacketData *rx)
+{
+  this->selectChannel(unit->channel);
+  this->m_commandResponseTimeout = unit->timeout;
+  if (!this->commandResponse(tx, rx))
+  {
+    unit->timeoutCount++;
+    return false;
+  }
+  this->onUnitResponse(unit, rx);
+  return true;
+}
+
+void Manager::onUnitResponse(Unit *unit, const RxPacketData *rx)
+{
+  unit->responseCount++;
+  unit->lastRssi = rx->rssi;
+  unit->rssiSum += rx->rssi;
+  if (rx->rssi < unit->minRssi)
+    unit->minRssi = rx->rssi;
+  if (rx->rssi > unit->maxRssi)
+    unit->maxRssi = rx->rssi;
+  unit->cache.store(rx);
 }
 
 bool Manager::commandResponse(TxPacketData *tx, RxPacketData *rx)
@@ -168,14 +454,16 @@ bool Manager::commandResponse(TxPacketData *tx, RxPacketData *rx)
   this->sendPacket(tx);
   uint32_t packetSendTime = millis();
 
-  while (!this->isPacketAvailable() && millis() - packetSendTime < m_commandResponseTimeout)
-    ;
-  if (this->isPacketAvailable())
+  while (millis() - packetSendTime < m_commandResponseTimeout)
   {
+    if (!this->isPacketAvailable())
+      continue;
     this->getLastPacket(rx);
-    return true;
+    // A late response to a background refresh is not the answer to this command
+    if (!this->completeRefresh(rx))
+      return true;
   }
-  Serial.println("Wait for response timed out.");
+  packetOutput.println(F("Wait for response timed out."));
   return false;
 }
 
@@ -208,14 +496,14 @@ uint16_t Ideo::parseUint16(const char *param)
 void Ideo::printParams(const char *params)
 {
   for (int i = 0; i < 8; i++)
-    Serial.print(params[i]);
+    packetOutput.print(params[i]);
 }
 
 void Ideo::buildParams(char *params, uint32_t data)
 {
   for (uint8_t i = 0; i < 8; i++)
   {
-    params[i] = nibbleLut[(data >> (28 - 4 * i)) & 0xF];
+    params[i] = pgm_read_byte(&nibbleLut[(data >> (28 - 4 * i)) & 0xF]);
   }
 }
 
@@ -223,105 +511,105 @@ void Ideo::printPacket(const RxPacketData *packet)
 {
   uint16_t param_1 = parseUint16(packet->params);
   uint16_t param_2 = parseUint16(&packet->params[4]);
-  Serial.print("Device: ");
-  Serial.println(packet->device);
-  Serial.print("Command: ");
-  Serial.println(packet->command, HEX);
+  debugOutput.print(F("Device: "));
+  debugOutput.println(packet->device);
+  debugOutput.print(F("Command: "));
+  debugOutput.println(packet->command, HEX);
   switch (packet->command)
   {
   case 0x31:
-    Serial.println("Get Outlet? Temperature");
+    debugOutput.println(F("Get Outlet? Temperature"));
     break;
 
   case 0x32:
-    Serial.println("Get Outside Temperature");
+    debugOutput.println(F("Get Outside Temperature"));
     break;
 
   case 0x33:
-    Serial.println("Get Status");
+    debugOutput.println(F("Get Status"));
     break;
 
   case 0x3A:
-    Serial.println("Set Date/Time");
+    debugOutput.println(F("Set Date/Time"));
     if ((param_2 & 0xFF) != 0xFF)
     {
-      Serial.print("Day ");
-      Serial.print(param_2 & 0xff);
-      Serial.print(' ');
-      Serial.print(param_2 >> 8);
-      Serial.print(':');
-      Serial.println(param_1 & 0xff);
+      debugOutput.print(F("Day "));
+      debugOutput.print(param_2 & 0xff);
+      debugOutput.print(' ');
+      debugOutput.print(param_2 >> 8);
+      debugOutput.print(':');
+      debugOutput.println(param_1 & 0xff);
     }
     break;
 
   case 0x3B:
-    Serial.println("Set Schedule");
+    debugOutput.println(F("Set Schedule"));
     if (param_2 == 0)
     {
-      Serial.print("Value: ");
-      Serial.println(param_1);
+      debugOutput.print(F("Value: "));
+      debugOutput.println(param_1);
     }
     break;
 
   case 0x3C:
-    Serial.println("Set Low Fan Speed");
+    debugOutput.println(F("Set Low Fan Speed"));
     if (param_2 == 0)
     {
-      Serial.print("Value: ");
-      Serial.println(param_1);
+      debugOutput.print(F("Value: "));
+      debugOutput.println(param_1);
     }
     break;
 
   case 0x3D:
-    Serial.println("Set High Fan Speed");
+    debugOutput.println(F("Set High Fan Speed"));
     if (param_2 == 0)
     {
-      Serial.print("Value: ");
-      Serial.println(param_1);
+      debugOutput.print(F("Value: "));
+      debugOutput.println(param_1);
     }
     break;
 
   case 0x40:
-    Serial.println("Set Force Bypass");
+    debugOutput.println(F("Set Force Bypass"));
     if (param_2 < 25)
     {
-      Serial.print("Value: ");
-      Serial.println(param_1);
-      Serial.print("Duration (h): ");
-      Serial.print(param_2);
+      debugOutput.print(F("Value: "));
+      debugOutput.println(param_1);
+      debugOutput.print(F("Duration (h): "));
+      debugOutput.print(param_2);
     }
     break;
 
   case 0x41:
-    Serial.println("Set Holiday mode");
+    debugOutput.println(F("Set Holiday mode"));
     if (param_2 == 0)
     {
-      Serial.print("Value: ");
-      Serial.println(param_1);
+      debugOutput.print(F("Value: "));
+      debugOutput.println(param_1);
     }
     break;
 
   case 0x42:
-    Serial.println("Set Bypass");
+    debugOutput.println(F("Set Bypass"));
     if (param_2 <= 325)
     {
-      Serial.print("Value: ");
-      Serial.println(param_1);
-      Serial.print("Fan speed: ");
-      Serial.print(param_2);
+      debugOutput.print(F("Value: "));
+      debugOutput.println(param_1);
+      debugOutput.print(F("Fan speed: "));
+      debugOutput.print(param_2);
     }
     break;
 
   case 0x58:
-    Serial.println("Set Contact Polarity");
+    debugOutput.println(F("Set Contact Polarity"));
     break;
 
   case 0x59:
-    Serial.println("Dirty filter alarm threshold");
+    debugOutput.println(F("Dirty filter alarm threshold"));
     if (param_2 == 0)
     {
-      Serial.print("Value (RPM): ");
-      Serial.println(param_1);
+      debugOutput.print(F("Value (RPM): "));
+      debugOutput.println(param_1);
     }
     break;
 
@@ -330,16 +618,16 @@ void Ideo::printPacket(const RxPacketData *packet)
     break;
   }
 
-  Serial.print("Params: ");
+  debugOutput.print(F("Params: "));
   Ideo::printParams(packet->params);
-  Serial.println();
+  debugOutput.println();
 
-  Serial.print("RSSI: ");
-  Serial.print(packet->rssi);
-  Serial.println(" dBm");
+  debugOutput.print(F("RSSI: "));
+  debugOutput.print(packet->rssi);
+  debugOutput.println(F(" dBm"));
 
-  Serial.print("LQI: ");
-  Serial.println(packet->lqi);
+  debugOutput.print(F("LQI: "));
+  debugOutput.println(packet->lqi);
 }
 
 void Manager::attachRadio()
@@ -351,11 +639,13 @@ void Manager::attachRadio()
 
   this->m_radio.writeConfiguration(&ideoRfSettings);
   // Communication channel (as set on the devices) is the low sync byte
-  this->m_radio.writeRegister(CC1101::Register::SYNC0, 0);
+  this->m_radio.writeRegister(CC1101::Register::SYNC0, this->m_channel);
   // Put radio in receive mode
   this->m_radio.goReceive();
 }
 
 void Manager::detachRadio()
 {
+  // The response to a pending refresh would arrive on another profile
+  this->m_refreshUnit = NULL;
 }
\ No newline at end of file
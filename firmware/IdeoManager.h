@@ -2,52 +2,90 @@
 #define _IDEOMANAGER_H
 
 #include "CC1101.h"
+#include "Protocol.h"
+#include "Ideo.h"
+#include "IdeoCache.h"
+#include "SerialLine.h"
 
 namespace Ideo
 {
 
-  struct TxPacketData
-  {
-    char device;
-    uint8_t command;
-    char params[8];
-  };
+  // Ideo lines are prefixed with "1>" on the serial link
+  const uint8_t c_serialChannel = 1;
+  // Maximum number of commands batched on a single serial line
+  const uint8_t c_maxBatchSize = 4;
+  // Maximum number of ventilation units polled by the gateway
+  const uint8_t c_maxUnits = 3;
+  const uint16_t c_defaultUnitTimeout = 250;
 
-  struct RxPacketData
+  /** A ventilation unit, identified by its sync channel (SYNC0) and device ID */
+  struct Unit
   {
+    uint8_t channel;
     char device;
-    uint8_t command;
-    char params[8];
-    int8_t rssi;
-    uint8_t lqi;
+    uint16_t timeout;
+    uint16_t responseCount;
+    uint16_t timeoutCount;
+    int8_t lastRssi;
+    int8_t minRssi;
+    int8_t maxRssi;
+    int32_t rssiSum;
+    ResponseCache cache;
   };
 
-  class Manager
+  class Manager : public Protocol::Manager
   {
   public:
     Manager(uint8_t ssPin, uint8_t irqPin);
 
-    void begin(uint8_t channel = 0);
+    void begin() { this->begin(0); };
+    void begin(uint8_t channel);
 
     bool isPacketAvailable() { return this->m_isPacketAvailable; }
     void getLastPacket(RxPacketData *packet);
     void sendPacket(TxPacketData *packet);
 
+    void printLastPacket();
+    void processSerialCommand(const char *message);
+    void poll();
+    bool isBusy() { return this->m_refreshUnit != NULL; };
+
     bool commandResponse(TxPacketData *tx, RxPacketData *rx);
 
+    Unit *findUnit(uint8_t channel, char device, bool create = false);
+    void setUnitTimeout(Unit *unit, uint16_t timeout) { unit->timeout = timeout; };
+    void printUnits();
+
     void rfRxCallback();
 
     void detachRadio();
     void attachRadio();
 
     CC1101::Radio *radio() { return &m_radio; };
+    const __FlashStringHelper *name() { return F("ideo"); };
 
   protected:
+    void selectChannel(uint8_t channel);
+    bool unitCommandResponse(Unit *unit, TxPacketData *tx, RxPacketData *rx);
+    void onUnitResponse(Unit *unit, const RxPacketData *rx);
+    bool completeRefresh(const RxPacketData *rx);
+    void processCacheCommand(SerialLine::Parser *parser);
+
     CC1101::Radio m_radio;
-    uint8_t m_irqPin;
     RxPacketData m_lastRxPacket;
+    Clock::PacketTimes m_lastPacketTimes;
     bool m_isPacketAvailable;
     uint32_t m_commandResponseTimeout;
+    uint8_t m_channel;
+    Unit m_units[c_maxUnits];
+    uint8_t m_unitCount;
+    uint8_t m_pollIndex;
+    // Background refresh of a cache entry, sent by poll() and answered through the receive path
+    Unit *m_refreshUnit;
+    TxPacketData m_refreshTx;
+    uint32_t m_refreshTime;
+    uint32_t m_cacheTtl;
+    uint32_t m_cacheMaxAge;
   };
 
   void printParams(const char *params);
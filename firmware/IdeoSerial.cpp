@@ -1,69 +1,107 @@
 #include <Arduino.h>
 #include "IdeoSerial.h"
+#include "IdeoDecoder.h"
+#include "SerialLine.h"
 
 using namespace Ideo;
+using SerialLine::packetOutput;
 
-static const char *delims = ",";
-
-bool SerialParser::parseMessage(char *message, TxPacketData *tx)
+/* Command format: <device>,<command>,<params>[,<sync channel>] */
+bool SerialParser::parseMessage(SerialLine::Parser *parser, TxPacketData *tx)
 {
-    uint8_t ntok = 0;
-    char *token = strtok(message, delims);
-    while (token != NULL)
+    const char *token;
+    uint8_t length;
+
+    if (!parser->readToken(&token, &length))
+    {
+        parser->printError();
+        return false;
+    }
+    if (length != 1)
     {
-        switch (ntok++)
-        {
-        case 0:
-            if (strlen(token) != 1)
-            {
-                Serial.print("Device ID must be a 1-byte token. Got: ");
-                Serial.println(token);
-                return false;
-            }
-            tx->device = token[0];
-            break;
+        packetOutput.print(F("Device ID must be a 1-byte token. Got: "));
+        packetOutput.write((const uint8_t *)token, length);
+        packetOutput.println();
+        return false;
+    }
+    tx->device = token[0];
 
-        case 1:
-            if (strlen(token) != 2)
-            {
-                Serial.print("Command must be a 2-byte token. Got: ");
-                Serial.println(token);
-                return false;
-            }
-            tx->command = (Ideo::parseNibble(token[0]) << 4) | Ideo::parseNibble(token[1]);
-            break;
+    if (!parser->readToken(&token, &length))
+    {
+        parser->printError();
+        return false;
+    }
+    if (length != 2)
+    {
+        packetOutput.print(F("Command must be a 2-byte token. Got: "));
+        packetOutput.write((const uint8_t *)token, length);
+        packetOutput.println();
+        return false;
+    }
+    tx->command = (Ideo::parseNibble(token[0]) << 4) | Ideo::parseNibble(token[1]);
 
-        case 2:
-            if (strlen(token) != 8)
-            {
-                Serial.print("Command parameters must be a 8-byte token. Got:");
-                Serial.println(token);
-                return false;
-            }
-            memcpy(tx->params, token, 8);
-            break;
-        }
-        token = strtok(NULL, delims);
+    if (!parser->readToken(&token, &length))
+    {
+        parser->printError();
+        return false;
     }
-    if (ntok >= 3)
+    if (length != 8)
     {
-        return true;
+        packetOutput.print(F("Command parameters must be a 8-byte token. Got:"));
+        packetOutput.write((const uint8_t *)token, length);
+        packetOutput.println();
+        return false;
     }
-    else
+    memcpy(tx->params, token, 8);
+
+    tx->channel = 0;
+    if (!parser->isEndOfRecord() && !parser->readUInt(&tx->channel, 0xFF))
     {
-        Serial.print("Not enough data, got tokens: ");
-        Serial.println(ntok);
+        parser->printError();
+        return false;
     }
+    return true;
+}
+
+/* Print one or several (batched) responses on a single line, separated by ';'
+ * Responses with a known layout are printed as typed records, empty responses are skipped */
+void SerialParser::print(const RxPacketData *rx, uint8_t count)
+{
+    bool isFirst = true;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (Decoder::isEmptyResponse(&rx[i]))
+            continue;
+        if (!isFirst)
+            packetOutput.print(';');
+        isFirst = false;
+        if (Decoder::print(&rx[i]))
+            continue;
+        printDevice(&rx[i]);
+        packetOutput.print(',');
+        packetOutput.print(rx[i].command >> 4, HEX);
+        packetOutput.print(rx[i].command & 0xF, HEX);
+        packetOutput.print(',');
+        Ideo::printParams(rx[i].params);
+    }
+    packetOutput.println();
+}
+
+bool SerialParser::isPrintable(const RxPacketData *rx, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+        if (!Decoder::isEmptyResponse(&rx[i]))
+            return true;
     return false;
 }
 
-void SerialParser::print(const RxPacketData *rx)
+/* Units on the default sync channel are identified by their device ID only */
+void SerialParser::printDevice(const RxPacketData *rx)
 {
-    Serial.print(rx->device);
-    Serial.print(',');
-    Serial.print(rx->command >> 4, HEX);
-    Serial.print(rx->command & 0xF, HEX);
-    Serial.print(',');
-    Ideo::printParams(rx->params);
-    Serial.println();
+    packetOutput.print(rx->device);
+    if (rx->channel != 0)
+    {
+        packetOutput.print('@');
+        packetOutput.print(rx->channel);
+    }
 }
\ No newline at end of file
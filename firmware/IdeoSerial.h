@@ -2,14 +2,18 @@
 #define _IDEOSERIAL_H
 
 #include "IdeoManager.h"
+#include "SerialLine.h"
 
 namespace Ideo
 {
     class SerialParser
     {
     public:
-        static bool parseMessage(char *message, TxPacketData *tx);
-        static void print(const RxPacketData *rx);
+        static bool parseMessage(SerialLine::Parser *parser, TxPacketData *tx);
+        static void print(const RxPacketData *rx, uint8_t count = 1);
+        // True if print() has at least one response to print
+        static bool isPrintable(const RxPacketData *rx, uint8_t count = 1);
+        static void printDevice(const RxPacketData *rx);
     };
 } // namespace Ideo
 
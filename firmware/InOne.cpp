@@ -1,4 +1,4 @@
-#include <Arduino.h>
+#include <string.h>
 #include "InOne.h"
 
 using namespace InOne;
@@ -79,86 +79,3 @@ void Packet::fromRaw(Packet *packet, uint8_t *rawData, uint8_t length)
   else
     packet->isLearnMode = false;
 }
-
-void Packet::print()
-{
-  Serial.print("Sequence index: ");
-  Serial.println(this->sequenceIndex);
-  Serial.print("Switch ID: ");
-  Serial.println(this->id, DEC);
-  Serial.print("Channel: ");
-  switch (this->channel)
-  {
-  case Channel::Learn:
-    Serial.println("LEARN ");
-    break;
-  case Channel::Left:
-    Serial.println("LEFT ");
-    break;
-  case Channel::Right:
-    Serial.println("RIGHT ");
-    break;
-  }
-  Serial.print("Command: ");
-  switch (this->command)
-  {
-  case Command::Learn:
-    Serial.println("LEARN ");
-    break;
-  case Command::On:
-    Serial.println("ON ");
-    break;
-  case Command::Off:
-    Serial.println("OFF ");
-    break;
-  case Command::DimStart:
-    Serial.println("STARTVAR ");
-    break;
-  case Command::DimStop:
-    Serial.println("STOPVAR ");
-    break;
-  }
-  Serial.print("Packet Type: ");
-  switch (this->type)
-  {
-  case PacketType::Short:
-    Serial.println("SHORT ");
-    break;
-  case PacketType::Medium:
-    Serial.println("MEDIUM ");
-    break;
-  case PacketType::Long:
-    Serial.println("LONG ");
-    break;
-  }
-
-  if (this->isLearnMode)
-  {
-    Serial.print("Learning mode: ");
-    if (this->data[0] == 0x7)
-      Serial.println("exiting.");
-    else if (this->data[0] == 0x6)
-    {
-      Serial.print("command ");
-      Serial.println(this->data[1]);
-    }
-    else
-      Serial.println("entering.");
-  }
-
-  switch (this->type)
-  {
-  case PacketType::Medium:
-    Serial.print("Data: ");
-    Serial.println(this->data[0]);
-    break;
-  case PacketType::Long:
-    Serial.print("Data: ");
-    Serial.print(this->data[0], DEC);
-    Serial.print(' ');
-    Serial.print(this->data[1], DEC);
-    Serial.print(' ');
-    Serial.println(this->data[2], DEC);
-    break;
-  }
-}
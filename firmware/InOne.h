@@ -6,6 +6,9 @@
 namespace InOne
 {
 
+  // Switch IDs are 20-bit
+  const uint32_t c_maxId = 0xFFFFF;
+
   enum class Command : uint8_t
   {
     Learn = 0,
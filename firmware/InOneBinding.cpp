@@ -0,0 +1,230 @@
+#include <Arduino.h>
+#include "InOneBinding.h"
+#include "InOneManager.h"
+#include "InOneSerial.h"
+#include "SerialLine.h"
+
+using namespace InOne;
+using SerialLine::packetOutput;
+
+BindingTable::BindingTable(Manager *manager) : m_manager(manager),
+                                               m_bindingCount(0),
+                                               m_lightCount(0),
+                                               m_controlSwitchCount(0),
+                                               m_lastPacketTime(0),
+                                               m_actionCount(0),
+                                               m_latencySum(0),
+                                               m_latencyMax(0)
+{
+  this->clear();
+}
+
+void BindingTable::clear()
+{
+  for (uint8_t i = 0; i < this->m_lightCount; i++)
+    this->m_lights[i].offTimer.stop();
+  this->m_bindingCount = 0;
+  this->m_lightCount = 0;
+  this->m_controlSwitchCount = 0;
+}
+
+/* Bind a source switch (c_anyChannel for both channels) to the light controlled by controlId/controlChannel
+ * The timer is the auto-off duration of the light in seconds, 0 to disable it */
+bool BindingTable::bind(uint32_t sourceId, uint8_t sourceChannel, uint32_t controlId, Channel controlChannel, uint16_t timer)
+{
+  if (this->m_bindingCount >= c_maxBindings)
+    return false;
+
+  int8_t controlSwitch = this->findControlSwitch(controlId, true);
+  if (controlSwitch < 0)
+    return false;
+
+  // Lights are identified by their controlling switch and channel
+  uint8_t light = 0;
+  while (light < this->m_lightCount &&
+         (this->m_lights[light].controlSwitch != controlSwitch || this->m_lights[light].channel != controlChannel))
+    light++;
+  if (light == this->m_lightCount)
+  {
+    if (this->m_lightCount >= c_maxBoundLights)
+      return false;
+    this->m_lights[light].controlSwitch = controlSwitch;
+    this->m_lights[light].channel = controlChannel;
+    this->m_lights[light].isHeld = false;
+    this->m_lights[light].offTimer.setCallback(onOffTimer, this);
+    this->m_lightCount++;
+  }
+  this->m_lights[light].timer = timer;
+
+  Binding *binding = &this->m_bindings[this->m_bindingCount++];
+  binding->sourceId = sourceId;
+  binding->sourceChannel = sourceChannel;
+  binding->light = light;
+  return true;
+}
+
+/* Apply the bindings to a received packet, returns true if an action was taken */
+bool BindingTable::process(const Packet *packet, uint32_t decodeTime)
+{
+  if (packet->isLearnMode)
+    return false;
+
+  // Wall switches repeat their frames: only act on the first one
+  uint32_t now = millis();
+  if (now - this->m_lastPacketTime < c_bindingDedupMs &&
+      packet->id == this->m_lastPacket.id &&
+      packet->channel == this->m_lastPacket.channel &&
+      packet->command == this->m_lastPacket.command &&
+      packet->sequenceIndex == this->m_lastPacket.sequenceIndex)
+    return false;
+  memcpy(&this->m_lastPacket, packet, sizeof(Packet));
+  this->m_lastPacketTime = now;
+
+  bool isActionTaken = false;
+  for (uint8_t i = 0; i < this->m_bindingCount; i++)
+  {
+    Binding *binding = &this->m_bindings[i];
+    if (binding->sourceId != packet->id ||
+        (binding->sourceChannel != c_anyChannel && binding->sourceChannel != (uint8_t)packet->channel))
+      continue;
+
+    Light *light = &this->m_lights[binding->light];
+    Command command = packet->command;
+    // A held 'on' (dim start from the up button) keeps the light on, bypassing the timer
+    if (command == Command::DimStart && packet->type == PacketType::Long)
+    {
+      if (packet->data[0] != 127)
+        continue;
+      light->isHeld = true;
+      light->offTimer.stop();
+      command = Command::On;
+    }
+    else if (command == Command::On)
+    {
+      // Retrigger the auto-off timer
+      light->isHeld = false;
+      if (light->timer != 0)
+        light->offTimer.start(light->timer * 1000UL);
+    }
+    else if (command == Command::Off)
+    {
+      light->isHeld = false;
+      light->offTimer.stop();
+    }
+    else
+      continue;
+
+    this->sendCommand(light, command);
+    isActionTaken = true;
+  }
+
+  if (isActionTaken)
+  {
+    uint32_t latency = micros() - decodeTime;
+    this->m_actionCount++;
+    this->m_latencySum += latency;
+    if (latency > this->m_latencyMax)
+      this->m_latencyMax = latency;
+  }
+  return isActionTaken;
+}
+
+/* Host commands for the ID of a controlling switch take the sequence of that switch */
+void BindingTable::assignSequence(Packet *packet)
+{
+  int8_t controlSwitch = this->findControlSwitch(packet->id, false);
+  if (controlSwitch >= 0)
+    this->m_controlSwitches[controlSwitch].assignSequence(packet);
+}
+
+/* Auto-off timer of a light, called from the timer wheel */
+void BindingTable::onOffTimer(Timer::Monostable *timer, void *context)
+{
+  BindingTable *table = (BindingTable *)context;
+  for (uint8_t i = 0; i < table->m_lightCount; i++)
+  {
+    if (&table->m_lights[i].offTimer == timer)
+      table->sendCommand(&table->m_lights[i], Command::Off);
+  }
+}
+
+/* "bind" prints the bindings report, "bind,clear" removes all bindings,
+ * "bind,<source id>,<source channel>,<control id>,<control channel>,<timer s>" adds a binding */
+void BindingTable::processSerialCommand(SerialLine::Parser *parser)
+{
+  if (parser->isEndOfRecord())
+  {
+    this->printReport();
+    return;
+  }
+  if (parser->readKeyword(F("clear")))
+  {
+    this->clear();
+    return;
+  }
+
+  uint32_t sourceId;
+  uint8_t sourceChannel;
+  uint32_t controlId;
+  uint8_t controlChannel;
+  uint32_t timer;
+  if (!parser->readUInt(&sourceId, c_maxId) ||
+      !parser->readUInt(&sourceChannel, (uint8_t)Channel::Right) ||
+      !parser->readUInt(&controlId, c_maxId) ||
+      !parser->readUInt(&controlChannel, (uint8_t)Channel::Right) ||
+      !parser->readUInt(&timer, 0xFFFF))
+  {
+    parser->printError();
+  }
+  else if (!this->bind(sourceId, sourceChannel, controlId, (Channel)controlChannel, timer))
+  {
+    packetOutput.println(F("Binding table full."));
+  }
+}
+
+void BindingTable::printReport()
+{
+  packetOutput.print(F("Bindings: "));
+  packetOutput.print(this->m_bindingCount);
+  packetOutput.print(F(", lights: "));
+  packetOutput.print(this->m_lightCount);
+  packetOutput.print(F(", actions: "));
+  packetOutput.print(this->m_actionCount);
+  if (this->m_actionCount != 0)
+  {
+    packetOutput.print(F(", latency avg/max (us): "));
+    packetOutput.print(this->m_latencySum / this->m_actionCount);
+    packetOutput.print('/');
+    packetOutput.print(this->m_latencyMax);
+  }
+  packetOutput.println();
+}
+
+int8_t BindingTable::findControlSwitch(uint32_t id, bool create)
+{
+  for (uint8_t i = 0; i < this->m_controlSwitchCount; i++)
+    if (this->m_controlSwitches[i].id() == id)
+      return i;
+
+  if (!create || this->m_controlSwitchCount >= c_maxControlSwitches)
+    return -1;
+
+  Switch *controlSwitch = &this->m_controlSwitches[this->m_controlSwitchCount];
+  controlSwitch->setId(id);
+  controlSwitch->setManager(this->m_manager);
+  return this->m_controlSwitchCount++;
+}
+
+/* Send a command through the controlling switch of a light, and notify the host as for a received packet */
+void BindingTable::sendCommand(Light *light, Command command)
+{
+  Switch *controlSwitch = &this->m_controlSwitches[light->controlSwitch];
+  if (command == Command::On)
+    controlSwitch->turnOn(light->channel);
+  else
+    controlSwitch->turnOff(light->channel);
+
+  this->m_manager->printSerialPrefix();
+  SerialParser::print(controlSwitch->lastPacket());
+  packetOutput.println();
+}
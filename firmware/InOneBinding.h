@@ -0,0 +1,79 @@
+#ifndef _INONEBINDING_H
+#define _INONEBINDING_H
+
+#include "InOne.h"
+#include "InOneSwitch.h"
+#include "TimerWheel.h"
+#include "SerialLine.h"
+
+namespace InOne
+{
+
+  const uint8_t c_maxBindings = 8;
+  const uint8_t c_maxBoundLights = 4;
+  const uint8_t c_maxControlSwitches = 2;
+  // Source channel matching both channels of a switch
+  const uint8_t c_anyChannel = 0;
+  // Repeated frames of a single press are ignored during this time
+  const uint16_t c_bindingDedupMs = 1000;
+
+  class Manager;
+
+  /** Local switch-to-light bindings, uploaded by the host
+   *  Commands received from a bound switch are forwarded through the controlling (virtual) switch
+   *  of the light, and the auto-off timer of the light runs in the firmware */
+  class BindingTable
+  {
+  public:
+    BindingTable(Manager *manager);
+
+    void clear();
+    bool bind(uint32_t sourceId, uint8_t sourceChannel, uint32_t controlId, Channel controlChannel, uint16_t timer);
+
+    bool process(const Packet *packet, uint32_t decodeTime);
+    void assignSequence(Packet *packet);
+
+    void processSerialCommand(SerialLine::Parser *parser);
+    void printReport();
+
+  private:
+    struct Binding
+    {
+      uint32_t sourceId;
+      uint8_t sourceChannel;
+      uint8_t light;
+    };
+
+    struct Light
+    {
+      uint8_t controlSwitch;
+      Channel channel;
+      uint16_t timer;
+      bool isHeld;
+      Timer::Monostable offTimer;
+    };
+
+    static void onOffTimer(Timer::Monostable *timer, void *context);
+
+    int8_t findControlSwitch(uint32_t id, bool create);
+    void sendCommand(Light *light, Command command);
+
+    Manager *m_manager;
+    Binding m_bindings[c_maxBindings];
+    uint8_t m_bindingCount;
+    Light m_lights[c_maxBoundLights];
+    uint8_t m_lightCount;
+    Switch m_controlSwitches[c_maxControlSwitches];
+    uint8_t m_controlSwitchCount;
+
+    Packet m_lastPacket;
+    uint32_t m_lastPacketTime;
+
+    uint16_t m_actionCount;
+    uint32_t m_latencySum;
+    uint32_t m_latencyMax;
+  };
+
+} // namespace InOne
+
+#endif //_INONEBINDING_H
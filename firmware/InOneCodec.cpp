@@ -0,0 +1,182 @@
+#include <string.h>
+#include "InOneCodec.h"
+#include "BitStream.h"
+
+using namespace InOne;
+
+namespace Manchester
+{
+  /* Decode an inverted manchester-encoded signal
+   *  <length> is the length of the *decoded* signal, int *bits*
+   *  in_offset is an offset in the *input* buffer, specificed in *decoded bits*
+   */
+  void Decode(const uint8_t *in_buffer, uint8_t *out_buffer, uint16_t length, uint16_t in_offset, uint8_t *n_errors)
+  {
+    uint8_t _n_errors = 0;
+    BitStream::Reader<BitStream::MsbFirst> input(in_buffer, in_offset * 2);
+    BitStream::Writer<BitStream::LsbFirst> output(out_buffer);
+    for (uint16_t b_ptr = 0; b_ptr < length; b_ptr++)
+    {
+      // Get two bits from input buffer
+      uint8_t in_data = input.read() << 1;
+      in_data |= input.read();
+      // Decode manchester-encoded bit
+      uint8_t out_data = 0;
+      if (in_data == 0b01)
+        out_data = 0;
+      else if (in_data == 0b10)
+        out_data = 1;
+      else
+        _n_errors++;
+      // Set decoded bit in output buffer
+      output.write(out_data);
+    }
+    output.flush();
+    if (n_errors != 0)
+      *n_errors = _n_errors;
+  }
+
+  /** Encode a message using Manchester encoding
+   *  <length> is the length of the message to be encoded, in *bits*
+   *  <out_offset> is the offset to write to in the output buffer, in *bits*
+   */
+
+  void Encode(const uint8_t *in_buffer, uint8_t *out_buffer, uint16_t length, uint16_t out_offset)
+  {
+    BitStream::Reader<BitStream::LsbFirst> input(in_buffer);
+    BitStream::Writer<BitStream::MsbFirst> output(out_buffer, out_offset);
+    for (uint16_t i = 0; i < length; i++)
+    {
+      // '1' is encoded as 10, '0' as 01
+      uint8_t bit = input.read();
+      output.write(bit);
+      output.write(bit ^ 1);
+    }
+    output.flush();
+  }
+} // namespace Manchester
+
+/**
+ * The Protocol used over the Manchester layer
+ * It consists in framing each nibble with a high bit
+ */
+namespace LegrandProtocol
+{
+  /* Extract bytes from in_buffer (contains nibbles framed by '1' bits)
+ *  length is in *bytes* to be decoded
+ *  out_buffer only contains bytes !
+ */
+  void Decode(const uint8_t *in_buffer, uint8_t *out_buffer, uint8_t length, uint8_t *n_errors)
+  {
+    uint8_t _n_errors = 0;
+    BitStream::Reader<BitStream::LsbFirst> input(in_buffer);
+    BitStream::Writer<BitStream::LsbFirst> output(out_buffer);
+    for (uint8_t n_ptr = 0; n_ptr < length * 2; n_ptr++)
+    {
+      // First bit should always be 1
+      if (input.read() != 1)
+        _n_errors++;
+      for (uint8_t i = 0; i < 4; i++)
+        output.write(input.read());
+    }
+    output.flush();
+    if (n_errors != 0)
+      *n_errors = _n_errors;
+  }
+
+  void Encode(const uint8_t *in_buffer, uint8_t *out_buffer, uint8_t length)
+  {
+    BitStream::Reader<BitStream::LsbFirst> input(in_buffer);
+    BitStream::Writer<BitStream::LsbFirst> output(out_buffer);
+    for (uint8_t n_ptr = 0; n_ptr < length * 2; n_ptr++)
+    {
+      // First bit before a nibble needs to be a '1'
+      output.write(1);
+      for (uint8_t i = 0; i < 4; i++)
+        output.write(input.read());
+    }
+    // Set last bit
+    output.write(1);
+    output.flush();
+  }
+} // namespace LegrandProtocol
+
+/* Same checks as the firmware always did: the 6 first bytes, then the extra bytes announced by the header,
+ * every Manchester pair and framing bit must be valid, and the checksum must match */
+DecodeStatus InOne::decodeFrame(const uint8_t *window, uint8_t *rawData, uint8_t *length, uint8_t *detail)
+{
+  uint8_t manDecBuffer[12];
+  uint8_t decodeErrorCount = 0;
+
+  // Decode the manchester-encoded data stream
+  Manchester::Decode(window, manDecBuffer, 60, 2, &decodeErrorCount);
+  *detail = decodeErrorCount;
+  if (decodeErrorCount != 0)
+    return DecodeStatus::ManchesterErrors;
+
+  // Try to decode the first 6 bytes of the InOne message (we do not know the actual length yet !)
+  *length = 6;
+  LegrandProtocol::Decode(manDecBuffer, rawData, 6, &decodeErrorCount);
+  *detail = decodeErrorCount;
+  if (decodeErrorCount != 0)
+    return DecodeStatus::FramingErrors;
+
+  // Compute the number of extra bytes
+  uint8_t extraByteCount = 0;
+  switch ((rawData[4] & 0xC0) >> 6)
+  {
+  case 0:
+    break;
+  case 1:
+    extraByteCount = 1;
+    break;
+  case 2:
+    extraByteCount = 3;
+    break;
+  default:
+    *detail = rawData[4] >> 6;
+    return DecodeStatus::ExtraByteCount;
+  }
+  if (extraByteCount)
+  {
+    // Decode the extra message bytes
+    Manchester::Decode(window, manDecBuffer, 10 * extraByteCount, 62, &decodeErrorCount);
+    *detail = decodeErrorCount;
+    if (decodeErrorCount != 0)
+      return DecodeStatus::ExtraManchesterErrors;
+    LegrandProtocol::Decode(manDecBuffer, &rawData[6], extraByteCount, &decodeErrorCount);
+    *detail = decodeErrorCount;
+    if (decodeErrorCount != 0)
+      return DecodeStatus::ExtraFramingErrors;
+    *length += extraByteCount;
+  }
+
+  // Compute and check the packet checksum
+  *detail = Packet::checksum(rawData, *length - 1);
+  if (*detail != rawData[*length - 1])
+    return DecodeStatus::ChecksumFail;
+  return DecodeStatus::Ok;
+}
+
+/* The frame starts with the last nibble of the sync word, the radio sends 83E0 itself
+ * In order to improve link relability, the message is transmitted twice. Because the nibble count is odd,
+ * we cannot just repeat the previous message bytes, so a second sync word and manchester-encoded data are inserted */
+uint8_t InOne::encodeFrame(const uint8_t *framedData, uint8_t length, uint8_t *frame)
+{
+  memset(frame, 0, c_rfTxFrameSize);
+  // Position the first nibble of the manchester-encoded data to the 5th nibble of the sync word 83E0F
+  frame[0] = 0xF0;
+  // Manchester-encode the framed data, start outputting at the 5th bit (because of the sync nibble)
+  Manchester::Encode(framedData, frame, length * 10 + 1, 4);
+  uint8_t nibbleCount = (length * 10 + 1) / 2 + 1;
+
+  // Insert sync word
+  BitStream::Writer<BitStream::MsbFirst> sync(frame, nibbleCount * 4);
+  sync.write(0x83E0F, 20);
+  sync.flush();
+  nibbleCount += 5;
+  // Insert manchester-encoded data again
+  Manchester::Encode(framedData, frame, length * 10 + 1, nibbleCount * 4);
+  nibbleCount += (length * 10 + 1) / 2;
+  return nibbleCount;
+}
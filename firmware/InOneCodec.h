@@ -0,0 +1,52 @@
+#ifndef _INONECODEC_H
+#define _INONECODEC_H
+
+#include <stdint.h>
+#include "InOne.h"
+
+/** Radio layers of the InOne protocol, free of any Arduino dependency so that the host tools
+ *  run the exact firmware decode path */
+namespace Manchester
+{
+  void Decode(const uint8_t *in_buffer, uint8_t *out_buffer, uint16_t length, uint16_t in_offset, uint8_t *n_errors);
+  void Encode(const uint8_t *in_buffer, uint8_t *out_buffer, uint16_t length, uint16_t out_offset);
+} // namespace Manchester
+
+namespace LegrandProtocol
+{
+  void Decode(const uint8_t *in_buffer, uint8_t *out_buffer, uint8_t length, uint8_t *n_errors);
+  void Encode(const uint8_t *in_buffer, uint8_t *out_buffer, uint8_t length);
+} // namespace LegrandProtocol
+
+namespace InOne
+{
+
+  // Bytes received after the sync word for each frame
+  const uint8_t c_rfRxPacketSize = 60;
+  // Longest raw packet, checksum included
+  const uint8_t c_maxRawPacketSize = 9;
+  // Longest transmitted frame, see encodeFrame()
+  const uint8_t c_rfTxFrameSize = 64;
+
+  enum class DecodeStatus : uint8_t
+  {
+    Ok,
+    ManchesterErrors,
+    FramingErrors,
+    ExtraByteCount,
+    ExtraManchesterErrors,
+    ExtraFramingErrors,
+    ChecksumFail
+  };
+
+  /** Decode a received window into the raw packet bytes
+   *  detail is the error count of the failed step, the invalid extra byte code, or the computed checksum */
+  DecodeStatus decodeFrame(const uint8_t *window, uint8_t *rawData, uint8_t *length, uint8_t *detail);
+
+  /** Manchester-encode a packet of length bytes, framed by LegrandProtocol::Encode(), into a radio frame
+   *  of c_rfTxFrameSize bytes. Returns the frame length in nibbles */
+  uint8_t encodeFrame(const uint8_t *framedData, uint8_t length, uint8_t *frame);
+
+} // namespace InOne
+
+#endif //_INONECODEC_H
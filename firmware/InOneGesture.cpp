@@ -0,0 +1,166 @@
+#include <Arduino.h>
+#include "InOneGesture.h"
+#include "InOneManager.h"
+#include "SerialLine.h"
+
+using namespace InOne;
+using SerialLine::packetOutput;
+
+GestureTable::GestureTable(Manager *manager) : m_manager(manager),
+                                               m_isEnabled(false),
+                                               m_gestureCount(0),
+                                               m_collapsedCount(0)
+{
+  this->clear();
+}
+
+void GestureTable::clear()
+{
+  this->m_trackerCount = 0;
+}
+
+/* Track the frames of a switch channel: the repeated frames of a press are collapsed,
+ * and the first frame of each press is reported as a gesture */
+bool GestureTable::process(const Packet *packet, const Clock::PacketTimes *times)
+{
+  if (!this->m_isEnabled || packet->isLearnMode || packet->channel == Channel::Learn)
+    return false;
+  // Dim start frames carry the dim direction in their first data byte
+  if (packet->command != Command::On && packet->command != Command::Off && packet->command != Command::DimStop &&
+      (packet->command != Command::DimStart || packet->type != PacketType::Long))
+    return false;
+
+  uint32_t now = millis();
+  Tracker *tracker = this->findTracker(packet, now);
+  Command previousCommand = tracker->lastCommand;
+  bool isRepeat = now - tracker->lastFrameTime < c_gestureRepeatMs &&
+                  packet->command == previousCommand &&
+                  packet->sequenceIndex == tracker->lastSequenceIndex;
+  tracker->lastCommand = packet->command;
+  tracker->lastSequenceIndex = packet->sequenceIndex;
+  tracker->lastFrameTime = now;
+  if (isRepeat)
+  {
+    this->m_collapsedCount++;
+    return true;
+  }
+
+  Gesture gesture;
+  uint16_t value = (uint8_t)packet->command;
+  switch (packet->command)
+  {
+  case Command::DimStart:
+    // Up (127) dims towards on, down (-128) towards off
+    gesture = Gesture::HoldStart;
+    value = (uint8_t)(packet->data[0] == 127 ? Command::On : Command::Off);
+    tracker->isClickPending = false;
+    tracker->isHeld = true;
+    tracker->holdTime = now;
+    break;
+  case Command::DimStop:
+    // The hold duration is unknown if its start frame was lost
+    gesture = Gesture::Release;
+    value = tracker->isHeld ? (now - tracker->holdTime < 0xFFFF ? now - tracker->holdTime : 0xFFFF) : 0;
+    tracker->isHeld = false;
+    break;
+  default:
+    // A hold whose stop frame was lost ends with the next press
+    tracker->isHeld = false;
+    if (tracker->isClickPending && packet->command == previousCommand && now - tracker->clickTime < c_doubleClickMs)
+    {
+      gesture = Gesture::DoubleClick;
+      tracker->isClickPending = false;
+    }
+    else
+    {
+      gesture = Gesture::Click;
+      tracker->isClickPending = true;
+      tracker->clickTime = now;
+    }
+    break;
+  }
+
+  this->print(packet, gesture, value, times);
+  this->m_gestureCount++;
+  return true;
+}
+
+/* Tracker of the packet switch channel, replacing the least recently used one if none is free */
+GestureTable::Tracker *GestureTable::findTracker(const Packet *packet, uint32_t now)
+{
+  Tracker *tracker = NULL;
+  for (uint8_t i = 0; i < this->m_trackerCount; i++)
+  {
+    if (this->m_trackers[i].id == packet->id && this->m_trackers[i].channel == packet->channel)
+      return &this->m_trackers[i];
+    if (tracker == NULL || now - this->m_trackers[i].lastFrameTime > now - tracker->lastFrameTime)
+      tracker = &this->m_trackers[i];
+  }
+  if (this->m_trackerCount < c_maxGestureTrackers)
+    tracker = &this->m_trackers[this->m_trackerCount++];
+
+  tracker->id = packet->id;
+  tracker->channel = packet->channel;
+  tracker->lastCommand = Command::Learn;
+  tracker->lastFrameTime = now - c_gestureRepeatMs;
+  tracker->isClickPending = false;
+  tracker->isHeld = false;
+  return tracker;
+}
+
+void GestureTable::print(const Packet *packet, Gesture gesture, uint16_t value, const Clock::PacketTimes *times)
+{
+  this->m_manager->printSerialPrefix();
+  packetOutput.print(F("gesture,"));
+  packetOutput.print(packet->id);
+  packetOutput.print(',');
+  packetOutput.print((uint8_t)packet->channel);
+  switch (gesture)
+  {
+  case Gesture::Click:
+    packetOutput.print(F(",click,"));
+    break;
+  case Gesture::DoubleClick:
+    packetOutput.print(F(",double,"));
+    break;
+  case Gesture::HoldStart:
+    packetOutput.print(F(",hold,"));
+    break;
+  default:
+    packetOutput.print(F(",release,"));
+    break;
+  }
+  packetOutput.print(value);
+  this->m_manager->printSerialSuffix(times);
+}
+
+/* "gesture" prints the gesture report, "gesture,<0|1>" disables or enables the gesture lines */
+void GestureTable::processSerialCommand(SerialLine::Parser *parser)
+{
+  if (parser->isEndOfRecord())
+  {
+    this->printReport();
+    return;
+  }
+
+  uint8_t isEnabled;
+  if (!parser->readUInt(&isEnabled, 1))
+  {
+    parser->printError();
+    return;
+  }
+  this->m_isEnabled = isEnabled != 0;
+  this->clear();
+}
+
+void GestureTable::printReport()
+{
+  packetOutput.print(F("Gestures: "));
+  packetOutput.print(this->m_isEnabled ? F("on") : F("off"));
+  packetOutput.print(F(", trackers: "));
+  packetOutput.print(this->m_trackerCount);
+  packetOutput.print(F(", gestures: "));
+  packetOutput.print(this->m_gestureCount);
+  packetOutput.print(F(", collapsed frames: "));
+  packetOutput.println(this->m_collapsedCount);
+}
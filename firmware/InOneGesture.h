@@ -0,0 +1,74 @@
+#ifndef _INONEGESTURE_H
+#define _INONEGESTURE_H
+
+#include "InOne.h"
+#include "Clock.h"
+#include "SerialLine.h"
+
+namespace InOne
+{
+
+  const uint8_t c_maxGestureTrackers = 4;
+  // A frame with the command and sequence index of the previous one is a repeat during this time
+  const uint16_t c_gestureRepeatMs = 1000;
+  // Two clicks of the same command closer than this are a double click
+  const uint16_t c_doubleClickMs = 600;
+
+  enum class Gesture : uint8_t
+  {
+    None,
+    Click,
+    DoubleClick,
+    HoldStart,
+    Release
+  };
+
+  class Manager;
+
+  /** Recognizes the gestures of each switch channel from the received frames, when enabled by the host
+   *  Instead of one line per frame, a single "gesture,<id>,<channel>,<gesture>,<value>" line is printed per gesture:
+   *  "click" and "double" with the command, "hold" with the command of the dim direction, "release" with the held ms */
+  class GestureTable
+  {
+  public:
+    GestureTable(Manager *manager);
+
+    void clear();
+    bool isEnabled() { return this->m_isEnabled; };
+
+    // Returns true if the packet is a gesture frame, which must not be printed as a packet
+    bool process(const Packet *packet, const Clock::PacketTimes *times);
+
+    void processSerialCommand(SerialLine::Parser *parser);
+    void printReport();
+
+  private:
+    struct Tracker
+    {
+      uint32_t id;
+      Channel channel;
+      Command lastCommand;
+      uint8_t lastSequenceIndex;
+      uint32_t lastFrameTime;
+      // First frame of the last click, and of the current hold
+      uint32_t clickTime;
+      uint32_t holdTime;
+      bool isClickPending;
+      bool isHeld;
+    };
+
+    Tracker *findTracker(const Packet *packet, uint32_t now);
+    void print(const Packet *packet, Gesture gesture, uint16_t value, const Clock::PacketTimes *times);
+
+    Manager *m_manager;
+    bool m_isEnabled;
+    Tracker m_trackers[c_maxGestureTrackers];
+    uint8_t m_trackerCount;
+
+    uint16_t m_gestureCount;
+    uint16_t m_collapsedCount;
+  };
+
+} // namespace InOne
+
+#endif //_INONEGESTURE_H
@@ -1,6 +1,8 @@
 #include <Arduino.h>
 #include "InOneManager.h"
-#include "bit_funcs.h"
+#include "InOneSerial.h"
+#include "SerialLine.h"
+#include "Log.h"
 
 using namespace InOne;
 
@@ -38,11 +40,13 @@ CC1101::Configuration inOneRfSettings = {
     // Set deviation to 25.4kHz
     0x40, // DEVIATN       Modem Deviation Setting
     0x07, // MCSM2         Main Radio Control State Machine Configuration
-    0x0C, // MCSM1         Main Radio Control State Machine Configuration
+    // CCA mode: clear if RSSI below threshold unless currently receiving a packet
+    0x3C, // MCSM1         Main Radio Control State Machine Configuration
     0x18, // MCSM0         Main Radio Control State Machine Configuration
     0x16, // FOCCFG        Frequency Offset Compensation Configuration
     0x6C, // BSCFG         Bit Synchronization Configuration
     0x03, // AGCCTRL2      AGC Control
+    // Carrier sense: relative threshold off, absolute threshold at MAGN_TARGET (CCA busy above it)
     0x40, // AGCCTRL1      AGC Control
     0x91, // AGCCTRL0      AGC Control
     0x87, // WOREVT1       High Byte Event0 Timeout
@@ -64,118 +68,18 @@ CC1101::Configuration inOneRfSettings = {
     0x09, // TEST0         Various Test Settings
 };
 
-namespace Manchester
-{
-  /* Decode an inverted manchester-encoded signal
-   *  <length> is the length of the *decoded* signal, int *bits*
-   *  in_offset is an offset in the *input* buffer, specificed in *decoded bits*
-   */
-  void Decode(uint8_t *in_buffer, uint8_t *out_buffer, uint16_t length, uint16_t in_offset, uint8_t *n_errors)
-  {
-    uint8_t _n_errors = 0;
-    for (uint16_t b_ptr = 0; b_ptr < length; b_ptr++)
-    {
-      // Get two bits from input buffer
-      uint8_t in_ptr = (b_ptr + in_offset) * 2;
-      uint8_t in_data = get_bit(in_buffer, in_ptr, true) << 1 |
-                        get_bit(in_buffer, in_ptr + 1, true);
-      // Decode manchester-encoded bit
-      uint8_t out_data = 0;
-      if (in_data == 0b01)
-        out_data = 0;
-      else if (in_data == 0b10)
-        out_data = 1;
-      else
-        _n_errors++;
-      // Set decoded bit in output buffer
-      def_bit(out_buffer, b_ptr, out_data);
-    }
-    if (n_errors != 0)
-      *n_errors = _n_errors;
-  }
-
-  /** Encode a message using Manchester encoding
-   *  <length> is the length of the message to be encoded, in *bits*
-   *  <out_offset> is the offset to write to in the output buffer, in *bits*
-   */
-
-  void Encode(uint8_t *in_buffer, uint8_t *out_buffer, uint16_t length, uint16_t out_offset)
-  {
-    uint16_t out_ptr = out_offset;
-    for (uint16_t i = 0; i < length; i++)
-    {
-      if (get_bit(in_buffer, i))
-      {
-        set_bit(out_buffer, out_ptr++, true);
-        clr_bit(out_buffer, out_ptr++, true);
-      }
-      else
-      {
-        clr_bit(out_buffer, out_ptr++, true);
-        set_bit(out_buffer, out_ptr++, true);
-      }
-    }
-  }
-} // namespace Manchester
-
-/**
- * The Protocol used over the Manchester layer
- * It consists in framing each nibble with a high bit
- */
-namespace LegrandProtocol
-{
-  /* Extract bytes from in_buffer (contains nibbles framed by '1' bits)
- *  length is in *bytes* to be decoded
- *  out_buffer only contains bytes !
- */
-  void Decode(uint8_t *in_buffer, uint8_t *out_buffer, uint8_t length, uint8_t *n_errors)
-  {
-    uint8_t _n_errors = 0;
-    for (uint8_t n_ptr = 0; n_ptr < length * 2; n_ptr++)
-    {
-      uint8_t in_ptr = n_ptr * 5;
-      for (uint8_t i = 0; i < 5; i++)
-      {
-        uint8_t in_data = get_bit(in_buffer, (in_ptr + i));
-        // First bit should always be 1
-        if (i == 0)
-        {
-          if (in_data != 1)
-            _n_errors++;
-        }
-        else
-        {
-          def_bit(out_buffer, n_ptr * 4 + (i - 1), in_data);
-        }
-      }
-    }
-    if (n_errors != 0)
-      *n_errors = _n_errors;
-  }
-
-  void Encode(uint8_t *in_buffer, uint8_t *out_buffer, uint8_t length)
-  {
-    uint8_t out_ptr = 0;
-    for (uint8_t i = 0; i < length * 8; i++)
-    {
-      // First bit before a nibble needs to be a '1'
-      if (i % 4 == 0)
-      {
-        set_bit(out_buffer, out_ptr++);
-      }
-      def_bit(out_buffer, out_ptr++, get_bit(in_buffer, i));
-    }
-    // Set last bit
-    set_bit(out_buffer, out_ptr++);
-  }
-} // namespace LegrandProtocol
-
-Manager::Manager(uint8_t ssPin, uint8_t irqPin) : m_radio(ssPin, 255, irqPin), // Not using GDO0
+Manager::Manager(uint8_t ssPin, uint8_t irqPin) : Protocol::Manager(irqPin, c_serialChannel),
+                                                  m_radio(ssPin, 255, irqPin), // Not using GDO0
                                                   m_isPacketAvailable(false),
-                                                  m_irqPin(irqPin),
                                                   m_rxBufferCount(0),
                                                   m_isRawDataAvailable(false),
-                                                  m_debugLevel(0)
+                                                  m_frameStartTime(0),
+                                                  m_rawDataTime(0),
+                                                  m_frameRssi(0),
+                                                  m_rawDataRssi(0),
+                                                  m_lastRssi(0),
+                                                  m_bindings(this),
+                                                  m_gestures(this)
 {
 }
 
@@ -192,6 +96,11 @@ void Manager::begin()
 
 void Manager::rfRxCallback()
 {
+  if (this->m_rxBufferCount == 0)
+  {
+    this->m_frameStartTime = Clock::now();
+    this->m_frameRssi = this->m_radio.readStatus(CC1101::StatusRegister::RSSI);
+  }
   this->m_isRawDataAvailable = false;
   uint8_t count = this->m_radio.getNumRxBytes();
   this->m_radio.readRxFifo(this->m_rxBuffer + this->m_rxBufferCount, count);
@@ -200,6 +109,8 @@ void Manager::rfRxCallback()
   if (this->m_rxBufferCount >= c_rfRxPacketSize)
   {
     this->m_isRawDataAvailable = true;
+    this->m_rawDataTime = this->m_frameStartTime;
+    this->m_rawDataRssi = this->m_frameRssi;
     this->m_rxBufferCount = 0;
     this->m_radio.writeStrobe(CC1101::StrobeCommand::SFRX);
     this->m_radio.goReceive();
@@ -220,110 +131,50 @@ bool Manager::isPacketAvailable()
     /** A raw packet has been received, try to decode it to check for validity
      *  This function will be called from the main loop before accessing the packet data
      *  and it is preferable to perform decoding here than in the interrupt handler  */
-    uint8_t manDecBuffer[12];
-    uint8_t decodeErrorCount = 0;
-
-    // Decode the manchester-encoded data stream
-    Manchester::Decode(this->m_rxBuffer, manDecBuffer, 60, 2, &decodeErrorCount);
-    if (decodeErrorCount != 0)
+    uint8_t rawData[c_maxRawPacketSize];
+    uint8_t length;
+    uint8_t detail;
+    switch (decodeFrame(this->m_rxBuffer, rawData, &length, &detail))
     {
-      if (m_debugLevel)
-      {
-        Serial.print(F("Manchester decoding errors: "));
-        Serial.println(decodeErrorCount);
-      }
+    case DecodeStatus::Ok:
+      break;
+    case DecodeStatus::ManchesterErrors:
+      LOG_INFO(ManchesterErrors, detail);
       goto Epilogue;
-    }
-
-    uint8_t legDecBuffer[9];
-    uint8_t length = 6;
-    // Try to decode the first 6 bytes of the InOne message (we do not know the actual length yet !)
-    LegrandProtocol::Decode(manDecBuffer, legDecBuffer, length, &decodeErrorCount);
-    if (decodeErrorCount != 0)
-    {
-      if (m_debugLevel)
-      {
-        Serial.print(F("Framing errors: "));
-        Serial.println(decodeErrorCount);
-      }
+    case DecodeStatus::FramingErrors:
+      LOG_INFO(FramingErrors, detail);
       goto Epilogue;
-    }
-
-    // Compute the number of extra bytes
-    uint8_t extraByteCount = 0;
-    switch ((legDecBuffer[4] & 0xC0) >> 6)
-    {
-    case 0:
-      break;
-    case 1:
-      extraByteCount = 1;
-      break;
-    case 2:
-      extraByteCount = 3;
-      break;
-    default:
-      if (m_debugLevel)
-      {
-        Serial.println(F("Incorrect extra byte count !"));
-      }
+    case DecodeStatus::ExtraByteCount:
+      LOG_INFO(ExtraByteCount, detail);
       goto Epilogue;
-    }
-    if (extraByteCount)
-    {
-      // Decode the extra message bytes
-      Manchester::Decode(this->m_rxBuffer, manDecBuffer, 10 * extraByteCount, 62, &decodeErrorCount);
-      if (decodeErrorCount != 0)
-      {
-        if (m_debugLevel)
-        {
-          Serial.print(F("Manchester decoding errors in extra byte processing: "));
-          Serial.println(decodeErrorCount);
-        }
-        goto Epilogue;
-      }
-      LegrandProtocol::Decode(manDecBuffer, &legDecBuffer[6], extraByteCount, &decodeErrorCount);
-      if (decodeErrorCount != 0)
-      {
-        if (m_debugLevel)
-        {
-          Serial.print(F("Framing errors in extra byte processing: "));
-          Serial.println(decodeErrorCount);
-        }
-        goto Epilogue;
-      }
-      length += extraByteCount;
-    }
-
-    // Compute and check the packet checksum
-    uint8_t checksum = Packet::checksum(legDecBuffer, length - 1);
-    if (checksum != legDecBuffer[length - 1])
-    {
-      if (m_debugLevel)
-      {
-        Serial.print("Checksum fail. RX: ");
-        Serial.print(legDecBuffer[length - 1], HEX);
-        Serial.print(", calc: ");
-        Serial.println(checksum, HEX);
-      }
+    case DecodeStatus::ExtraManchesterErrors:
+      LOG_INFO(ExtraManchesterErrors, detail);
+      goto Epilogue;
+    case DecodeStatus::ExtraFramingErrors:
+      LOG_INFO(ExtraFramingErrors, detail);
+      goto Epilogue;
+    case DecodeStatus::ChecksumFail:
+      LOG_INFO(ChecksumFail, rawData[length - 1], detail);
       goto Epilogue;
     }
-    if (m_debugLevel > 1)
-    {
-      Serial.print("Raw Data: ");
-      for (uint8_t i = 0; i < length; i++)
-      {
-        Serial.print(legDecBuffer[i], HEX);
-        Serial.print(' ');
-      }
-      Serial.println();
-    }
+    LOG_DEBUG_BYTES(RxRawData, rawData, length);
     // Convert raw data to packet
-    Packet::fromRaw(&this->m_lastRxPacket, legDecBuffer, length);
+    Packet::fromRaw(&this->m_lastRxPacket, rawData, length);
+    this->m_lastPacketTimes.received = this->m_rawDataTime;
+    this->m_lastPacketTimes.decoded = Clock::now();
+    this->m_lastRssi = CC1101::rssiToDbm(this->m_rawDataRssi);
     this->m_isPacketAvailable = true;
     returnValue = true;
   }
 
 Epilogue:
+  return returnValue;
+}
+
+/* Called periodically while the radio is attached: the rf task only runs when the radio interrupt signals it,
+ * which also refreshes the last reception time */
+void Manager::poll()
+{
   // If last received data was more than 600ms ago, reset the packet receiver
   if (millis() - this->m_lastRxTime > 600)
   {
@@ -332,8 +183,6 @@ Epilogue:
     this->m_radio.goReceive();
     this->m_lastRxTime = millis();
   }
-
-  return returnValue;
 }
 
 void Manager::getLastPacket(Packet *packet)
@@ -342,86 +191,80 @@ void Manager::getLastPacket(Packet *packet)
   this->m_isPacketAvailable = false;
 }
 
+void Manager::printLastPacket()
+{
+  Packet rxPacket;
+  this->getLastPacket(&rxPacket);
+  // Local bindings react before the host is notified
+  this->m_bindings.process(&rxPacket, this->m_lastPacketTimes.decoded);
+  // Switch frames are reported as gestures when enabled by the host
+  if (this->m_gestures.process(&rxPacket, &this->m_lastPacketTimes))
+    return;
+  this->printSerialPrefix();
+  SerialParser::print(&rxPacket);
+  this->printSerialSuffix(&this->m_lastPacketTimes);
+}
+
+void Manager::processSerialCommand(const char *message)
+{
+  SerialLine::Parser parser(message);
+  if (parser.readKeyword(F("bind")))
+  {
+    this->m_bindings.processSerialCommand(&parser);
+    return;
+  }
+  if (parser.readKeyword(F("gesture")))
+  {
+    this->m_gestures.processSerialCommand(&parser);
+    return;
+  }
+
+  Packet packet;
+  if (SerialParser::parseMessage(&parser, &packet))
+  {
+    this->m_bindings.assignSequence(&packet);
+    this->sendPacket(&packet);
+  }
+}
+
 void Manager::sendPacket(Packet *packet)
 {
-  if (m_debugLevel > 1)
-    packet->print();
+  LOG_DEBUG(TxPacket, packet->id >> 16, packet->id & 0xFFFF, (uint8_t)packet->channel, (uint8_t)packet->command);
 
   /* Messages to be transmitted are between 6 and 9 bytes long */
   uint8_t rawData[9];
   uint8_t length = packet->toRaw(rawData);
-
-  if (m_debugLevel > 1)
-  {
-    Serial.print("Raw Data: ");
-    for (uint8_t i = 0; i < length; i++)
-    {
-      Serial.print(rawData[i], HEX);
-      Serial.print(' ');
-    }
-    Serial.println();
-  }
+  LOG_DEBUG_BYTES(TxRawData, rawData, length);
 
   // Frame each nibble in the packet with high bits
   uint8_t legEncData[12];
   LegrandProtocol::Encode(rawData, legEncData, length);
 
-  if (m_debugLevel > 2)
-  {
-    Serial.print("Framed Data: ");
-    for (uint8_t i = 0; i < length * 10 / 8; i++)
-    {
-      Serial.print(legEncData[i], HEX);
-      Serial.print(' ');
-    }
-    Serial.println();
-  }
+  LOG_TRACE_BYTES(TxFramedData, legEncData, length * 10 / 8);
 
   // Encode the radio data with Manchester encoding
-  uint8_t manEncData[64];
-  memset(manEncData, 0, 64);
-  // Position the first nibble of the manchester-encoded data to the 5th nibble of the sync word 83E0F
-  manEncData[0] = 0xF0;
-  // Manchester-encode the framed data, start outputting at the 5th bit (because of the sync nibble)
-  Manchester::Encode(legEncData, manEncData, length * 10 + 1, 4);
-
-  /** In order to improve link relability, the message is transmitted multiple times over the air
-   *  Because the nibble count is odd, we cannot just repeat the previous message bytes, so we insert
-   *  a second sync word and manchester-encoded data */
-  uint8_t nibbleCount = (length * 10 + 1) / 2 + 1;
-
-  // Insert sync word
-  setNibble(manEncData, nibbleCount + 0, 0x8, true);
-  setNibble(manEncData, nibbleCount + 1, 0x3, true);
-  setNibble(manEncData, nibbleCount + 2, 0xE, true);
-  setNibble(manEncData, nibbleCount + 3, 0x0, true);
-  setNibble(manEncData, nibbleCount + 4, 0xF, true);
-  nibbleCount += 5;
-  // Insert manchester-encoded data again
-  Manchester::Encode(legEncData, manEncData, length * 10 + 1, nibbleCount * 4);
-  nibbleCount += (length * 10 + 1) / 2;
+  uint8_t manEncData[c_rfTxFrameSize];
+  uint8_t nibbleCount = encodeFrame(legEncData, length, manEncData);
 
-  if (m_debugLevel > 2)
-  {
-    Serial.println("Data to send: ");
-    for (uint8_t i = 0; i < nibbleCount / 2; i++)
-    {
-      Serial.print(manEncData[i], HEX);
-      Serial.print(' ');
-    }
-  }
+  LOG_TRACE_BYTES(TxEncodedData, manEncData, nibbleCount / 2);
 
-  // Send packet using the CC1101 radio
+  // Send packet using the CC1101 radio, which may be shared with another protocol
+  // Packets are also sent from the timers and the keypad, whatever protocol is listening
+  SerialLine::holdInput();
+  this->acquireRadio();
   this->m_radio.writeRegister(CC1101::Register::MDMCFG2, 0x2);
   this->m_radio.writeRegister(CC1101::Register::PKTLEN, nibbleCount);
   this->m_radio.writeTxFifo((uint8_t *)&manEncData, nibbleCount / 2);
   this->m_radio.writeTxFifo((uint8_t *)&manEncData, nibbleCount / 2);
-  this->m_radio.goTransmit();
+  // Wait for a wall switch to finish transmitting before sending, rather than colliding with it
+  this->m_radio.goTransmitWhenClear();
 
   // Restore RX mode settings and go to Receive mode
   this->m_radio.writeRegister(CC1101::Register::MDMCFG2, 0x6);
   this->m_radio.writeRegister(CC1101::Register::PKTLEN, c_rfRxPacketSize);
   this->m_radio.goReceive();
+  this->releaseRadio();
+  SerialLine::releaseInput();
 }
 
 void Manager::detachRadio()
@@ -430,5 +273,7 @@ void Manager::detachRadio()
 
 void Manager::attachRadio()
 {
+  // Drop any partial frame received before the radio was detached
+  this->m_rxBufferCount = 0;
   this->begin();
 }
\ No newline at end of file
@@ -2,14 +2,19 @@
 #define _INONEMANAGER_H
 
 #include "InOne.h"
+#include "InOneCodec.h"
 #include "CC1101.h"
+#include "Protocol.h"
+#include "InOneBinding.h"
+#include "InOneGesture.h"
 
 namespace InOne
 {
 
-  const uint8_t c_rfRxPacketSize = 60;
+  // InOne lines are prefixed with "0>" on the serial link
+  const uint8_t c_serialChannel = 0;
 
-  class Manager
+  class Manager : public Protocol::Manager
   {
   public:
     Manager(uint8_t ssPin, uint8_t irqPin);
@@ -20,23 +25,41 @@ namespace InOne
     void getLastPacket(Packet *packet);
     void sendPacket(Packet *packet);
 
+    void printLastPacket();
+    void processSerialCommand(const char *message);
+
     void rfRxCallback();
+    void poll();
 
     void detachRadio();
     void attachRadio();
 
     CC1101::Radio *radio() { return &this->m_radio; };
+    const __FlashStringHelper *name() { return F("inone"); };
+    BindingTable *bindings() { return &this->m_bindings; };
+    GestureTable *gestures() { return &this->m_gestures; };
+    // Last decoded packet and its signal strength in dBm, still valid after getLastPacket()
+    const Packet *lastPacket() { return &this->m_lastRxPacket; };
+    int8_t lastRssi() { return this->m_lastRssi; };
 
   protected:
     CC1101::Radio m_radio;
-    uint8_t m_irqPin;
     Packet m_lastRxPacket;
     bool m_isPacketAvailable;
     uint8_t m_rxBuffer[c_rfRxPacketSize];
     uint8_t m_rxBufferCount;
     bool m_isRawDataAvailable;
     uint32_t m_lastRxTime;
-    uint8_t m_debugLevel;
+    // First radio interrupt of the frame being received, and of the last complete frame
+    Clock::Timestamp m_frameStartTime;
+    Clock::Timestamp m_rawDataTime;
+    // Raw RSSI read at the first radio interrupt of the frame, and of the last complete frame
+    uint8_t m_frameRssi;
+    uint8_t m_rawDataRssi;
+    int8_t m_lastRssi;
+    Clock::PacketTimes m_lastPacketTimes;
+    BindingTable m_bindings;
+    GestureTable m_gestures;
   };
 
 } // namespace InOne
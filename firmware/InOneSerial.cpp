@@ -0,0 +1,169 @@
+#include <Arduino.h>
+#include "InOneSerial.h"
+#include "SerialLine.h"
+
+using namespace InOne;
+using SerialLine::packetOutput;
+using SerialLine::debugOutput;
+
+/* Command format: <sequence>,<id>,<channel>,<command>[,[L][,<data0>[,<data1>,<data2>]]]
+ * The learn flag field is also present (possibly empty) before the data of medium and long packets */
+bool SerialParser::parseMessage(SerialLine::Parser *parser, Packet *packet)
+{
+  uint8_t channel;
+  uint8_t command;
+  if (!parser->readUInt(&packet->sequenceIndex, 3) ||
+      !parser->readUInt(&packet->id, c_maxId) ||
+      !parser->readUInt(&channel, (uint8_t)Channel::Right) ||
+      !parser->readUInt(&command, 0xF))
+  {
+    parser->printError();
+    return false;
+  }
+  packet->channel = (Channel)channel;
+  packet->command = (Command)command;
+  packet->isLearnMode = false;
+  packet->type = PacketType::Short;
+  if (parser->isEndOfRecord())
+    return true;
+
+  const char *flag;
+  uint8_t length;
+  parser->readToken(&flag, &length);
+  if (length > 1 || (length == 1 && flag[0] != 'L'))
+  {
+    packetOutput.println(F("Learn flag must be 'L' or empty."));
+    return false;
+  }
+  packet->isLearnMode = length == 1;
+  packet->type = PacketType::Medium;
+  packet->data[0] = 0;
+  if (parser->isEndOfRecord())
+    return true;
+
+  if (!parser->readUInt(&packet->data[0], 0xFF))
+  {
+    parser->printError();
+    return false;
+  }
+  if (parser->isEndOfRecord())
+    return true;
+
+  packet->type = PacketType::Long;
+  if (!parser->readUInt(&packet->data[1], 0xFF) || !parser->readUInt(&packet->data[2], 0xFF))
+  {
+    parser->printError();
+    return false;
+  }
+  return true;
+}
+
+void SerialParser::print(const Packet *packet)
+{
+  packetOutput.print(packet->sequenceIndex);
+  packetOutput.print(',');
+  packetOutput.print(packet->id);
+  packetOutput.print(',');
+  packetOutput.print((uint8_t)packet->channel);
+  packetOutput.print(',');
+  packetOutput.print((uint8_t)packet->command);
+  if (packet->isLearnMode || packet->type != PacketType::Short)
+    packetOutput.print(',');
+  if (packet->isLearnMode)
+    packetOutput.print('L');
+  if (packet->type != PacketType::Short)
+  {
+    packetOutput.print(',');
+    packetOutput.print(packet->data[0]);
+  }
+  if (packet->type == PacketType::Long)
+  {
+    packetOutput.print(',');
+    packetOutput.print(packet->data[1]);
+    packetOutput.print(',');
+    packetOutput.print(packet->data[2]);
+  }
+}
+
+void Packet::print()
+{
+  debugOutput.print(F("Sequence index: "));
+  debugOutput.println(this->sequenceIndex);
+  debugOutput.print(F("Switch ID: "));
+  debugOutput.println(this->id, DEC);
+  debugOutput.print(F("Channel: "));
+  switch (this->channel)
+  {
+  case Channel::Learn:
+    debugOutput.println(F("LEARN "));
+    break;
+  case Channel::Left:
+    debugOutput.println(F("LEFT "));
+    break;
+  case Channel::Right:
+    debugOutput.println(F("RIGHT "));
+    break;
+  }
+  debugOutput.print(F("Command: "));
+  switch (this->command)
+  {
+  case Command::Learn:
+    debugOutput.println(F("LEARN "));
+    break;
+  case Command::On:
+    debugOutput.println(F("ON "));
+    break;
+  case Command::Off:
+    debugOutput.println(F("OFF "));
+    break;
+  case Command::DimStart:
+    debugOutput.println(F("STARTVAR "));
+    break;
+  case Command::DimStop:
+    debugOutput.println(F("STOPVAR "));
+    break;
+  }
+  debugOutput.print(F("Packet Type: "));
+  switch (this->type)
+  {
+  case PacketType::Short:
+    debugOutput.println(F("SHORT "));
+    break;
+  case PacketType::Medium:
+    debugOutput.println(F("MEDIUM "));
+    break;
+  case PacketType::Long:
+    debugOutput.println(F("LONG "));
+    break;
+  }
+
+  if (this->isLearnMode)
+  {
+    debugOutput.print(F("Learning mode: "));
+    if (this->data[0] == 0x7)
+      debugOutput.println(F("exiting."));
+    else if (this->data[0] == 0x6)
+    {
+      debugOutput.print(F("command "));
+      debugOutput.println(this->data[1]);
+    }
+    else
+      debugOutput.println(F("entering."));
+  }
+
+  switch (this->type)
+  {
+  case PacketType::Medium:
+    debugOutput.print(F("Data: "));
+    debugOutput.println(this->data[0]);
+    break;
+  case PacketType::Long:
+    debugOutput.print(F("Data: "));
+    debugOutput.print(this->data[0], DEC);
+    debugOutput.print(' ');
+    debugOutput.print(this->data[1], DEC);
+    debugOutput.print(' ');
+    debugOutput.println(this->data[2], DEC);
+    break;
+  }
+}
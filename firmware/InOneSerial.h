@@ -0,0 +1,18 @@
+#ifndef _INONESERIAL_H
+#define _INONESERIAL_H
+
+#include "InOne.h"
+#include "SerialLine.h"
+
+namespace InOne
+{
+  class SerialParser
+  {
+  public:
+    static bool parseMessage(SerialLine::Parser *parser, Packet *packet);
+    // Print the packet fields, the caller ends the line
+    static void print(const Packet *packet);
+  };
+} // namespace InOne
+
+#endif //_INONESERIAL_H
@@ -1,10 +1,14 @@
 #include "InOneSwitch.h"
+#include "InOneManager.h"
 
 using namespace InOne;
 
 Switch::Switch(uint32_t id, Manager *manager) : m_manager(manager),
                                                 m_sequence(0),
-                                                m_learnChannel(Channel::Learn)
+                                                m_learnChannel(Channel::Learn),
+                                                m_learnTimer(onLearnTimeout, this),
+                                                m_dimChannel(Channel::Learn),
+                                                m_dimTimer(onDimTimeout, this)
 {
   m_packet.id = id;
   m_packet.isLearnMode = false;
@@ -25,6 +29,7 @@ void Switch::channelShortPress(Channel channel, Command command)
 {
   if (isLearning)
   {
+    m_learnTimer.start(c_learnTimeoutMs);
     if (m_learnChannel == Channel::Learn || m_learnChannel == channel)
     {
       this->m_learnChannel = channel;
@@ -44,6 +49,7 @@ void Switch::startLearn()
     this->m_packet.isLearnMode = true;
     isLearning = true;
     m_learnChannel = Channel::Learn;
+    m_learnTimer.start(c_learnTimeoutMs);
     mediumMessage(Channel::Learn, Command::Learn, 0);
   }
 }
@@ -54,6 +60,7 @@ void Switch::stopLearn()
   if (isLearning)
   {
     isLearning = false;
+    m_learnTimer.stop();
     // If at least one button was pressed, send the exit learning mode message
     if (m_learnChannel != Channel::Learn)
     {
@@ -65,15 +72,55 @@ void Switch::stopLearn()
   this->m_packet.isLearnMode = false;
 }
 
+void Switch::onLearnTimeout(Timer::Monostable *, void *context)
+{
+  ((Switch *)context)->stopLearn();
+}
+
+/* A dim ramp is a single dim start frame: the receivers keep ramping until the dim stop frame */
+void Switch::startDim(Channel channel, int8_t direction, uint16_t durationMs)
+{
+  // Dimming is not part of the learn sequence
+  if (isLearning)
+    return;
+  if (this->m_dimChannel != Channel::Learn && this->m_dimChannel != channel)
+    this->stopDim();
+  this->m_dimChannel = channel;
+  this->m_dimTimer.start(durationMs);
+  this->longMessage(channel, Command::DimStart, (uint8_t)direction, 0, 0);
+}
+
+void Switch::stopDim()
+{
+  if (this->m_dimChannel == Channel::Learn)
+    return;
+  this->m_dimTimer.stop();
+  this->shortMessage(this->m_dimChannel, Command::DimStop);
+  this->m_dimChannel = Channel::Learn;
+}
+
+void Switch::onDimTimeout(Timer::Monostable *, void *context)
+{
+  ((Switch *)context)->stopDim();
+}
+
 void Switch::updateSequence()
 {
-  m_packet.sequenceIndex = (m_sequence >> 2 * (uint8_t)m_packet.channel) & 0x3;
-  uint8_t sequenceIndex = (m_packet.sequenceIndex + 1) & 0x3;
+  this->assignSequence(&m_packet);
+}
+
+/* Number a packet with our ID in our own sequence. Packets sent by the host for this ID are numbered
+ * here too, so that the receivers never drop the next packet of either as a repeat */
+void Switch::assignSequence(Packet *packet)
+{
+  uint8_t shift = 2 * (uint8_t)packet->channel;
+  packet->sequenceIndex = (m_sequence >> shift) & 0x3;
+  uint8_t sequenceIndex = (packet->sequenceIndex + 1) & 0x3;
   // Do not change sequence index for learning mode enter and exit packets
-  if (m_packet.channel == Channel::Learn && m_packet.command == Command::Learn && m_packet.data[0] == 0)
-    sequenceIndex = m_packet.sequenceIndex;
-  m_sequence &= ~(0x3 << (2 * (uint8_t)m_packet.channel));
-  m_sequence |= sequenceIndex << (2 * (uint8_t)m_packet.channel);
+  if (packet->channel == Channel::Learn && packet->command == Command::Learn && packet->data[0] == 0)
+    sequenceIndex = packet->sequenceIndex;
+  m_sequence &= ~(0x3 << shift);
+  m_sequence |= sequenceIndex << shift;
 }
 
 void Switch::shortMessage(Channel channel, Command command)
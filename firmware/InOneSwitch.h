@@ -2,15 +2,31 @@
 #define _INONESWITCH_H
 
 #include "InOne.h"
-#include "InOneManager.h"
+#include "TimerWheel.h"
 
 namespace InOne
 {
 
+  // Learn mode is left automatically after this time without button press
+  const uint16_t c_learnTimeoutMs = 30000;
+  // Dim ramps are stopped after this time at most, in case the stop request is lost
+  const uint16_t c_maxDimMs = 10000;
+  // Dim start data: the receivers ramp up towards on, or down towards off
+  const int8_t c_dimUp = 127;
+  const int8_t c_dimDown = -128;
+
+  class Manager;
+
   class Switch
   {
   public:
-    Switch(uint32_t id, Manager *manager);
+    Switch(uint32_t id = 0, Manager *manager = 0);
+
+    uint32_t id() { return this->m_packet.id; };
+    void setId(uint32_t id) { this->m_packet.id = id; };
+    void setManager(Manager *manager) { this->m_manager = manager; };
+    void assignSequence(Packet *packet);
+    const Packet *lastPacket() { return &this->m_packet; };
 
     void turnOn(Channel channel);
     void turnOff(Channel channel);
@@ -20,10 +36,15 @@ namespace InOne
 
     bool isLearnMode() { return this->m_packet.isLearnMode; };
 
-    void startDim(Channel channel, int8_t value);
-    void stopDim(Channel channel, int8_t value);
+    // Ramp the receivers of a channel in a direction (c_dimUp or c_dimDown) until stopDim() or the duration elapses
+    void startDim(Channel channel, int8_t direction, uint16_t durationMs = c_maxDimMs);
+    void stopDim();
+    bool isDimming() { return this->m_dimChannel != Channel::Learn; };
 
   private:
+    static void onLearnTimeout(Timer::Monostable *timer, void *context);
+    static void onDimTimeout(Timer::Monostable *timer, void *context);
+
     void updateSequence();
 
     void channelShortPress(Channel channel, Command command);
@@ -35,6 +56,10 @@ namespace InOne
     Packet m_packet;
     uint8_t m_sequence;
     Channel m_learnChannel;
+    Timer::Monostable m_learnTimer;
+    // Channel of the running dim ramp, Learn if none
+    Channel m_dimChannel;
+    Timer::Monostable m_dimTimer;
     Manager *m_manager;
   };
 
@@ -0,0 +1,111 @@
+#include <avr/interrupt.h>
+#include "Keypad.h"
+
+using namespace Keypad;
+
+// Updated from the ADC interrupt handler
+static Button s_candidate;
+static uint8_t s_candidateCount;
+static Button s_stable;
+static uint16_t s_heldSamples;
+static volatile Event s_events[c_eventQueueSize];
+static volatile uint8_t s_eventHead;
+static volatile uint8_t s_eventCount;
+
+// Resistor ladder thresholds of the shield
+static Button classify(uint16_t value)
+{
+  if (value < 50)
+    return Button::Right;
+  else if (value < 200)
+    return Button::Up;
+  else if (value < 350)
+    return Button::Down;
+  else if (value < 500)
+    return Button::Left;
+  else if (value < 850)
+    return Button::Select;
+  return Button::None;
+}
+
+// Called with interrupts masked
+static void pushEvent(Button button, EventType type, uint16_t heldSamples)
+{
+  if (s_eventCount == c_eventQueueSize)
+    return;
+  volatile Event *event = &s_events[(s_eventHead + s_eventCount) % c_eventQueueSize];
+  event->button = button;
+  event->type = type;
+  event->heldSamples = heldSamples;
+  s_eventCount++;
+}
+
+void Keypad::begin()
+{
+  s_candidate = Button::None;
+  s_candidateCount = 0;
+  s_stable = Button::None;
+  s_eventHead = 0;
+  s_eventCount = 0;
+
+  // AVcc reference, channel ADC0 (A0), whose digital input buffer is not needed
+  ADMUX = 1 << REFS0;
+  DIDR0 = 1 << ADC0D;
+  // Auto trigger source: Timer0 overflow
+  ADCSRB = 1 << ADTS2;
+  // Prescaler 128: 125 kHz ADC clock, 104 us conversions
+  ADCSRA = (1 << ADEN) | (1 << ADATE) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+}
+
+bool Keypad::read(Event *event)
+{
+  uint8_t sreg = SREG;
+  cli();
+  bool isAvailable = s_eventCount != 0;
+  if (isAvailable)
+  {
+    volatile Event *head = &s_events[s_eventHead];
+    event->button = head->button;
+    event->type = head->type;
+    event->heldSamples = head->heldSamples;
+    s_eventHead = (s_eventHead + 1) % c_eventQueueSize;
+    s_eventCount--;
+  }
+  SREG = sreg;
+  return isAvailable;
+}
+
+ISR(ADC_vect)
+{
+  Button button = classify(ADC);
+
+  if (s_stable != Button::None && s_heldSamples < 0xFFFF)
+  {
+    s_heldSamples++;
+    if (s_heldSamples == c_longPressSamples)
+      pushEvent(s_stable, EventType::LongPress, s_heldSamples);
+  }
+
+  // A change is accepted once the new value has been read c_debounceSamples times in a row
+  if (button == s_stable)
+  {
+    s_candidateCount = 0;
+    return;
+  }
+  if (button != s_candidate)
+  {
+    s_candidate = button;
+    s_candidateCount = 0;
+  }
+  if (++s_candidateCount < c_debounceSamples)
+    return;
+
+  // Moving directly from one button to another is a release followed by a press
+  if (s_stable != Button::None)
+    pushEvent(s_stable, EventType::Release, s_heldSamples);
+  s_stable = button;
+  s_heldSamples = 0;
+  s_candidateCount = 0;
+  if (button != Button::None)
+    pushEvent(button, EventType::Press, 0);
+}
@@ -0,0 +1,52 @@
+#ifndef _KEYPAD_H
+#define _KEYPAD_H
+
+#include <Arduino.h>
+
+/** Buttons of the DFRobot LCD-keypad shield, a resistor ladder on A0
+ *  The ADC is auto-triggered by the Timer0 overflow (every 1.024 ms, Timer0 also drives millis()), and the
+ *  conversion complete interrupt debounces the samples: the main loop never waits for a conversion */
+namespace Keypad
+{
+
+  // Consecutive identical samples (about 1 ms apart) before a button change is accepted
+  const uint8_t c_debounceSamples = 16;
+  // Samples a button is held before a long press is reported
+  const uint16_t c_longPressSamples = 800;
+  const uint8_t c_eventQueueSize = 8;
+
+  enum class Button : uint8_t
+  {
+    None,
+    Up,
+    Down,
+    Left,
+    Right,
+    Select
+  };
+
+  enum class EventType : uint8_t
+  {
+    // Debounced press, reported at once
+    Press,
+    // Still held after c_longPressSamples, reported once per press
+    LongPress,
+    // Release, after a long press or not
+    Release
+  };
+
+  struct Event
+  {
+    Button button;
+    EventType type;
+    // Held duration of a release, in samples
+    uint16_t heldSamples;
+  };
+
+  void begin();
+  // Next event, false if none. Events are dropped when the queue is full
+  bool read(Event *event);
+
+} // namespace Keypad
+
+#endif //_KEYPAD_H
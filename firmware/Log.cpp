@@ -0,0 +1,93 @@
+#include "Log.h"
+#include "SerialLine.h"
+
+using namespace Log;
+using SerialLine::debugOutput;
+
+static Record s_records[c_logRingSize];
+static uint8_t s_head = 0;
+static uint8_t s_count = 0;
+static uint16_t s_droppedCount = 0;
+
+void Log::write(Message id, uint8_t argCount, uint16_t arg0, uint16_t arg1, uint16_t arg2, uint16_t arg3)
+{
+  uint8_t sreg = SREG;
+  cli();
+  if (s_count == c_logRingSize)
+    s_droppedCount++;
+  else
+  {
+    Record *record = &s_records[s_head];
+    s_head = (s_head + 1) % c_logRingSize;
+    s_count++;
+    record->id = id;
+    record->argCount = argCount;
+    record->time = millis();
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+    record->args[3] = arg3;
+  }
+  SREG = sreg;
+}
+
+void Log::writeBytes(Message id, const uint8_t *data, uint8_t length)
+{
+  for (uint8_t offset = 0; offset < length; offset += 6)
+  {
+    uint16_t words[3] = {0, 0, 0};
+    for (uint8_t i = 0; i < 6 && offset + i < length; i++)
+      words[i / 2] |= data[offset + i] << (i & 1 ? 0 : 8);
+    write(id, 4, offset, words[0], words[1], words[2]);
+  }
+}
+
+static void printRecord(const Record *record)
+{
+  debugOutput.print('!');
+  debugOutput.print((uint8_t)record->id, HEX);
+  debugOutput.print(',');
+  debugOutput.print(record->time, HEX);
+  for (uint8_t i = 0; i < record->argCount; i++)
+  {
+    debugOutput.print(',');
+    debugOutput.print(record->args[i], HEX);
+  }
+  debugOutput.println();
+}
+
+void Log::flush()
+{
+  Record record;
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t droppedCount = s_droppedCount;
+  s_droppedCount = 0;
+  SREG = sreg;
+
+  if (droppedCount != 0)
+  {
+    record.id = Message::Overflow;
+    record.argCount = 1;
+    record.time = millis();
+    record.args[0] = droppedCount;
+    printRecord(&record);
+  }
+
+  while (true)
+  {
+    sreg = SREG;
+    cli();
+    bool isRecordAvailable = s_count != 0;
+    if (isRecordAvailable)
+    {
+      record = s_records[(s_head + c_logRingSize - s_count) % c_logRingSize];
+      s_count--;
+    }
+    SREG = sreg;
+
+    if (!isRecordAvailable)
+      return;
+    printRecord(&record);
+  }
+}
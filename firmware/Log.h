@@ -0,0 +1,87 @@
+#ifndef _LOG_H
+#define _LOG_H
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+// Log points above this level are removed at compile time
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_WARNING
+#endif
+
+namespace Log
+{
+
+  const uint8_t c_maxLogArgs = 4;
+  // Records waiting to be flushed, newer records are dropped when full
+  const uint8_t c_logRingSize = 8;
+
+  enum class Message : uint8_t
+  {
+#define LOG_MESSAGE(id, format) id,
+#include "LogMessages.h"
+#undef LOG_MESSAGE
+  };
+
+  /** Fixed-size log record: no formatting in the firmware, the host decoder turns it back into text */
+  struct Record
+  {
+    Message id;
+    uint8_t argCount;
+    uint16_t time;
+    uint16_t args[c_maxLogArgs];
+  };
+
+  // Store a record, safe to call from an interrupt handler
+  void write(Message id, uint8_t argCount, uint16_t arg0 = 0, uint16_t arg1 = 0, uint16_t arg2 = 0, uint16_t arg3 = 0);
+  // Store a byte buffer as records of an offset and 3 big-endian words
+  void writeBytes(Message id, const uint8_t *data, uint8_t length);
+
+  // Print the pending records as "!<id>,<ms>,<arg>..." hex lines, called from the main loop
+  void flush();
+
+} // namespace Log
+
+#define LOG_WRITE(id, ...) Log::write(Log::Message::id, LOG_ARG_COUNT(__VA_ARGS__), ##__VA_ARGS__)
+#define LOG_ARG_COUNT(...) LOG_ARG_COUNT_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_ARG_COUNT_(_0, _1, _2, _3, _4, count, ...) count
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(id, ...) LOG_WRITE(id, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(id, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+#define LOG_WARNING(id, ...) LOG_WRITE(id, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(id, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(id, ...) LOG_WRITE(id, ##__VA_ARGS__)
+#else
+#define LOG_INFO(id, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(id, ...) LOG_WRITE(id, ##__VA_ARGS__)
+#define LOG_DEBUG_BYTES(id, data, length) Log::writeBytes(Log::Message::id, data, length)
+#else
+#define LOG_DEBUG(id, ...) ((void)0)
+#define LOG_DEBUG_BYTES(id, data, length) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_TRACE_BYTES(id, data, length) Log::writeBytes(Log::Message::id, data, length)
+#else
+#define LOG_TRACE_BYTES(id, data, length) ((void)0)
+#endif
+
+#endif //_LOG_H
@@ -0,0 +1,15 @@
+/* Log message table, shared by the firmware (message IDs) and the host decoder (format strings)
+ * LOG_MESSAGE(<id>, <format>): the format takes up to c_maxLogArgs unsigned 16-bit arguments
+ * New messages are appended, so that the IDs of a running firmware still match the decoder */
+LOG_MESSAGE(Overflow, "%u log records dropped")
+LOG_MESSAGE(ManchesterErrors, "Manchester decoding errors: %u")
+LOG_MESSAGE(FramingErrors, "Framing errors: %u")
+LOG_MESSAGE(ExtraByteCount, "Incorrect extra byte count: %u")
+LOG_MESSAGE(ExtraManchesterErrors, "Manchester decoding errors in extra byte processing: %u")
+LOG_MESSAGE(ExtraFramingErrors, "Framing errors in extra byte processing: %u")
+LOG_MESSAGE(ChecksumFail, "Checksum fail. RX: %02X, calc: %02X")
+LOG_MESSAGE(RxRawData, "RX raw data +%u: %04X %04X %04X")
+LOG_MESSAGE(TxPacket, "TX packet id %X%04X, channel %u, command %u")
+LOG_MESSAGE(TxRawData, "TX raw data +%u: %04X %04X %04X")
+LOG_MESSAGE(TxFramedData, "TX framed data +%u: %04X %04X %04X")
+LOG_MESSAGE(TxEncodedData, "TX encoded data +%u: %04X %04X %04X")
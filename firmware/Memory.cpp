@@ -0,0 +1,55 @@
+#include "Memory.h"
+#include "SerialLine.h"
+
+using namespace Memory;
+using SerialLine::packetOutput;
+
+// Linker symbols: start of the static data, end of .bss, top of the RAM
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+// Top of the heap, NULL until the first malloc()
+extern char *__brkval;
+
+static uint8_t *heapEnd()
+{
+  return __brkval != NULL ? (uint8_t *)__brkval : &_end;
+}
+
+/* Runs from .init3, after the stack pointer is set and before the static constructors:
+ * the function has no frame, so it must not call anything or use the stack */
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack()
+{
+  for (uint8_t *p = &_end; p <= &__stack; p++)
+    *p = c_paintByte;
+}
+
+uint16_t Memory::freeStack()
+{
+  uint8_t top;
+  return &top - heapEnd();
+}
+
+uint16_t Memory::freeStackLowWater()
+{
+  const uint8_t *p = heapEnd();
+  uint16_t count = 0;
+  while (p + count <= &__stack && p[count] == c_paintByte)
+    count++;
+  return count;
+}
+
+void Memory::printReport()
+{
+  packetOutput.print(F("RAM: "));
+  packetOutput.print(&__stack - &__data_start + 1);
+  packetOutput.print(F(" bytes, static "));
+  packetOutput.print(&_end - &__data_start);
+  packetOutput.print(F(", heap "));
+  packetOutput.print(heapEnd() - &_end);
+  packetOutput.print(F(", free stack now/min "));
+  packetOutput.print(freeStack());
+  packetOutput.print('/');
+  packetOutput.println(freeStackLowWater());
+}
@@ -0,0 +1,22 @@
+#ifndef _MEMORY_H
+#define _MEMORY_H
+
+#include <Arduino.h>
+
+namespace Memory
+{
+
+  // Fill byte of the free RAM, painted at startup before the constructors run
+  const uint8_t c_paintByte = 0xC5;
+
+  // Free RAM between the heap (or the static data when there is no heap) and the stack
+  uint16_t freeStack();
+  // Smallest free RAM since startup: the painted bytes the stack has never reached
+  uint16_t freeStackLowWater();
+
+  // "memory" prints the RAM usage
+  void printReport();
+
+} // namespace Memory
+
+#endif //_MEMORY_H
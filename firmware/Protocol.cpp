@@ -0,0 +1,281 @@
+#include <Arduino.h>
+#include "Protocol.h"
+#include "SerialLine.h"
+
+using namespace Protocol;
+using SerialLine::packetOutput;
+
+void Manager::printSerialPrefix()
+{
+  packetOutput.print(this->m_serialChannel);
+  packetOutput.print('>');
+}
+
+/* "|<received>,<decode us>,<emit us>": the reception time in hex, then the decode and emit times
+ * in microseconds after it, which lets the host measure the latency of each packet.
+ * '@' would collide with the "<device>@<channel>" of the Ideo lines */
+void Manager::printSerialSuffix(const Clock::PacketTimes *times)
+{
+  Clock::Timestamp emitted = Clock::now();
+  packetOutput.print('|');
+  Clock::print(&packetOutput, times->received);
+  packetOutput.print(',');
+  packetOutput.print((uint32_t)(times->decoded - times->received));
+  packetOutput.print(',');
+  packetOutput.println((uint32_t)(emitted - times->received));
+}
+
+void Manager::acquireRadio()
+{
+  if (this->m_registry != NULL)
+    this->m_registry->acquireRadio(this);
+}
+
+void Manager::releaseRadio()
+{
+  if (this->m_registry != NULL)
+    this->m_registry->releaseRadio(this);
+}
+
+Registry::Registry() : m_count(0),
+                       m_attachedMask(0)
+{
+}
+
+bool Registry::add(Manager *manager)
+{
+  if (this->m_count >= c_maxManagers)
+    return false;
+  this->m_managers[this->m_count++] = manager;
+  manager->setRegistry(this);
+  return true;
+}
+
+void Registry::begin()
+{
+  for (uint8_t i = 0; i < this->m_count; i++)
+  {
+    if (this->defaultIndex(this->m_managers[i]->irqPin()) == i)
+    {
+      this->m_managers[i]->begin();
+      this->m_attachedMask |= 1 << i;
+    }
+  }
+}
+
+Manager *Registry::find(uint8_t serialChannel)
+{
+  for (uint8_t i = 0; i < this->m_count; i++)
+    if (this->m_managers[i]->serialChannel() == serialChannel)
+      return this->m_managers[i];
+  return NULL;
+}
+
+int8_t Registry::attachedIndex(uint8_t irqPin)
+{
+  for (uint8_t i = 0; i < this->m_count; i++)
+    if ((this->m_attachedMask & (1 << i)) && this->m_managers[i]->irqPin() == irqPin)
+      return i;
+  return -1;
+}
+
+bool Registry::isAttached(Manager *manager)
+{
+  int8_t index = this->indexOf(manager);
+  return index >= 0 && (this->m_attachedMask & (1 << index));
+}
+
+void Registry::acquireRadio(Manager *manager)
+{
+  int8_t index = this->indexOf(manager);
+  if (index >= 0)
+    this->switchRadio(index);
+}
+
+void Registry::releaseRadio(Manager *manager)
+{
+  int8_t index = this->defaultIndex(manager->irqPin());
+  if (index >= 0)
+    this->switchRadio(index);
+}
+
+void Registry::rfRxCallback(uint8_t irqPin)
+{
+  int8_t index = this->attachedIndex(irqPin);
+  if (index >= 0)
+    this->m_managers[index]->rfRxCallback();
+}
+
+int8_t Registry::indexOf(Manager *manager)
+{
+  for (uint8_t i = 0; i < this->m_count; i++)
+    if (this->m_managers[i] == manager)
+      return i;
+  return -1;
+}
+
+int8_t Registry::defaultIndex(uint8_t irqPin)
+{
+  for (uint8_t i = 0; i < this->m_count; i++)
+    if (this->m_managers[i]->irqPin() == irqPin)
+      return i;
+  return -1;
+}
+
+void Registry::switchRadio(uint8_t index)
+{
+  if (this->m_attachedMask & (1 << index))
+    return;
+
+  uint8_t irqPin = this->m_managers[index]->irqPin();
+  for (uint8_t i = 0; i < this->m_count; i++)
+  {
+    if ((this->m_attachedMask & (1 << i)) && this->m_managers[i]->irqPin() == irqPin)
+    {
+      // Radio interrupts are ignored until the new manager is attached
+      this->m_attachedMask &= ~(1 << i);
+      this->m_managers[i]->detachRadio();
+    }
+  }
+  this->m_managers[index]->attachRadio();
+  this->m_attachedMask |= 1 << index;
+}
+
+ListenScheduler::ListenScheduler(Registry *registry, uint8_t irqPin) : m_registry(registry),
+                                                                       m_irqPin(irqPin),
+                                                                       m_current(-1),
+                                                                       m_slotStartTime(0),
+                                                                       m_isSlotExtended(false)
+{
+  memset(this->m_slotDuration, 0, sizeof(this->m_slotDuration));
+  memset(this->m_listenTime, 0, sizeof(this->m_listenTime));
+  memset(this->m_packetCount, 0, sizeof(this->m_packetCount));
+  memset(this->m_extensionCount, 0, sizeof(this->m_extensionCount));
+}
+
+void ListenScheduler::setSlot(Manager *manager, uint16_t durationMs)
+{
+  int8_t index = this->m_registry->indexOf(manager);
+  if (index >= 0 && manager->irqPin() == this->m_irqPin)
+    this->m_slotDuration[index] = durationMs;
+}
+
+void ListenScheduler::update()
+{
+  uint32_t now = millis();
+  int8_t attached = this->m_registry->attachedIndex(this->m_irqPin);
+  if (attached < 0)
+    return;
+
+  // The radio was taken over outside of the scheduler (e.g. by a serial command): start a new slot
+  if (attached != this->m_current)
+  {
+    this->accountListenTime(now);
+    this->m_current = attached;
+  }
+
+  uint32_t elapsed = now - this->m_slotStartTime;
+  uint16_t slotDuration = this->m_slotDuration[this->m_current];
+  if (elapsed < slotDuration)
+    return;
+
+  // Look for the next protocol in the rotation
+  uint8_t count = this->m_registry->count();
+  int8_t next = -1;
+  for (uint8_t i = 1; i <= count && next < 0; i++)
+  {
+    uint8_t index = (this->m_current + i) % count;
+    if (this->m_slotDuration[index] != 0 && this->m_registry->get(index)->irqPin() == this->m_irqPin)
+      next = index;
+  }
+  // Nothing else to listen to, keep the current protocol for another slot
+  if (next < 0 || next == this->m_current)
+  {
+    this->accountListenTime(now);
+    return;
+  }
+
+  // Do not leave a protocol waiting for a response, it gives up after its own timeout
+  Manager *manager = this->m_registry->get(this->m_current);
+  if (manager->isBusy())
+    return;
+
+  // Do not cut a frame which has already started
+  if (slotDuration != 0 && elapsed < (uint32_t)(slotDuration + c_maxSlotExtensionMs) && manager->radio()->isReceiving())
+  {
+    if (!this->m_isSlotExtended)
+    {
+      this->m_isSlotExtended = true;
+      this->m_extensionCount[this->m_current]++;
+    }
+    return;
+  }
+
+  this->accountListenTime(now);
+  this->m_registry->acquireRadio(this->m_registry->get(next));
+  this->m_current = next;
+}
+
+void ListenScheduler::onPacket(Manager *manager)
+{
+  int8_t index = this->m_registry->indexOf(manager);
+  if (index >= 0)
+    this->m_packetCount[index]++;
+}
+
+// Share of part in total, without overflowing part * 100 after 12 hours
+static uint8_t percent(uint32_t part, uint32_t total)
+{
+  if (total == 0)
+    return 0;
+  if (part < 0xFFFFFFFFUL / 100)
+    return part * 100 / total;
+  return part / (total / 100);
+}
+
+void ListenScheduler::printReport()
+{
+  this->accountListenTime(millis());
+
+  uint32_t totalTime = 0;
+  for (uint8_t i = 0; i < this->m_registry->count(); i++)
+    totalTime += this->m_listenTime[i];
+
+  for (uint8_t i = 0; i < this->m_registry->count(); i++)
+  {
+    Manager *manager = this->m_registry->get(i);
+    packetOutput.print(F("Listen "));
+    packetOutput.print(manager->serialChannel());
+    // Transmissions delayed by a busy channel, and forced after the last backoff
+    CC1101::Radio *radio = manager->radio();
+    packetOutput.print(F(": CCA busy/forced "));
+    packetOutput.print(radio->getCcaBusyCount());
+    packetOutput.print('/');
+    packetOutput.print(radio->getCcaFailCount());
+    if (manager->irqPin() != this->m_irqPin)
+    {
+      packetOutput.println(F(", dedicated radio"));
+      continue;
+    }
+    uint32_t listenSeconds = this->m_listenTime[i] / 1000;
+    packetOutput.print(F(", slot "));
+    packetOutput.print(this->m_slotDuration[i]);
+    packetOutput.print(F(" ms, "));
+    packetOutput.print(percent(this->m_listenTime[i], totalTime));
+    packetOutput.print(F("% of time, "));
+    packetOutput.print(this->m_packetCount[i]);
+    packetOutput.print(F(" packets ("));
+    packetOutput.print(listenSeconds ? this->m_packetCount[i] * 3600UL / listenSeconds : 0);
+    packetOutput.print(F(" per listen hour), "));
+    packetOutput.print(this->m_extensionCount[i]);
+    packetOutput.println(F(" slot extensions"));
+  }
+}
+
+void ListenScheduler::accountListenTime(uint32_t now)
+{
+  if (this->m_current >= 0)
+    this->m_listenTime[this->m_current] += now - this->m_slotStartTime;
+  this->m_slotStartTime = now;
+  this->m_isSlotExtended = false;
+}
@@ -0,0 +1,130 @@
+#ifndef _PROTOCOL_H
+#define _PROTOCOL_H
+
+#include "CC1101.h"
+#include "Clock.h"
+
+namespace Protocol
+{
+
+  const uint8_t c_maxManagers = 4;
+  // Maximum time a listen slot is extended while a frame is being received
+  const uint16_t c_maxSlotExtensionMs = 250;
+
+  class Registry;
+
+  /** Common interface of the RF protocol managers
+   *  Each protocol owns a CC1101 radio (possibly shared with other protocols on the same pins),
+   *  and is identified on the serial link by its channel index ("0>", "1>", ...) */
+  class Manager
+  {
+  public:
+    Manager(uint8_t irqPin, uint8_t serialChannel) : m_irqPin(irqPin),
+                                                     m_serialChannel(serialChannel),
+                                                     m_registry(0)
+    {
+    }
+
+    uint8_t irqPin() { return this->m_irqPin; };
+    uint8_t serialChannel() { return this->m_serialChannel; };
+
+    // Initialize the radio with the protocol profile and start listening
+    virtual void begin() = 0;
+    // Called from the radio interrupt handler
+    virtual void rfRxCallback() = 0;
+    virtual bool isPacketAvailable() = 0;
+    // Print the last received packet as a serial line, including the channel prefix
+    virtual void printLastPacket() = 0;
+    // Process a serial command line, without the channel prefix
+    // The manager acquires the radio from the registry if the command needs it
+    virtual void processSerialCommand(const char *message) = 0;
+    // Background work, called from the main loop while the manager is attached to its radio
+    virtual void poll(){};
+    // True while the manager waits for a response on its radio, the listen scheduler then keeps its slot
+    virtual bool isBusy() { return false; };
+
+    // Release / take over a radio shared with another protocol
+    virtual void detachRadio() = 0;
+    virtual void attachRadio() = 0;
+
+    virtual CC1101::Radio *radio() = 0;
+    // Protocol name reported in the serial handshake
+    virtual const __FlashStringHelper *name() = 0;
+
+    void printSerialPrefix();
+    // End a received packet line with its timing, see Manager::printSerialSuffix()
+    void printSerialSuffix(const Clock::PacketTimes *times);
+    void setRegistry(Registry *registry) { this->m_registry = registry; };
+
+  protected:
+    void acquireRadio();
+    void releaseRadio();
+
+    uint8_t m_irqPin;
+    uint8_t m_serialChannel;
+    Registry *m_registry;
+  };
+
+  /** Table of the protocol managers of the gateway
+   *  The first manager registered on an IRQ pin is the default listener of that radio.
+   *  Other managers on the same pin take the radio over on demand (acquireRadio/releaseRadio) */
+  class Registry
+  {
+  public:
+    Registry();
+
+    bool add(Manager *manager);
+    void begin();
+
+    uint8_t count() { return this->m_count; };
+    Manager *get(uint8_t index) { return this->m_managers[index]; };
+    Manager *find(uint8_t serialChannel);
+
+    int8_t indexOf(Manager *manager);
+    int8_t attachedIndex(uint8_t irqPin);
+    bool isAttached(Manager *manager);
+    void acquireRadio(Manager *manager);
+    void releaseRadio(Manager *manager);
+
+    // Forward a radio interrupt to the manager currently attached to that radio
+    void rfRxCallback(uint8_t irqPin);
+
+  private:
+    int8_t defaultIndex(uint8_t irqPin);
+    void switchRadio(uint8_t index);
+
+    Manager *m_managers[c_maxManagers];
+    uint8_t m_count;
+    volatile uint8_t m_attachedMask;
+  };
+
+  /** Rotates a radio shared by several protocols between their profiles
+   *  Each protocol listens for its slot duration in turn (0 excludes it from the rotation).
+   *  A slot is extended while a frame is being received, up to c_maxSlotExtensionMs */
+  class ListenScheduler
+  {
+  public:
+    ListenScheduler(Registry *registry, uint8_t irqPin);
+
+    void setSlot(Manager *manager, uint16_t durationMs);
+    void update();
+    void onPacket(Manager *manager);
+    void printReport();
+
+  private:
+    void accountListenTime(uint32_t now);
+
+    Registry *m_registry;
+    uint8_t m_irqPin;
+    int8_t m_current;
+    uint32_t m_slotStartTime;
+    bool m_isSlotExtended;
+    uint16_t m_slotDuration[c_maxManagers];
+    uint32_t m_listenTime[c_maxManagers];
+    uint16_t m_packetCount[c_maxManagers];
+    uint16_t m_extensionCount[c_maxManagers];
+  };
+
+} // namespace Protocol
+
+#endif //_PROTOCOL_H
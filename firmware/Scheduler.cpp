@@ -0,0 +1,124 @@
+#include "Scheduler.h"
+#include "SerialLine.h"
+
+using namespace Tasks;
+using SerialLine::packetOutput;
+
+Task::Task(Callback callback, Priority priority, uint16_t periodMs, uint16_t budgetUs) : m_callback(callback),
+                                                                                         m_name(0),
+                                                                                         m_priority(priority),
+                                                                                         m_periodMs(periodMs),
+                                                                                         m_budgetUs(budgetUs),
+                                                                                         m_isSignaled(false),
+                                                                                         m_lastRunTime(0)
+{
+  this->resetStats();
+}
+
+void Task::resetStats()
+{
+  this->m_runCount = 0;
+  this->m_runTimeSum = 0;
+  this->m_runTimeMax = 0;
+  this->m_overrunCount = 0;
+}
+
+bool Task::isDue(uint32_t now)
+{
+  return this->m_isSignaled || (this->m_periodMs != 0 && now - this->m_lastRunTime >= this->m_periodMs);
+}
+
+void Task::run(uint32_t now)
+{
+  // Signals raised while running are kept for the next pass
+  this->m_isSignaled = false;
+  this->m_lastRunTime = now;
+
+  uint32_t start = micros();
+  this->m_callback();
+  uint32_t runTime = micros() - start;
+
+  this->m_runCount++;
+  this->m_runTimeSum += runTime;
+  if (runTime > this->m_runTimeMax)
+    this->m_runTimeMax = runTime;
+  if (this->m_budgetUs != 0 && runTime > this->m_budgetUs)
+    this->m_overrunCount++;
+}
+
+void Task::printStats()
+{
+  packetOutput.print(this->m_name);
+  packetOutput.print(F(": prio "));
+  packetOutput.print((uint8_t)this->m_priority);
+  packetOutput.print(F(", runs "));
+  packetOutput.print(this->m_runCount);
+  if (this->m_runCount != 0)
+  {
+    packetOutput.print(F(", avg/max (us) "));
+    packetOutput.print(this->m_runTimeSum / this->m_runCount);
+    packetOutput.print('/');
+    packetOutput.print(this->m_runTimeMax);
+  }
+  packetOutput.print(F(", budget (us) "));
+  packetOutput.print(this->m_budgetUs);
+  packetOutput.print(F(", overruns "));
+  packetOutput.println(this->m_overrunCount);
+}
+
+Scheduler::Scheduler() : m_count(0),
+                         m_idleCount(0)
+{
+}
+
+/* Tasks are kept sorted by decreasing priority, tasks of equal priority in their order of addition */
+bool Scheduler::add(Task *task, const __FlashStringHelper *name)
+{
+  if (this->m_count >= c_maxTasks)
+    return false;
+
+  task->m_name = name;
+  uint8_t i = this->m_count++;
+  while (i > 0 && this->m_tasks[i - 1]->m_priority < task->m_priority)
+  {
+    this->m_tasks[i] = this->m_tasks[i - 1];
+    i--;
+  }
+  this->m_tasks[i] = task;
+  return true;
+}
+
+bool Scheduler::run()
+{
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < this->m_count; i++)
+  {
+    Task *task = this->m_tasks[i];
+    if (task->isDue(now))
+    {
+      task->run(now);
+      return true;
+    }
+  }
+  this->m_idleCount++;
+  return false;
+}
+
+void Scheduler::processSerialCommand(SerialLine::Parser *parser)
+{
+  if (parser->readKeyword(F("reset")))
+  {
+    for (uint8_t i = 0; i < this->m_count; i++)
+      this->m_tasks[i]->resetStats();
+    this->m_idleCount = 0;
+  }
+  this->printReport();
+}
+
+void Scheduler::printReport()
+{
+  for (uint8_t i = 0; i < this->m_count; i++)
+    this->m_tasks[i]->printStats();
+  packetOutput.print(F("Idle passes: "));
+  packetOutput.println(this->m_idleCount);
+}
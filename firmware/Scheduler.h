@@ -0,0 +1,79 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <Arduino.h>
+#include "SerialLine.h"
+
+namespace Tasks
+{
+
+  const uint8_t c_maxTasks = 8;
+
+  typedef void (*Callback)();
+
+  enum class Priority : uint8_t
+  {
+    Low = 0,
+    Normal = 1,
+    High = 2,
+    RealTime = 3
+  };
+
+  /** Cooperative task, run to completion by the scheduler
+   *  A task runs when its period has elapsed (0 for event-driven tasks), or when signaled,
+   *  e.g. from an interrupt handler. Long jobs keep their progress in their own state and return early */
+  class Task
+  {
+  public:
+    Task(Callback callback, Priority priority, uint16_t periodMs, uint16_t budgetUs);
+
+    // Run the task on the next scheduler pass, safe to call from an interrupt handler
+    void signal() { this->m_isSignaled = true; };
+
+    void resetStats();
+    void printStats();
+
+  private:
+    friend class Scheduler;
+
+    bool isDue(uint32_t now);
+    void run(uint32_t now);
+
+    Callback m_callback;
+    const __FlashStringHelper *m_name;
+    Priority m_priority;
+    uint16_t m_periodMs;
+    uint16_t m_budgetUs;
+    volatile bool m_isSignaled;
+    uint32_t m_lastRunTime;
+
+    uint32_t m_runCount;
+    uint32_t m_runTimeSum;
+    uint32_t m_runTimeMax;
+    uint16_t m_overrunCount;
+  };
+
+  /** Runs the highest priority task which is due, one task per pass
+   *  A high priority task never waits for more than the run time of a single lower priority task */
+  class Scheduler
+  {
+  public:
+    Scheduler();
+
+    bool add(Task *task, const __FlashStringHelper *name);
+    // One scheduler pass, called from loop(). Returns false if no task was due
+    bool run();
+
+    // "tasks" prints the task statistics, "tasks,reset" clears them
+    void processSerialCommand(SerialLine::Parser *parser);
+    void printReport();
+
+  private:
+    Task *m_tasks[c_maxTasks];
+    uint8_t m_count;
+    uint32_t m_idleCount;
+  };
+
+} // namespace Tasks
+
+#endif //_SCHEDULER_H
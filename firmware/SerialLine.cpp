@@ -0,0 +1,483 @@
+#include "SerialLine.h"
+
+using namespace SerialLine;
+
+static uint8_t s_packetBuffer[c_packetQueueSize];
+static uint8_t s_debugBuffer[c_debugQueueSize];
+
+OutputQueue SerialLine::packetOutput(s_packetBuffer, c_packetQueueSize, OverflowPolicy::Wait);
+OutputQueue SerialLine::debugOutput(s_debugBuffer, c_debugQueueSize, OverflowPolicy::DropOldest);
+
+// Queue of the line being transmitted, NULL between lines
+static OutputQueue *s_currentOutput = NULL;
+// The serial input of the gateway, held by the protocols around their blocking operations
+static Assembler *s_input = NULL;
+
+Assembler::Assembler() : m_head(0),
+                         m_tail(0),
+                         m_count(0),
+                         m_lineCount(0),
+                         m_lineLength(0),
+                         m_isDiscarding(false),
+                         m_isFlowControlEnabled(false),
+                         m_isPaused(false),
+                         m_holdCount(0),
+                         m_overrunCount(0)
+{
+  s_input = this;
+}
+
+void Assembler::setFlowControl(bool isEnabled)
+{
+  this->m_isFlowControlEnabled = isEnabled;
+  // Never leave the host paused
+  if (this->m_isPaused)
+    Serial.write(c_xon);
+  this->m_isPaused = false;
+  this->updateFlowControl();
+}
+
+void Assembler::hold()
+{
+  // Empty the UART buffer first, it then absorbs what the host sends until it gets the XOFF
+  this->m_holdCount++;
+  this->poll();
+}
+
+void Assembler::release()
+{
+  if (this->m_holdCount == 0)
+    return;
+  this->m_holdCount--;
+  this->poll();
+}
+
+/* The XOFF is queued behind the bytes already in the UART transmit buffer: the host keeps sending meanwhile */
+void Assembler::updateFlowControl()
+{
+  if (!this->m_isFlowControlEnabled)
+    return;
+  // Resume once the ring is a quarter full at most
+  bool isPauseNeeded = this->m_holdCount != 0 || c_ringSize - this->m_count < c_maxLineLength ||
+                       (this->m_isPaused && this->m_count > c_ringSize / 4);
+  if (isPauseNeeded == this->m_isPaused)
+    return;
+  Serial.write(isPauseNeeded ? c_xoff : c_xon);
+  this->m_isPaused = isPauseNeeded;
+}
+
+void Assembler::poll()
+{
+  // Bytes are left in the UART buffer when the ring is full of unprocessed lines
+  while (Serial.available() && this->m_count < c_ringSize)
+  {
+    char c = Serial.read();
+    if (c == '\r' || c == '\n')
+    {
+      if (this->m_isDiscarding)
+      {
+        this->m_isDiscarding = false;
+        this->m_overrunCount++;
+        packetOutput.println(F("Serial RX buffer overrun"));
+      }
+      // Empty lines (and the second half of CRLF) are skipped
+      else if (this->m_lineLength != 0)
+      {
+        this->m_ring[this->m_head] = '\n';
+        this->m_head = (this->m_head + 1) & (c_ringSize - 1);
+        this->m_count++;
+        this->m_lineCount++;
+        this->m_lineLength = 0;
+      }
+    }
+    else if (!this->m_isDiscarding)
+    {
+      if (this->m_lineLength == c_maxLineLength)
+      {
+        // Drop the beginning of the line, and the rest of it until the end of line
+        this->m_head = (this->m_head - this->m_lineLength) & (c_ringSize - 1);
+        this->m_count -= this->m_lineLength;
+        this->m_lineLength = 0;
+        this->m_isDiscarding = true;
+        continue;
+      }
+      this->m_ring[this->m_head] = c;
+      this->m_head = (this->m_head + 1) & (c_ringSize - 1);
+      this->m_count++;
+      this->m_lineLength++;
+    }
+  }
+
+  this->updateFlowControl();
+}
+
+bool Assembler::readLine(char *line)
+{
+  if (this->m_lineCount == 0)
+    return false;
+
+  uint8_t length = 0;
+  while (this->m_ring[this->m_tail] != '\n')
+  {
+    line[length++] = this->m_ring[this->m_tail];
+    this->m_tail = (this->m_tail + 1) & (c_ringSize - 1);
+  }
+  line[length] = 0;
+  // Skip the end of line
+  this->m_tail = (this->m_tail + 1) & (c_ringSize - 1);
+  this->m_count -= length + 1;
+  this->m_lineCount--;
+
+  this->updateFlowControl();
+  return true;
+}
+
+void SerialLine::holdInput()
+{
+  if (s_input != NULL)
+    s_input->hold();
+}
+
+void SerialLine::releaseInput()
+{
+  if (s_input != NULL)
+    s_input->release();
+}
+
+static inline bool isTerminator(char c)
+{
+  return c == ',' || c == ';' || c == 0;
+}
+
+Parser::Parser(const char *line) : m_position(line),
+                                   m_fieldStart(line),
+                                   m_fieldIndex(0),
+                                   m_isEndOfRecord(*line == ';' || *line == 0),
+                                   m_isError(false)
+{
+}
+
+bool Parser::nextRecord()
+{
+  while (*this->m_position != ';' && *this->m_position != 0)
+    this->m_position++;
+  if (*this->m_position == 0)
+    return false;
+
+  this->m_position++;
+  this->m_fieldStart = this->m_position;
+  this->m_fieldIndex = 0;
+  this->m_isEndOfRecord = *this->m_position == ';' || *this->m_position == 0;
+  this->m_isError = false;
+  return true;
+}
+
+bool Parser::beginField()
+{
+  this->m_fieldStart = this->m_position;
+  if (this->m_isEndOfRecord)
+    this->m_isError = true;
+  return !this->m_isEndOfRecord;
+}
+
+/* The position is on the terminator of the field which has just been read */
+void Parser::endField()
+{
+  this->m_fieldIndex++;
+  if (*this->m_position == ',')
+    this->m_position++;
+  else
+    this->m_isEndOfRecord = true;
+}
+
+bool Parser::readUInt(uint32_t *value, uint32_t max)
+{
+  if (!this->beginField())
+    return false;
+
+  const char *p = this->m_position;
+  uint32_t result = 0;
+  do
+  {
+    uint8_t digit = *p - '0';
+    if (digit > 9 || digit > max || result > (max - digit) / 10)
+    {
+      this->m_isError = true;
+      return false;
+    }
+    result = result * 10 + digit;
+  } while (!isTerminator(*++p));
+
+  this->m_position = p;
+  this->endField();
+  *value = result;
+  return true;
+}
+
+bool Parser::readUInt(uint8_t *value, uint8_t max)
+{
+  uint32_t result;
+  if (!this->readUInt(&result, max))
+    return false;
+  *value = result;
+  return true;
+}
+
+bool Parser::readToken(const char **token, uint8_t *length)
+{
+  if (!this->beginField())
+    return false;
+
+  const char *p = this->m_position;
+  while (!isTerminator(*p))
+    p++;
+  *token = this->m_position;
+  *length = p - this->m_position;
+
+  this->m_position = p;
+  this->endField();
+  return true;
+}
+
+bool Parser::readKeyword(const __FlashStringHelper *keyword)
+{
+  const char *keywordP = (const char *)keyword;
+  uint8_t length = strlen_P(keywordP);
+  if (this->m_isEndOfRecord || strncmp_P(this->m_position, keywordP, length) != 0 || !isTerminator(this->m_position[length]))
+    return false;
+
+  this->m_fieldStart = this->m_position;
+  this->m_position += length;
+  this->endField();
+  return true;
+}
+
+void Parser::printError()
+{
+  if (this->m_isEndOfRecord)
+  {
+    packetOutput.print(F("Missing field "));
+    packetOutput.println(this->m_fieldIndex + 1);
+    return;
+  }
+
+  const char *p = this->m_fieldStart;
+  while (!isTerminator(*p))
+    p++;
+  packetOutput.print(F("Invalid field "));
+  packetOutput.print(this->m_fieldIndex + 1);
+  packetOutput.print(F(": "));
+  packetOutput.write((const uint8_t *)this->m_fieldStart, p - this->m_fieldStart);
+  packetOutput.println();
+}
+
+OutputQueue::OutputQueue(uint8_t *buffer, uint8_t size, OverflowPolicy policy) : m_buffer(buffer),
+                                                                                 m_size(size),
+                                                                                 m_policy(policy),
+                                                                                 m_head(0),
+                                                                                 m_tail(0),
+                                                                                 m_count(0),
+                                                                                 m_lineCount(0),
+                                                                                 m_isTruncated(false),
+                                                                                 m_isDiscarding(false),
+                                                                                 m_maxCount(0),
+                                                                                 m_droppedCount(0),
+                                                                                 m_delayedCount(0)
+{
+}
+
+size_t OutputQueue::write(uint8_t c)
+{
+  if (this->m_isDiscarding)
+  {
+    this->m_droppedCount++;
+    if (c == '\n')
+      this->m_isDiscarding = false;
+    return 1;
+  }
+
+  if (this->isFull())
+  {
+    if (this->m_policy == OverflowPolicy::DropOldest)
+      this->dropOldestLine();
+    else
+    {
+      this->m_delayedCount++;
+      while (this->isFull())
+        transmitNext();
+    }
+  }
+
+  this->m_buffer[this->m_head] = c;
+  this->m_head = (this->m_head + 1) & (this->m_size - 1);
+  this->m_count++;
+  if (this->m_count > this->m_maxCount)
+    this->m_maxCount = this->m_count;
+  if (c == '\n')
+    this->m_lineCount++;
+
+  drainOutput();
+  return 1;
+}
+
+void OutputQueue::dropOldestLine()
+{
+  while (this->m_count != 0)
+  {
+    uint8_t c = this->m_buffer[this->m_tail];
+    this->m_tail = (this->m_tail + 1) & (this->m_size - 1);
+    this->m_count--;
+    this->m_droppedCount++;
+    if (c == '\n')
+    {
+      this->m_lineCount--;
+      break;
+    }
+  }
+  // The end of a line being transmitted was dropped
+  if (s_currentOutput == this)
+    this->m_isTruncated = true;
+}
+
+/* Transmit one byte, blocks if the UART transmit buffer is full
+ * A line is only started once complete (or filling its whole queue), then transmitted up to its end */
+bool SerialLine::transmitNext()
+{
+  if (s_currentOutput == NULL)
+  {
+    if (packetOutput.m_lineCount != 0 || packetOutput.isFull())
+      s_currentOutput = &packetOutput;
+    else if (debugOutput.m_lineCount != 0 || debugOutput.isFull())
+      s_currentOutput = &debugOutput;
+    else
+      return false;
+  }
+
+  OutputQueue *output = s_currentOutput;
+  if (output->m_isTruncated)
+  {
+    output->m_isTruncated = false;
+    s_currentOutput = NULL;
+    Serial.write('\n');
+    return true;
+  }
+  if (output->m_count == 0)
+  {
+    // The rest of a debug line is still being printed: end it there if the packet queue is full,
+    // rather than blocking the packet writer forever
+    if (output == &packetOutput || !packetOutput.isFull())
+      return false;
+    output->m_isDiscarding = true;
+    s_currentOutput = NULL;
+    Serial.write('\n');
+    return true;
+  }
+
+  uint8_t c = output->m_buffer[output->m_tail];
+  output->m_tail = (output->m_tail + 1) & (output->m_size - 1);
+  output->m_count--;
+  if (c == '\n')
+  {
+    output->m_lineCount--;
+    s_currentOutput = NULL;
+  }
+  Serial.write(c);
+  return true;
+}
+
+void SerialLine::drainOutput()
+{
+  while (Serial.availableForWrite() > 0 && transmitNext())
+    ;
+}
+
+void SerialLine::flushOutput()
+{
+  while (transmitNext())
+    ;
+  Serial.flush();
+}
+
+void SerialLine::printOutputStats(Assembler *input)
+{
+  packetOutput.print(F("Serial input overruns: "));
+  packetOutput.print(input->overrunCount());
+  packetOutput.print(F(", packet queue max/delayed: "));
+  packetOutput.print(packetOutput.maxCount());
+  packetOutput.print('/');
+  packetOutput.print(packetOutput.delayedCount());
+  packetOutput.print(F(", debug queue max/dropped: "));
+  packetOutput.print(debugOutput.maxCount());
+  packetOutput.print('/');
+  packetOutput.println(debugOutput.droppedCount());
+}
+
+Link::Link(Assembler *input) : m_input(input),
+                               m_baudRate(c_defaultBaudRate),
+                               m_confirmTimer(onConfirmTimeout, this)
+{
+}
+
+void Link::begin()
+{
+  Serial.begin(c_defaultBaudRate);
+}
+
+void Link::processHello(Parser *parser)
+{
+  // The host talks to us at the new rate
+  this->m_confirmTimer.stop();
+
+  bool isFlowControlRequested = false;
+  const char *option;
+  uint8_t length;
+  while (!parser->isEndOfRecord())
+  {
+    if (parser->readKeyword(F("xonxoff")))
+      isFlowControlRequested = true;
+    else
+      parser->readToken(&option, &length);
+  }
+  this->m_input->setFlowControl(isFlowControlRequested);
+}
+
+void Link::processBaud(Parser *parser)
+{
+  uint32_t baudRate;
+  if (!parser->readUInt(&baudRate, 0xFFFFFFFF))
+  {
+    parser->printError();
+    return;
+  }
+  if (!isSupported(baudRate))
+    baudRate = this->m_baudRate;
+
+  packetOutput.print(F("baud,"));
+  packetOutput.println(baudRate);
+  if (baudRate != this->m_baudRate)
+  {
+    this->setBaudRate(baudRate);
+    this->m_confirmTimer.start(c_baudConfirmMs);
+  }
+}
+
+/* Rates with an exact divider on a 16 MHz AVR (115200 is the usual approximation) */
+bool Link::isSupported(uint32_t baudRate)
+{
+  return baudRate == c_defaultBaudRate || baudRate == 250000 || baudRate == 500000 || baudRate == 1000000;
+}
+
+void Link::setBaudRate(uint32_t baudRate)
+{
+  // Finish transmitting at the current rate
+  flushOutput();
+  Serial.begin(baudRate);
+  this->m_baudRate = baudRate;
+}
+
+void Link::onConfirmTimeout(Timer::Monostable *, void *context)
+{
+  Link *link = (Link *)context;
+  link->setBaudRate(c_defaultBaudRate);
+  link->m_input->setFlowControl(false);
+}
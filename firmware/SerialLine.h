@@ -0,0 +1,196 @@
+#ifndef _SERIALLINE_H
+#define _SERIALLINE_H
+
+#include <Arduino.h>
+#include "TimerWheel.h"
+
+namespace SerialLine
+{
+
+  // Longest command line, large enough for a batch of 4 Ideo commands
+  const uint8_t c_maxLineLength = 64;
+  // Received bytes waiting to be processed, may hold several command lines
+  const uint8_t c_ringSize = 128;
+  // Output lines waiting for the UART, sizes must be powers of 2
+  const uint8_t c_packetQueueSize = 128;
+  const uint8_t c_debugQueueSize = 64;
+
+  // Version of the serial protocol, reported by the "hello" handshake
+  const uint8_t c_protocolVersion = 5;
+  // Rate at startup, and after a failed switch
+  const uint32_t c_defaultBaudRate = 115200;
+  // A new rate must be confirmed by a "hello" from the host within this time
+  const uint16_t c_baudConfirmMs = 1000;
+
+  // Software flow control characters
+  const uint8_t c_xon = 0x11;
+  const uint8_t c_xoff = 0x13;
+
+  /** Assembles the serial input into command lines
+   *  All the available bytes are moved into a ring buffer on each poll, so that several commands
+   *  can be queued while a long one (e.g. an Ideo batch) is being processed */
+  class Assembler
+  {
+  public:
+    Assembler();
+
+    // Drain the serial input
+    void poll();
+
+    bool isLineAvailable() { return this->m_lineCount != 0; };
+    // Copy the next complete line to a buffer of c_maxLineLength + 1 bytes, returns false if there is none
+    bool readLine(char *line);
+
+    uint16_t overrunCount() { return this->m_overrunCount; };
+
+    // Pause the host with XOFF when there is no room left for a full line, resume it with XON
+    void setFlowControl(bool isEnabled);
+    // Also pause the host during an operation which does not poll the input (command execution, radio
+    // transmission, response wait), as the UART buffer alone overruns within a few ms. Calls may be nested
+    void hold();
+    void release();
+
+  private:
+    void updateFlowControl();
+
+    uint8_t m_ring[c_ringSize];
+    uint8_t m_head;
+    uint8_t m_tail;
+    uint8_t m_count;
+    uint8_t m_lineCount;
+    uint8_t m_lineLength;
+    bool m_isDiscarding;
+    bool m_isFlowControlEnabled;
+    bool m_isPaused;
+    uint8_t m_holdCount;
+    uint16_t m_overrunCount;
+  };
+
+  // Hold / release the serial input of the gateway from the protocol code, see Assembler::hold()
+  void holdInput();
+  void releaseInput();
+
+  /** Single pass parser over a command line, which is left untouched
+   *  Fields are separated by ',', and records of a batch by ';'. Numbers are range checked */
+  class Parser
+  {
+  public:
+    Parser(const char *line);
+
+    // No more fields in the current record
+    bool isEndOfRecord() { return this->m_isEndOfRecord; };
+    // Move to the next record of a batch, returns false at the end of the line
+    bool nextRecord();
+
+    bool readUInt(uint32_t *value, uint32_t max);
+    bool readUInt(uint8_t *value, uint8_t max);
+    // The token points into the line, and is not null-terminated
+    bool readToken(const char **token, uint8_t *length);
+    // Consume the field only if it matches the keyword, which is stored in flash
+    bool readKeyword(const __FlashStringHelper *keyword);
+
+    bool isError() { return this->m_isError; };
+    void printError();
+
+  private:
+    bool beginField();
+    void endField();
+
+    const char *m_position;
+    const char *m_fieldStart;
+    uint8_t m_fieldIndex;
+    bool m_isEndOfRecord;
+    bool m_isError;
+  };
+
+  enum class OverflowPolicy : uint8_t
+  {
+    // Wait for the UART to make room, the delayed bytes are counted
+    Wait,
+    // Drop the oldest lines, the dropped bytes are counted
+    DropOldest
+  };
+
+  // Transmit the next queued byte, waiting if the UART is busy. Returns false if no line can be transmitted
+  bool transmitNext();
+
+  /** Output queue filled by the print functions, drained into the UART transmit buffer without blocking
+   *  The packet lines are transmitted before the debug lines, and lines of both queues are never interleaved */
+  class OutputQueue : public Print
+  {
+  public:
+    OutputQueue(uint8_t *buffer, uint8_t size, OverflowPolicy policy);
+
+    size_t write(uint8_t c);
+    using Print::write;
+
+    // Bytes waiting to be transmitted
+    uint8_t count() { return this->m_count; };
+    uint32_t droppedCount() { return this->m_droppedCount; };
+    uint32_t delayedCount() { return this->m_delayedCount; };
+    uint8_t maxCount() { return this->m_maxCount; };
+
+  private:
+    friend bool transmitNext();
+
+    bool isFull() { return this->m_count == this->m_size; };
+    void dropOldestLine();
+
+    uint8_t *m_buffer;
+    uint8_t m_size;
+    OverflowPolicy m_policy;
+    uint8_t m_head;
+    uint8_t m_tail;
+    uint8_t m_count;
+    uint8_t m_lineCount;
+    bool m_isTruncated;
+    // The line was ended early to let a full packet queue through, the rest of it is dropped
+    bool m_isDiscarding;
+
+    uint8_t m_maxCount;
+    uint32_t m_droppedCount;
+    uint32_t m_delayedCount;
+  };
+
+  // Packets and replies to the host commands
+  extern OutputQueue packetOutput;
+  // Debug traces
+  extern OutputQueue debugOutput;
+
+  // Move the queued lines to the UART as long as it has room, called from the main loop
+  void drainOutput();
+  // Transmit all the queued lines, and wait for the UART to finish
+  void flushOutput();
+  void printOutputStats(Assembler *input);
+
+  /** Serial link setup negotiated with the host
+   *  The host sends "hello[,xonxoff]" to request the capabilities and optional flow control,
+   *  then may switch to a faster rate with "baud,<rate>", confirmed by a new "hello" at that rate */
+  class Link
+  {
+  public:
+    Link(Assembler *input);
+
+    void begin();
+
+    // Process the options of a "hello" command, the reply is printed by the caller
+    void processHello(Parser *parser);
+    // "baud,<rate>" acknowledges the new rate with "baud,<rate>", or the current one if not supported
+    void processBaud(Parser *parser);
+
+    uint32_t baudRate() { return this->m_baudRate; };
+
+  private:
+    static void onConfirmTimeout(Timer::Monostable *timer, void *context);
+
+    static bool isSupported(uint32_t baudRate);
+    void setBaudRate(uint32_t baudRate);
+
+    Assembler *m_input;
+    uint32_t m_baudRate;
+    Timer::Monostable m_confirmTimer;
+  };
+
+} // namespace SerialLine
+
+#endif //_SERIALLINE_H
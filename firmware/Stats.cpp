@@ -0,0 +1,155 @@
+#include "Stats.h"
+
+#if STATS_ENABLED
+
+using SerialLine::packetOutput;
+
+// Updated from the radio interrupt handlers
+static volatile uint32_t s_isrCount;
+static volatile uint32_t s_isrCyclesSum;
+static volatile uint16_t s_isrCyclesMax;
+static volatile uint32_t s_lastEdgeTime;
+// Updated with interrupts masked
+static volatile uint32_t s_spiCount;
+
+static uint32_t s_packetCount;
+static uint32_t s_packetLatencySum;
+static uint32_t s_packetLatencyMax;
+
+static uint32_t s_loopCounts[Stats::c_loopBucketCount];
+static uint32_t s_loopMax;
+
+void Stats::begin()
+{
+  // Normal mode, no prescaler: TCNT1 counts CPU cycles and wraps every 65536 cycles
+  TCCR1A = 0;
+  TCCR1B = 1 << CS10;
+  TIMSK1 = 0;
+  reset();
+}
+
+uint16_t Stats::isrBegin()
+{
+  s_lastEdgeTime = micros();
+  return TCNT1;
+}
+
+/* Handlers longer than 65536 cycles (4 ms at 16 MHz) would wrap, they would be far beyond any budget anyway */
+void Stats::isrEnd(uint16_t startCycles)
+{
+  uint16_t cycles = TCNT1 - startCycles;
+  s_isrCount++;
+  s_isrCyclesSum += cycles;
+  if (cycles > s_isrCyclesMax)
+    s_isrCyclesMax = cycles;
+}
+
+/* The latency is measured from the last radio interrupt, which completed the packet */
+void Stats::packetDecoded()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint32_t latency = micros() - s_lastEdgeTime;
+  SREG = sreg;
+
+  s_packetCount++;
+  s_packetLatencySum += latency;
+  if (latency > s_packetLatencyMax)
+    s_packetLatencyMax = latency;
+}
+
+void Stats::loopPass(uint32_t us)
+{
+  uint8_t bucket = 0;
+  uint32_t limit = c_loopBucketMinUs;
+  while (bucket < c_loopBucketCount - 1 && us >= limit)
+  {
+    bucket++;
+    limit <<= 1;
+  }
+  s_loopCounts[bucket]++;
+  if (us > s_loopMax)
+    s_loopMax = us;
+}
+
+void Stats::spiTransaction()
+{
+  s_spiCount++;
+}
+
+void Stats::processSerialCommand(SerialLine::Parser *parser)
+{
+  if (parser->readKeyword(F("reset")))
+    reset();
+  printReport();
+}
+
+void Stats::printReport()
+{
+  // Consistent copy of the counters updated by the interrupt handlers
+  uint8_t sreg = SREG;
+  cli();
+  uint32_t isrCount = s_isrCount;
+  uint32_t isrCyclesSum = s_isrCyclesSum;
+  uint16_t isrCyclesMax = s_isrCyclesMax;
+  uint32_t spiCount = s_spiCount;
+  SREG = sreg;
+
+  packetOutput.print(F("Radio ISR: count "));
+  packetOutput.print(isrCount);
+  if (isrCount != 0)
+  {
+    packetOutput.print(F(", avg/max (cycles) "));
+    packetOutput.print(isrCyclesSum / isrCount);
+    packetOutput.print('/');
+    packetOutput.print(isrCyclesMax);
+  }
+  packetOutput.println();
+
+  packetOutput.print(F("Packets: count "));
+  packetOutput.print(s_packetCount);
+  if (s_packetCount != 0)
+  {
+    packetOutput.print(F(", edge to decode avg/max (us) "));
+    packetOutput.print(s_packetLatencySum / s_packetCount);
+    packetOutput.print('/');
+    packetOutput.print(s_packetLatencyMax);
+  }
+  packetOutput.println();
+
+  packetOutput.print(F("Loop passes (us):"));
+  uint32_t limit = c_loopBucketMinUs;
+  for (uint8_t i = 0; i < c_loopBucketCount; i++)
+  {
+    packetOutput.print(i < c_loopBucketCount - 1 ? F(" <") : F(" >="));
+    packetOutput.print(i < c_loopBucketCount - 1 ? limit : limit >> 1);
+    packetOutput.print(' ');
+    packetOutput.print(s_loopCounts[i]);
+    limit <<= 1;
+  }
+  packetOutput.print(F(", max "));
+  packetOutput.println(s_loopMax);
+
+  packetOutput.print(F("SPI transactions: "));
+  packetOutput.println(spiCount);
+}
+
+void Stats::reset()
+{
+  uint8_t sreg = SREG;
+  cli();
+  s_isrCount = 0;
+  s_isrCyclesSum = 0;
+  s_isrCyclesMax = 0;
+  s_spiCount = 0;
+  SREG = sreg;
+
+  s_packetCount = 0;
+  s_packetLatencySum = 0;
+  s_packetLatencyMax = 0;
+  for (uint8_t i = 0; i < c_loopBucketCount; i++)
+    s_loopCounts[i] = 0;
+  s_loopMax = 0;
+}
+
+#endif // STATS_ENABLED
@@ -0,0 +1,59 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <Arduino.h>
+#include "SerialLine.h"
+
+// Profiling counters, set to 0 to remove them at compile time
+#ifndef STATS_ENABLED
+#define STATS_ENABLED 1
+#endif
+
+namespace Stats
+{
+
+  // Loop duration histogram: bucket i counts the passes shorter than c_loopBucketMinUs << i microseconds,
+  // the last bucket the longer ones
+  const uint8_t c_loopBucketCount = 8;
+  const uint16_t c_loopBucketMinUs = 64;
+
+  // Start Timer1 as a free running CPU cycle counter
+  void begin();
+
+  // Radio interrupt handler entry, returns the cycle count to pass to isrEnd()
+  uint16_t isrBegin();
+  void isrEnd(uint16_t startCycles);
+
+  // A packet received by the last radio interrupt has been decoded
+  void packetDecoded();
+  // Duration of one main loop pass
+  void loopPass(uint32_t us);
+  // Called with interrupts masked by the SPI transaction
+  void spiTransaction();
+
+  // "stats" prints the profiling counters, "stats,reset" clears them
+  void processSerialCommand(SerialLine::Parser *parser);
+  void printReport();
+  void reset();
+
+} // namespace Stats
+
+#if STATS_ENABLED
+#define STATS_BEGIN() Stats::begin()
+#define STATS_ISR_BEGIN() uint16_t statsIsrStart = Stats::isrBegin()
+#define STATS_ISR_END() Stats::isrEnd(statsIsrStart)
+#define STATS_PACKET_DECODED() Stats::packetDecoded()
+#define STATS_LOOP_BEGIN() uint32_t statsLoopStart = micros()
+#define STATS_LOOP_END() Stats::loopPass(micros() - statsLoopStart)
+#define STATS_SPI_TRANSACTION() Stats::spiTransaction()
+#else
+#define STATS_BEGIN() ((void)0)
+#define STATS_ISR_BEGIN() ((void)0)
+#define STATS_ISR_END() ((void)0)
+#define STATS_PACKET_DECODED() ((void)0)
+#define STATS_LOOP_BEGIN() ((void)0)
+#define STATS_LOOP_END() ((void)0)
+#define STATS_SPI_TRANSACTION() ((void)0)
+#endif
+
+#endif //_STATS_H
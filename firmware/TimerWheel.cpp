@@ -0,0 +1,106 @@
+#include "TimerWheel.h"
+
+using namespace Timer;
+
+Wheel Timer::wheel;
+
+Monostable::Monostable(Callback callback, void *context) : m_callback(callback),
+                                                           m_context(context),
+                                                           m_next(0),
+                                                           m_prev(0),
+                                                           m_expiry(0),
+                                                           m_slot(c_stopped)
+{
+}
+
+void Monostable::setCallback(Callback callback, void *context)
+{
+  this->m_callback = callback;
+  this->m_context = context;
+}
+
+void Monostable::start(uint32_t ms)
+{
+  this->stop();
+  // Count from the start of the current tick, which may not have been updated yet,
+  // and round up so that the timer never fires early
+  ms += millis() - wheel.m_lastTickTime;
+  wheel.link(this, wheel.m_tick + ms / c_tickMs + 1);
+}
+
+void Monostable::stop()
+{
+  if (this->isRunning())
+    wheel.unlink(this);
+}
+
+uint32_t Monostable::remaining()
+{
+  if (!this->isRunning())
+    return 0;
+  return (this->m_expiry - wheel.m_tick) * c_tickMs;
+}
+
+Wheel::Wheel() : m_tick(0),
+                 m_lastTickTime(0),
+                 m_runningCount(0)
+{
+  for (uint8_t i = 0; i < c_wheelSlots; i++)
+    this->m_slots[i] = NULL;
+}
+
+void Wheel::link(Monostable *timer, uint32_t expiry)
+{
+  uint8_t slot = expiry & (c_wheelSlots - 1);
+  timer->m_expiry = expiry;
+  timer->m_slot = slot;
+  timer->m_prev = NULL;
+  timer->m_next = this->m_slots[slot];
+  if (timer->m_next != NULL)
+    timer->m_next->m_prev = timer;
+  this->m_slots[slot] = timer;
+  this->m_runningCount++;
+}
+
+void Wheel::unlink(Monostable *timer)
+{
+  if (timer->m_prev != NULL)
+    timer->m_prev->m_next = timer->m_next;
+  else
+    this->m_slots[timer->m_slot] = timer->m_next;
+  if (timer->m_next != NULL)
+    timer->m_next->m_prev = timer->m_prev;
+  timer->m_slot = Monostable::c_stopped;
+  this->m_runningCount--;
+}
+
+void Wheel::update()
+{
+  // Catch up with the ticks elapsed since the last call
+  uint32_t now = millis();
+  while (now - this->m_lastTickTime >= c_tickMs)
+  {
+    this->m_lastTickTime += c_tickMs;
+    this->m_tick++;
+    this->expire(this->m_tick & (c_wheelSlots - 1));
+  }
+}
+
+void Wheel::expire(uint8_t slot)
+{
+  // Timers of later revolutions share the slot and are skipped
+  Monostable *timer = this->m_slots[slot];
+  while (timer != NULL)
+  {
+    if (timer->m_expiry != this->m_tick)
+    {
+      timer = timer->m_next;
+      continue;
+    }
+    this->unlink(timer);
+    if (timer->m_callback != NULL)
+      timer->m_callback(timer, timer->m_context);
+    // The callback may have started or stopped other timers of this slot
+    timer = this->m_slots[slot];
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef _TIMERWHEEL_H
+#define _TIMERWHEEL_H
+
+#include <Arduino.h>
+
+namespace Timer
+{
+
+  // Number of wheel slots, must be a power of 2
+  const uint8_t c_wheelSlots = 32;
+  // Wheel resolution, must be a power of 2 (one revolution is c_wheelSlots * c_tickMs)
+  const uint8_t c_tickMs = 32;
+
+  class Monostable;
+  class Wheel;
+
+  typedef void (*Callback)(Monostable *timer, void *context);
+
+  /** Retriggerable monostable timer
+   *  Timers are owned by their users and linked into the wheel while running: there is no dynamic allocation */
+  class Monostable
+  {
+  public:
+    Monostable(Callback callback = 0, void *context = 0);
+
+    void setCallback(Callback callback, void *context);
+
+    // (Re)start the timer, the callback is called from Wheel::update() after at least ms milliseconds
+    void start(uint32_t ms);
+    void stop();
+
+    bool isRunning() { return this->m_slot != c_stopped; };
+    uint32_t remaining();
+
+  private:
+    friend class Wheel;
+
+    static const uint8_t c_stopped = 0xFF;
+
+    Callback m_callback;
+    void *m_context;
+    Monostable *m_next;
+    Monostable *m_prev;
+    uint32_t m_expiry;
+    uint8_t m_slot;
+  };
+
+  /** Hashed timer wheel driven by millis()
+   *  Each slot holds the list of timers expiring on a tick modulo c_wheelSlots: start and stop are O(1),
+   *  and each tick only visits the timers of its slot */
+  class Wheel
+  {
+  public:
+    Wheel();
+
+    // Advance the wheel to the current time and call the callbacks of the expired timers
+    void update();
+
+    uint32_t tick() { return this->m_tick; };
+    uint16_t runningCount() { return this->m_runningCount; };
+
+  private:
+    friend class Monostable;
+
+    void link(Monostable *timer, uint32_t expiry);
+    void unlink(Monostable *timer);
+    void expire(uint8_t slot);
+
+    Monostable *m_slots[c_wheelSlots];
+    uint32_t m_tick;
+    uint32_t m_lastTickTime;
+    uint16_t m_runningCount;
+  };
+
+  // The wheel of the firmware, updated from the main loop
+  extern Wheel wheel;
+
+} // namespace Timer
+
+#endif //_TIMERWHEEL_H
@@ -4,15 +4,27 @@
 #include <avr/sleep.h>
 #include "cc1101.h"
 #include <EnableInterrupt.h>
-#include "bit_funcs.h"
 #include "InOneManager.h"
 #include "InOneSwitch.h"
 #include "IdeoManager.h"
-#include "IdeoSerial.h"
+#include "Protocol.h"
+#include "TimerWheel.h"
+#include "Scheduler.h"
+#include "SerialLine.h"
+#include "Log.h"
+#include "Stats.h"
+#include "Clock.h"
+#include "Memory.h"
+#include "Keypad.h"
+#include "Display.h"
 #include <LiquidCrystal.h>
 
 // Initialize LiquidCrystal library with DFRobot LCD-keypad shield pin assignments
 LiquidCrystal lcd(8, 9, 4, 5, 6, 7);
+// The LCD is only written from the display task, one character per run
+Display::Framebuffer display(&lcd);
+// Status redraw period
+const uint16_t c_statusRefreshMs = 250;
 
 using namespace CC1101;
 
@@ -20,257 +32,389 @@ using namespace CC1101;
 #define IOBL_SS_PIN 3
 #define IOBL_INT_PIN 2
 
+// Pin assignment for the CC1101 TRX dedicated to the Ideo protocol, which may be defined at build time
+// When identical to the IOBL pins, a single TRX is shared and reconfigured for each Ideo command
+#ifndef IDEO_SS_PIN
+#define IDEO_SS_PIN IOBL_SS_PIN
+#define IDEO_INT_PIN IOBL_INT_PIN
+#endif
+
+#if IDEO_SS_PIN != IOBL_SS_PIN
+#define DUAL_RADIO
+#endif
+
 InOne::Manager inOneManager(IOBL_SS_PIN, IOBL_INT_PIN);
 InOne::Switch sw(0x1CAFE, &inOneManager);
 
-Ideo::Manager ideoManager(IOBL_SS_PIN, IOBL_INT_PIN);
-bool isIdeoMode = false;
+Ideo::Manager ideoManager(IDEO_SS_PIN, IDEO_INT_PIN);
+
+// All protocols handled by the gateway. The first protocol registered on a TRX is its default listener
+Protocol::Registry protocols;
+// Rotates the IOBL TRX between the protocols sharing it (no-op when the Ideo TRX is dedicated)
+Protocol::ListenScheduler listenScheduler(&protocols, IOBL_INT_PIN);
+
+// Cooperative tasks replacing the main loop body, by decreasing priority
+void rfTaskRun();
+void protocolTaskRun();
+void timerTaskRun();
+void serialTaskRun();
+void outputTaskRun();
+void logTaskRun();
+void keypadTaskRun();
+void displayTaskRun();
+
+// Received packets are decoded and printed as soon as the radio interrupt signals them
+Tasks::Task rfTask(rfTaskRun, Tasks::Priority::RealTime, 0, 4000);
+Tasks::Task protocolTask(protocolTaskRun, Tasks::Priority::High, 10, 1000);
+Tasks::Task timerTask(timerTaskRun, Tasks::Priority::High, Timer::c_tickMs, 1000);
+Tasks::Task serialTask(serialTaskRun, Tasks::Priority::Normal, 2, 2000);
+// Refills the UART transmit buffer from the output queues as it drains
+Tasks::Task outputTask(outputTaskRun, Tasks::Priority::High, 1, 200);
+// Formats the log records in the background
+Tasks::Task logTask(logTaskRun, Tasks::Priority::Low, 20, 1000);
+// The keypad is sampled and debounced by the ADC interrupt, the task only consumes its events
+Tasks::Task keypadTask(keypadTaskRun, Tasks::Priority::Low, 50, 500);
+Tasks::Task displayTask(displayTaskRun, Tasks::Priority::Low, 2, 300);
+
+Tasks::Scheduler scheduler;
 
 // Interrupt callback that will be called on incoming RX packet
+// It is forwarded to the protocol currently attached to the TRX
 void rfCallback()
 {
+  STATS_ISR_BEGIN();
   disableInterrupt(IOBL_INT_PIN);
-
-  // if we are using Ideo command/response, forward to ideoManager
-  if (isIdeoMode)
-    ideoManager.rfRxCallback();
-  // otherwise (listening mode), forward to inOneManager
-  else
-    inOneManager.rfRxCallback();
-
+  protocols.rfRxCallback(IOBL_INT_PIN);
+  rfTask.signal();
   enableInterrupt(IOBL_INT_PIN, rfCallback, RISING);
+  STATS_ISR_END();
 }
 
-/** Énumération des boutons utilisables */
-enum
+#ifdef DUAL_RADIO
+// Interrupt callback for the TRX dedicated to Ideo, which is always listening
+void ideoRfCallback()
 {
-  BUTTON_NONE,  /*!< Pas de bouton appuyé */
-  BUTTON_UP,    /*!< Bouton UP (haut) */
-  BUTTON_DOWN,  /*!< Bouton DOWN (bas) */
-  BUTTON_LEFT,  /*!< Bouton LEFT (gauche) */
-  BUTTON_RIGHT, /*!< Bouton RIGHT (droite) */
-  BUTTON_SELECT /*!< Bouton SELECT */
-};
-
-/** Retourne le bouton appuyé (si il y en a un) */
-byte getPressedButton()
-{
-
-  /* Lit l'état des boutons */
-  int value = analogRead(A0);
-
-  /* Calcul l'état des boutons */
-  if (value < 50)
-    return BUTTON_RIGHT;
-  else if (value < 200)
-    return BUTTON_UP;
-  else if (value < 350)
-    return BUTTON_DOWN;
-  else if (value < 500)
-    return BUTTON_LEFT;
-  else if (value < 850)
-    return BUTTON_SELECT;
-  else
-    return BUTTON_NONE;
+  STATS_ISR_BEGIN();
+  disableInterrupt(IDEO_INT_PIN);
+  protocols.rfRxCallback(IDEO_INT_PIN);
+  rfTask.signal();
+  enableInterrupt(IDEO_INT_PIN, ideoRfCallback, RISING);
+  STATS_ISR_END();
 }
+#endif
+
+// Command lines received from the host
+SerialLine::Assembler serialInput;
+// Baud rate and flow control negotiated with the host
+SerialLine::Link serialLink(&serialInput);
 
 //---------------------------------[SETUP]-----------------------------------
 void setup()
 {
   // init serial Port for debugging
-  Serial.begin(115200);
+  serialLink.begin();
   Serial.println(F("Begin CC1101 setup"));
+  STATS_BEGIN();
+
+#ifdef DUAL_RADIO
+  // Both TRX share the SPI bus: deselect the Ideo TRX before talking to the IOBL one
+  pinMode(IDEO_SS_PIN, OUTPUT);
+  digitalWrite(IDEO_SS_PIN, HIGH);
+#endif
 
-  // Start Legrand IOBL Manager
-  inOneManager.begin();
+  // Start the default protocol of each TRX: Legrand IOBL, and Ideo if it has its own TRX
+  protocols.add(&inOneManager);
+  protocols.add(&ideoManager);
+  protocols.begin();
+  // Mostly listen for InOne switches, but also catch unsolicited Ideo frames. The Ideo slot is shorter than the
+  // repeated frames of a switch press, so that a press keeps a frame in the InOne slot
+  listenScheduler.setSlot(&inOneManager, 800);
+  listenScheduler.setSlot(&ideoManager, 50);
+  // Seed the listen-before-talk backoff with radio noise, so that gateways do not back off in lockstep
+  randomSeed(inOneManager.radio()->readNoiseSeed());
 
   enableInterrupt(IOBL_INT_PIN, rfCallback, RISING);
 
-  lcd.begin(16, 2);
-  lcd.print(F("IOBL Manager"));
+#ifdef DUAL_RADIO
+  enableInterrupt(IDEO_INT_PIN, ideoRfCallback, RISING);
+#endif
+
+  scheduler.add(&rfTask, F("rf"));
+  scheduler.add(&protocolTask, F("protocol"));
+  scheduler.add(&timerTask, F("timer"));
+  scheduler.add(&serialTask, F("serial"));
+  scheduler.add(&outputTask, F("output"));
+  scheduler.add(&logTask, F("log"));
+  scheduler.add(&keypadTask, F("keypad"));
+  scheduler.add(&displayTask, F("display"));
+
+  Keypad::begin();
+  display.begin();
+  display.print(F("IOBL Manager"));
 
   Serial.println(F("CC1101 TX Demo")); //welcome message
 }
 
-//---------------------------------[LOOP]-----------------------------------
-void loop()
+//---------------------------------[TASKS]-----------------------------------
+// Shown on the display once a switch has been heard
+bool isInOneReceived = false;
+
+void rfTaskRun()
 {
-  static uint8_t prev_button = 0;
-  static char serial_buffer[32];
-  static uint8_t serial_ptr = 0;
-  static const char delims[] = ",";
+  for (uint8_t i = 0; i < protocols.count(); i++)
+  {
+    Protocol::Manager *manager = protocols.get(i);
+    if (protocols.isAttached(manager) && manager->isPacketAvailable())
+    {
+      STATS_PACKET_DECODED();
+      listenScheduler.onPacket(manager);
+      manager->printLastPacket();
+      if (manager == &inOneManager)
+        isInOneReceived = true;
+    }
+  }
+}
 
-  uint8_t button = getPressedButton();
-  if (button != BUTTON_NONE && prev_button == BUTTON_NONE)
+void protocolTaskRun()
+{
+  for (uint8_t i = 0; i < protocols.count(); i++)
+  {
+    Protocol::Manager *manager = protocols.get(i);
+    if (protocols.isAttached(manager))
+      manager->poll();
+  }
+  listenScheduler.update();
+}
+
+// Auto-off and learn mode timeouts
+void timerTaskRun()
+{
+  Timer::wheel.update();
+  // Keep track of the micros() rollovers between packets
+  Clock::now();
+}
+
+// Drain the serial input and process at most one command line per run
+void serialTaskRun()
+{
+  static char line[SerialLine::c_maxLineLength + 1];
+
+  serialInput.poll();
+  if (!serialInput.readLine(line))
+    return;
+
+  // Commands may keep the loop busy for a while (radio transmissions, Ideo response waits)
+  serialInput.hold();
+  SerialLine::Parser parser(line);
+  if (parser.readKeyword(F("listen")))
   {
-    switch (button)
+    // "listen" prints the listen schedule report, "listen,<channel>,<slot ms>" configures a slot
+    uint8_t channel;
+    uint32_t duration;
+    if (!parser.isEndOfRecord())
     {
-    case BUTTON_UP:
-      sw.turnOn(InOne::Channel::Left);
-      Serial.println("BUTTON_UP");
-      break;
-    case BUTTON_DOWN:
-      sw.turnOff(InOne::Channel::Left);
-      Serial.println("BUTTON_DOWN");
-      break;
-    case BUTTON_LEFT:
-      sw.turnOn(InOne::Channel::Right);
-      Serial.println("BUTTON_LEFT");
-      break;
-    case BUTTON_RIGHT:
-      sw.turnOff(InOne::Channel::Right);
-      Serial.println("BUTTON_RIGHT");
-      break;
-    case BUTTON_SELECT:
-      if (sw.isLearnMode())
-        sw.stopLearn();
+      if (parser.readUInt(&channel, 9) && parser.readUInt(&duration, 0xFFFF))
+        listenScheduler.setSlot(protocols.find(channel), duration);
       else
-        sw.startLearn();
-      Serial.println("BUTTON_SELECT");
-      break;
+        parser.printError();
     }
+    listenScheduler.printReport();
+  }
+  else if (parser.readKeyword(F("tasks")))
+  {
+    scheduler.processSerialCommand(&parser);
+  }
+  else if (parser.readKeyword(F("hello")))
+  {
+    // Version and capabilities handshake, which also confirms a new baud rate:
+    // "hello,<version>,<serial channel>:<protocol>...,xonxoff,baud,clock"
+    serialLink.processHello(&parser);
+    SerialLine::packetOutput.print(F("hello,"));
+    SerialLine::packetOutput.print(SerialLine::c_protocolVersion);
+    for (uint8_t i = 0; i < protocols.count(); i++)
+    {
+      SerialLine::packetOutput.print(',');
+      SerialLine::packetOutput.print(protocols.get(i)->serialChannel());
+      SerialLine::packetOutput.print(':');
+      SerialLine::packetOutput.print(protocols.get(i)->name());
+    }
+    SerialLine::packetOutput.println(F(",xonxoff,baud,clock"));
+  }
+  else if (parser.readKeyword(F("baud")))
+  {
+    serialLink.processBaud(&parser);
+  }
+  else if (parser.readKeyword(F("clock")))
+  {
+    // "clock,<device time>" lets the host map the packet timestamps to its own clock
+    SerialLine::packetOutput.print(F("clock,"));
+    Clock::print(&SerialLine::packetOutput, Clock::now());
+    SerialLine::packetOutput.println();
+  }
+  else if (parser.readKeyword(F("serial")))
+  {
+    SerialLine::printOutputStats(&serialInput);
+  }
+  else if (parser.readKeyword(F("memory")))
+  {
+    Memory::printReport();
+  }
+#if STATS_ENABLED
+  else if (parser.readKeyword(F("stats")))
+  {
+    Stats::processSerialCommand(&parser);
   }
-  prev_button = button;
+#endif
+  else if (line[0] >= '0' && line[0] <= '9')
+  {
+    // Route the command to the protocol owning this serial channel, without the "<channel>>" (or "<channel>,") prefix
+    Protocol::Manager *manager = protocols.find(line[0] - '0');
+    if (manager != NULL)
+      manager->processSerialCommand(line[1] == '>' || line[1] == ',' ? &line[2] : &line[1]);
+  }
+  serialInput.release();
+
+  // Queued commands are processed on the next passes
+  if (serialInput.isLineAvailable())
+    serialTask.signal();
+}
+
+void outputTaskRun()
+{
+  SerialLine::drainOutput();
+}
+
+void logTaskRun()
+{
+  Log::flush();
+}
 
-  if (Serial.available())
+void keypadTaskRun()
+{
+  Keypad::Event event;
+  while (Keypad::read(&event))
   {
-    char c = Serial.read();
-    if (c != '\r' && c != '\n' && serial_ptr < 32)
+    // Channel buttons act on release: a short press switches the channel, a hold dims it without switching it first
+    if (event.type == Keypad::EventType::Release && event.button != Keypad::Button::Select &&
+        event.heldSamples < Keypad::c_longPressSamples)
     {
-      serial_buffer[serial_ptr++] = c;
+      switch (event.button)
+      {
+      case Keypad::Button::Up:
+        sw.turnOn(InOne::Channel::Left);
+        SerialLine::debugOutput.println(F("BUTTON_UP"));
+        break;
+      case Keypad::Button::Down:
+        sw.turnOff(InOne::Channel::Left);
+        SerialLine::debugOutput.println(F("BUTTON_DOWN"));
+        break;
+      case Keypad::Button::Left:
+        sw.turnOn(InOne::Channel::Right);
+        SerialLine::debugOutput.println(F("BUTTON_LEFT"));
+        break;
+      case Keypad::Button::Right:
+        sw.turnOff(InOne::Channel::Right);
+        SerialLine::debugOutput.println(F("BUTTON_RIGHT"));
+        break;
+      default:
+        break;
+      }
     }
-    if (c == '\n' || c == '\r')
+    else if (event.button != Keypad::Button::Select)
     {
-      serial_buffer[serial_ptr] = 0;
-      if (serial_ptr == 32)
+      // Holding a channel button dims its channel up or down until the button is released
+      if (event.type == Keypad::EventType::LongPress)
       {
-        Serial.println("Serial RX buffer overrun");
+        InOne::Channel channel = event.button == Keypad::Button::Up || event.button == Keypad::Button::Down ? InOne::Channel::Left : InOne::Channel::Right;
+        sw.startDim(channel, event.button == Keypad::Button::Up || event.button == Keypad::Button::Left ? InOne::c_dimUp : InOne::c_dimDown);
       }
-      else if (serial_buffer[0] == '0')
+      else if (event.type == Keypad::EventType::Release)
+        sw.stopDim();
+    }
+    else
+    {
+      // A short press toggles the learn mode, a long press redraws the whole display
+      if (event.type == Keypad::EventType::LongPress)
       {
-        char *token = strtok(&serial_buffer[2], delims);
-        InOne::Packet packet;
-        packet.isLearnMode = false;
-        packet.type = InOne::PacketType::Short;
-        uint8_t ntok = 0;
-        while (token != NULL)
-        {
-          switch (ntok++)
-          {
-          case 0:
-            packet.sequenceIndex = atoi(token);
-            break;
-          case 1:
-            packet.id = atol(token);
-            break;
-          case 2:
-            packet.channel = (InOne::Channel)atoi(token);
-            break;
-          case 3:
-            packet.command = (InOne::Command)atoi(token);
-            break;
-          case 4:
-            packet.isLearnMode = strcmp(token, "L") == 0;
-            break;
-          case 5:
-            packet.data[0] = atoi(token);
-            break;
-          case 6:
-            packet.data[1] = atoi(token);
-            break;
-          case 7:
-            packet.data[2] = atoi(token);
-            break;
-          }
-          token = strtok(NULL, delims);
-        }
-        if (ntok > 3)
-        {
-          if (ntok > 5)
-            packet.type = InOne::PacketType::Long;
-          else if (ntok == 5)
-            packet.type = InOne::PacketType::Medium;
-          inOneManager.sendPacket(&packet);
-        }
-        else
-        {
-          Serial.print("Not enough data, got tokens: ");
-          Serial.println(ntok);
-        }
+        display.invalidate();
+        SerialLine::debugOutput.println(F("BUTTON_SELECT_LONG"));
       }
-      else if (serial_buffer[0] == '1')
+      else if (event.type == Keypad::EventType::Release && event.heldSamples < Keypad::c_longPressSamples)
       {
-        disableInterrupt(IOBL_INT_PIN);
-        isIdeoMode = true;
-        inOneManager.detachRadio();
-        ideoManager.attachRadio();
-        enableInterrupt(IOBL_INT_PIN, rfCallback, RISING);
-
-        Ideo::TxPacketData tx;
-        Ideo::RxPacketData rx;
-
-        if (Ideo::SerialParser::parseMessage(&serial_buffer[2], &tx))
-        {
-          ideoManager.commandResponse(&tx, &rx);
-          Serial.print("1>");
-          Ideo::SerialParser::print(&rx);
-        }
-
-        disableInterrupt(IOBL_INT_PIN);
-        isIdeoMode = false;
-        ideoManager.detachRadio();
-        inOneManager.attachRadio();
-        enableInterrupt(IOBL_INT_PIN, rfCallback, RISING);
+        if (sw.isLearnMode())
+          sw.stopLearn();
+        else
+          sw.startLearn();
+        SerialLine::debugOutput.println(F("BUTTON_SELECT"));
       }
-      serial_ptr = 0;
     }
   }
+}
 
-  if (inOneManager.isPacketAvailable())
+// Last switch heard, its signal strength, packet output queue depth and learn mode:
+// "1CAFE L On"
+// "-72dBm Q 12  LRN"
+void renderStatus()
+{
+  display.clear();
+  if (isInOneReceived)
   {
-    InOne::Packet rxPacket;
-    inOneManager.getLastPacket(&rxPacket);
-    Serial.print("0>");
-    Serial.print(rxPacket.sequenceIndex);
-    Serial.print(',');
-    Serial.print(rxPacket.id);
-    Serial.print(',');
-    Serial.print((uint8_t)rxPacket.channel);
-    Serial.print(',');
-    Serial.print((uint8_t)rxPacket.command);
-    if (rxPacket.isLearnMode || rxPacket.type != InOne::PacketType::Short)
-      Serial.print(',');
-    if (rxPacket.isLearnMode)
-      Serial.print('L');
-    if (rxPacket.type != InOne::PacketType::Short)
-    {
-      Serial.print(',');
-      Serial.print(rxPacket.data[0]);
-    }
-    if (rxPacket.type == InOne::PacketType::Long)
+    const InOne::Packet *packet = inOneManager.lastPacket();
+    // Switch IDs are 5 hex digits
+    for (int8_t shift = 16; shift >= 0; shift -= 4)
+      display.print((packet->id >> shift) & 0xF, HEX);
+    display.print(packet->channel == InOne::Channel::Left ? F(" L ") : packet->channel == InOne::Channel::Right ? F(" R ") : F(" - "));
+    switch (packet->command)
     {
-      Serial.print(',');
-      Serial.print(rxPacket.data[1]);
-      Serial.print(',');
-      Serial.print(rxPacket.data[2]);
+    case InOne::Command::On:
+      display.print(F("On"));
+      break;
+    case InOne::Command::Off:
+      display.print(F("Off"));
+      break;
+    case InOne::Command::DimStart:
+      display.print(F("Dim"));
+      break;
+    case InOne::Command::DimStop:
+      display.print(F("Dim stop"));
+      break;
+    default:
+      display.print((uint8_t)packet->command);
+      break;
     }
-    Serial.println();
+    display.setCursor(0, 1);
+    display.print(inOneManager.lastRssi());
+    display.print(F("dBm"));
   }
+  else
+    display.print(F("IOBL Manager"));
 
-  if (ideoManager.isPacketAvailable())
+  display.setCursor(7, 1);
+  display.print(F("Q "));
+  display.print(SerialLine::packetOutput.count());
+  if (sw.isLearnMode())
   {
-    Ideo::RxPacketData rxPacket;
-    ideoManager.getLastPacket(&rxPacket);
-    Serial.print("1>");
-    Serial.print(rxPacket.device);
-    Serial.print(',');
-    Serial.print(rxPacket.command >> 4, HEX);
-    Serial.print(rxPacket.command & 0xF, HEX);
-    Serial.print(',');
-    Ideo::printParams(rxPacket.params);
-    Serial.print(',');
-    Serial.print(rxPacket.rssi);
-    Serial.print(',');
-    Serial.println(rxPacket.lqi);
+    display.setCursor(13, 1);
+    display.print(F("LRN"));
   }
 }
+
+void displayTaskRun()
+{
+  static uint32_t lastRender = 0;
+
+  if (millis() - lastRender >= c_statusRefreshMs)
+  {
+    lastRender = millis();
+    renderStatus();
+  }
+  display.flushNext();
+}
+
+//---------------------------------[LOOP]-----------------------------------
+void loop()
+{
+  STATS_LOOP_BEGIN();
+  scheduler.run();
+  STATS_LOOP_END();
+}
@@ -27,9 +27,12 @@ class ConfigLight:
         return self.name + " (" + self.topic + ") control: " + str(self.control) + " bound: " + str(self.bound) + " timer: " + str(self.timer)
 
 class ConfigIdeo:
-    def __init__(self, minAirflow, maxAirflow):
+    def __init__(self, minAirflow, maxAirflow, topic = "ideo", device = 0, channel = 0):
         self.minAirflow = minAirflow
         self.maxAirflow = maxAirflow
+        self.topic = topic
+        self.device = device
+        self.channel = channel
 
 class ConfigReader:
     def __init__(self, filename):
@@ -40,6 +43,10 @@ class ConfigReader:
     def getSerialPort(self):
         return self.__general.get("SerialPort", "COM1")
 
+    # Fastest baud rate negotiated with the gateway
+    def getSerialBaudrate(self):
+        return self.__general.getint("SerialBaudrate", 1000000)
+
     def getMqttHost(self):
         return self.__general.get("MqttHost", "127.0.0.1")
 
@@ -56,12 +63,30 @@ class ConfigReader:
     def getVirtualSwitches(self):
         return self._getNamedSwitches('VirtualSwitches')
 
-    def ideo(self):
+    def _getIdeo(self, section, topic):
+        unit = self.__parser[section]
         return ConfigIdeo(
-            int(self.__parser["Ideo"].get("AirflowLow", "90")),
-            int(self.__parser["Ideo"].get("AirflowHigh", "325"))
+            int(unit.get("AirflowLow", "90")),
+            int(unit.get("AirflowHigh", "325")),
+            unit.get("Topic", topic),
+            int(unit.get("Device", "0")),
+            int(unit.get("Channel", "0"))
         )
 
+    def ideo(self):
+        return self._getIdeo("Ideo", "ideo")
+
+    # The [Ideo] unit, and one unit per [Ideo:<name>] section
+    # Each unit is identified by its sync channel and device ID
+    def getIdeoUnits(self):
+        units = []
+        for section in self.__parser.sections():
+            if section == "Ideo":
+                units.append(self._getIdeo(section, "ideo"))
+            elif section.startswith("Ideo:"):
+                units.append(self._getIdeo(section, "ideo_" + section[len("Ideo:"):].lower()))
+        return units
+
     def _parseSwitchChannel(self, str):
         tokens = str.strip().split(",")
         name = tokens[0].strip().lower()
@@ -1,4 +1,5 @@
 from enum import Enum
+import time
 
 class AirflowState(Enum):
     Low = 1
@@ -16,15 +17,29 @@ class Schedule(Enum):
     Manual = 4
 
 class Ideo:
-    def __init__(self, out):
+    def __init__(self, out, deviceId = 0, channel = 0):
         self.__out = out
         self._lowSpeed = 90
-        self._deviceId = 0
+        self._deviceId = deviceId
+        # Sync channel of the unit, units on channel 0 are addressed by their device ID only
+        self._channel = channel
+        self._deviceToken = str(deviceId) + ("@" + str(channel) if channel != 0 else "")
         self._listeners = []
+        self._pollStartTime = None
 
-    def _send(self, command, params):
+    def _format(self, command, params):
         output = "{0},{1:02X},{2:08X}".format(self._deviceId, command, params)
-        self.__out.write(output)
+        if self._channel != 0:
+            output += ",{0}".format(self._channel)
+        return output
+
+    def _send(self, command, params):
+        self.__out.write(self._format(command, params))
+
+    # Send several commands on one line: the gateway keeps the radio
+    # in the Ideo profile for the whole batch, and groups the responses
+    def _sendBatch(self, commands):
+        self.__out.write(";".join(self._format(c, p) for c, p in commands))
 
     # Bouton boost cuisine (vitesse max pendant 30 minutes)
     def boost(self):
@@ -60,15 +75,42 @@ class Ideo:
     def requestStatus(self):
         self._send(0x33,0)
 
+    # Temperatures and status in a single poll cycle
+    def requestAll(self):
+        self._pollStartTime = time.monotonic()
+        self._sendBatch([(0x31,0), (0x32,0), (0x33,0)])
+
     def register(self, listener):
         self._listeners.append(listener)
             
     def parseIncomingMessage(self, message):
-        message = message.strip(" \r\n")
+        records = message.strip(" \r\n").split(";")
+        # Any reply ends the poll cycle, the gateway skips empty responses and may answer with a single record
+        if self._pollStartTime is not None:
+            print("Ideo poll cycle: {0:.0f} ms".format((time.monotonic() - self._pollStartTime) * 1000))
+            self._pollStartTime = None
+        for record in records:
+            self._parseRecord(record)
+
+    def _parseRecord(self, message):
         tokens = message.split(",")
 
         if (len(tokens) < 3): return
 
+        # Typed record decoded by the gateway: #<tag>,<device>,<field>,...
+        # Temperatures are in tenths of degrees
+        if tokens[0].startswith("#"):
+            if tokens[1] != self._deviceToken: return
+            tag = tokens[0][1:]
+            fields = [int(t) for t in tokens[2:]]
+            if tag == "I" or tag == "O":
+                self._notifyTemperature(tag, fields[0] / 10.0, fields[1] / 10.0)
+            if tag == "S":
+                self._notifyStatus(fields[0], fields[1])
+            return
+
+        # Raw record: <device>,<command>,<params>
+        if tokens[0] != self._deviceToken: return
         command = int(tokens[1], 16)
         params = int(tokens[2], 16)
 
@@ -76,21 +118,25 @@ class Ideo:
         
         # Inside inlet (inside dirty air) temperature topic
         if command == 0x31:
-            inlet_temp = (params >> 16) / 10.0 
-            outlet_temp = (params & 0xFFFF) / 10.0
-            for r in self._listeners:
-                r.onInsideTemperatureUpdate(inlet_temp, outlet_temp)
+            self._notifyTemperature("I", (params >> 16) / 10.0, (params & 0xFFFF) / 10.0)
 
         # Outside inlet (fresh air) temperature topic
         if command == 0x32:
-            inlet_temp = (params >> 16) / 10.0
-            outlet_temp = (params & 0xFFFF) / 10.0
-            for r in self._listeners:
-                r.onOutsideTemperatureUpdate(inlet_temp, outlet_temp)
+            self._notifyTemperature("O", (params >> 16) / 10.0, (params & 0xFFFF) / 10.0)
 
         # Status topic
         if command == 0x33:
-            airflow = AirflowState ((params >> 16) & 0xf)
-            bypass = BypassState ((params >> 12) & 0xf)
-            for r in self._listeners:
-                r.onStatusUpdate(airflow, bypass)
\ No newline at end of file
+            self._notifyStatus((params >> 16) & 0xf, (params >> 12) & 0xf)
+
+    def _notifyTemperature(self, tag, inlet_temp, outlet_temp):
+        for r in self._listeners:
+            if tag == "I":
+                r.onInsideTemperatureUpdate(inlet_temp, outlet_temp)
+            else:
+                r.onOutsideTemperatureUpdate(inlet_temp, outlet_temp)
+
+    def _notifyStatus(self, airflow, bypass):
+        airflow = AirflowState(airflow)
+        bypass = BypassState(bypass)
+        for r in self._listeners:
+            r.onStatusUpdate(airflow, bypass)
\ No newline at end of file
@@ -17,8 +17,14 @@ class TurnEvent(Event):
         return super().__eq__(other) and \
             self.command == other.command
 
+class DoubleClickEvent(TurnEvent):
+    pass
+
 class HoldEvent(TurnEvent):
     pass
 
 class ReleaseEvent(Event):
-    pass
+    def __init__(self, id, channel: Channel, duration = None):
+        super().__init__(id, channel)
+        # Hold duration in ms, when reported by the gateway
+        self.duration = duration
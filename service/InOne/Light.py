@@ -91,6 +91,9 @@ class TimerLight(Light):
         if self.state() != State.Hold:
             super().turnOn()
 
+    def duration(self):
+        return self.__duration
+
     def setDuration(self, duration):
         self.__duration = duration
         # If the light was on, cancel the existing timer
@@ -1,5 +1,5 @@
 from InOne.Enums import Command, Channel
-from InOne.Event import TurnEvent, HoldEvent, ReleaseEvent
+from InOne.Event import TurnEvent, DoubleClickEvent, HoldEvent, ReleaseEvent
 
 class MessageParser:
     def __init__(self, dispatcher):
@@ -8,6 +8,9 @@ class MessageParser:
         message = message.strip(" \r\n")
         tokens = message.split(",")
         #tokens = re.split('[\W]+', message)
+        if tokens[0] == "gesture":
+            self.__parseGesture(tokens)
+            return
         if len(tokens) >= 4:
             id = int(tokens[1])
             channel = Channel(int(tokens[2]))
@@ -24,3 +27,16 @@ class MessageParser:
                 if tokens[5] == '128':
                     holdCommand = Command.Off
                 self.__dispatcher.onEvent(HoldEvent(id, channel, holdCommand))
+    # (private) "gesture,<id>,<channel>,<gesture>,<value>", one line per gesture of a switch channel
+    def __parseGesture(self, tokens):
+        id = int(tokens[1])
+        channel = Channel(int(tokens[2]))
+        value = int(tokens[4])
+        if tokens[3] == "click":
+            self.__dispatcher.onEvent(TurnEvent(id, channel, Command(value)))
+        elif tokens[3] == "double":
+            self.__dispatcher.onEvent(DoubleClickEvent(id, channel, Command(value)))
+        elif tokens[3] == "hold":
+            self.__dispatcher.onEvent(HoldEvent(id, channel, Command(value)))
+        elif tokens[3] == "release":
+            self.__dispatcher.onEvent(ReleaseEvent(id, channel, value))
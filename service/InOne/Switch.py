@@ -17,6 +17,8 @@ class Switch:
     def __init__(self, id, out=OutputInterface(), dispatcher=Dispatcher()): 
         if type(id) != int or id < 0 or id > 0xFFFFF:
             raise ValueError("'id' must be a positive integer in the [0, 0xFFFFFF] range.")
+        # The gateway renumbers the commands of the switches it controls through its bindings,
+        # this counter only matters for the other IDs
         self.__sequenceNumber = 0
         self.__learn = False
         self.__id = id
@@ -26,7 +28,7 @@ class Switch:
     def __shortPress(self, channel: Channel, command: Command):
         output = str(self.__sequenceNumber) + ',' + \
             str(self.__id) + ',' + str(channel.value) + ',' + str(command.value)
-        self.__out.write(bytes(output, 'utf8'))
+        # The gateway waits for a clear channel before transmitting: a single write is enough
         self.__out.write(bytes(output, 'utf8'))
         self.__incrementSequenceCounter()
 
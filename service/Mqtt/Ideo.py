@@ -19,9 +19,7 @@ class Ideo:
         self.__timer.cancel()
 
     def _requestAll(self):
-        self.__ideo.requestInsideTemp()
-        self.__ideo.requestOutsideTemp()
-        self.__ideo.requestStatus()
+        self.__ideo.requestAll()
 
     def stopTimer(self):
         self.__timer.cancel()
@@ -43,9 +41,7 @@ class Ideo:
                 self.__ideo.setDirtyFilterRpmThreshold(int(float(msg.payload)))
 
             if not subtopic.startswith("/state"):
-                self.__ideo.requestInsideTemp()
-                self.__ideo.requestOutsideTemp()
-                self.__ideo.requestStatus()
+                self.__ideo.requestAll()
         except e:
             print("Exception while parsing MQTT payload: " + str(s))
 
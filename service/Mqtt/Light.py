@@ -40,6 +40,11 @@ class TimerLight(InOne.TimerLight, Light):
     def __init__(self, topic, client, duration = 0):
         InOne.TimerLight.__init__(self, duration)
         Light.__init__(self, topic, client)
+        self.__onTimerChange = None
+
+    # Called after the timer duration was changed via MQTT
+    def setTimerChangeCallback(self, callback):
+        self.__onTimerChange = callback
         
     def on_message(self, client, userdata, msg):
         super().on_message(client, userdata, msg)
@@ -49,6 +54,8 @@ class TimerLight(InOne.TimerLight, Light):
             try:
                 duration = int(msg.payload)
                 self.setDuration(duration)
+                if self.__onTimerChange is not None:
+                    self.__onTimerChange()
             except Exception as e:
                 print("Exception while parsing duration: " + str(e))
 
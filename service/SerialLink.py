@@ -0,0 +1,81 @@
+import serial
+import time
+
+"""
+SerialLink
+Opens the serial link to the gateway with a version/capability handshake,
+then switches to the fastest baud rate supported by both sides
+The gateway falls back to the default rate when a new rate is not confirmed
+"""
+class SerialLink:
+    DefaultBaudrate = 115200
+    # Exact rates on a 16 MHz AVR, fastest first
+    FastBaudrates = [1000000, 500000, 250000]
+    # Time the gateway waits for a new rate to be confirmed
+    ConfirmTimeout = 1.0
+
+    def __init__(self, port, maxBaudrate=1000000, timeout=0.5):
+        self.__port = port
+        self.__maxBaudrate = maxBaudrate
+        self.__version = None
+        self.__capabilities = []
+        # Host-to-gateway commands are paused by XON/XOFF when the gateway input is full
+        self.__serial = serial.Serial(port, SerialLink.DefaultBaudrate, timeout=timeout, xonxoff=True)
+
+    def open(self):
+        # Opening the port resets the gateway: give it time to boot
+        if not self.__hello(10):
+            raise IOError("No answer from the gateway on " + self.__port)
+        print("Gateway protocol version " + str(self.__version) + ": " + ",".join(self.__capabilities))
+        if "baud" in self.__capabilities:
+            for baudrate in SerialLink.FastBaudrates:
+                if baudrate <= self.__maxBaudrate and self.__switchBaudrate(baudrate):
+                    break
+        print("Serial link at " + str(self.__serial.baudrate) + " bauds")
+        return self.__serial
+
+    def serial(self):
+        return self.__serial
+
+    def version(self):
+        return self.__version
+
+    def capabilities(self):
+        return self.__capabilities
+
+    # (private) Send a command and wait for the reply line starting with 'prefix', None on timeout
+    def __request(self, command, prefix, timeout=1.0):
+        self.__serial.write(bytes(command + "\n", 'utf8'))
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            line = self.__serial.readline().decode('utf-8', 'replace').strip()
+            if line.startswith(prefix):
+                return line
+        return None
+
+    # (private) Version and capability handshake: "hello,<version>,<capability>..."
+    def __hello(self, attempts):
+        for attempt in range(attempts):
+            self.__serial.reset_input_buffer()
+            reply = self.__request("hello,xonxoff", "hello,")
+            if reply is not None:
+                tokens = reply.split(",")
+                self.__version = int(tokens[1])
+                self.__capabilities = tokens[2:]
+                return True
+        return False
+
+    # (private) Switch both sides to a new rate, and check that the link still works
+    def __switchBaudrate(self, baudrate):
+        reply = self.__request("baud," + str(baudrate), "baud,")
+        if reply != "baud," + str(baudrate):
+            return False
+        self.__serial.baudrate = baudrate
+        if self.__hello(2):
+            return True
+        # Wait for the gateway to fall back to the default rate
+        self.__serial.baudrate = SerialLink.DefaultBaudrate
+        time.sleep(SerialLink.ConfirmTimeout)
+        if not self.__hello(3):
+            raise IOError("Lost the gateway after trying " + str(baudrate) + " bauds")
+        return False
\ No newline at end of file
@@ -1,8 +1,9 @@
 import paho.mqtt.client as mqtt
-import serial
 import signal
+import time
 
 from ConfigReader import ConfigReader
+from SerialLink import SerialLink
 
 import InOne
 import Ideo
@@ -52,8 +53,8 @@ client.on_connect = on_connect
 client.on_message = on_message
 
 
-ser = serial.Serial(config.getSerialPort(), 115200, timeout=0.5)
-while (not ser.readline().decode("utf-8").startswith("CC1101 TX")): pass
+link = SerialLink(config.getSerialPort(), config.getSerialBaudrate())
+ser = link.open()
 
 client.connect(config.getMqttHost())
 
@@ -95,12 +96,35 @@ for l in config.getLights():
     print("    timer: " + str(l.timer))
     dispatcher.register(lights[l.name])
 
-ideo = Ideo.Ideo(PrintAndSerialOutInt(1, ser))
-ideoConfig = config.ideo()
-ideo.setMaxAirflow(ideoConfig.maxAirflow)
-ideo.setMinAirflow(ideoConfig.minAirflow)
-mqttIdeo = Mqtt.Ideo(ideo, client, "ideo")
-ideo.register(mqttIdeo)
+# Upload the switch-to-light bindings to the gateway: bound switches and auto-off
+# timers are then handled locally, the lights still follow the gateway notifications
+def uploadBindings():
+    outputInterface.write("bind,clear")
+    for l in config.getLights():
+        control = virtualSwitches[l.control.name]
+        for bs in l.bound:
+            sourceChannel = 0 if bs.channel == InOne.Channel.Any else bs.channel.value
+            outputInterface.write("bind,{0},{1},{2},{3},{4}".format(
+                switches[bs.name], sourceChannel, control.id(), l.control.channel.value, lights[l.name].duration()))
+
+uploadBindings()
+# Receive one line per switch gesture rather than one per radio frame
+outputInterface.write("gesture,1")
+for l in lights.values():
+    l.setTimerChangeCallback(uploadBindings)
+
+print("Ideo units")
+ideos = []
+mqttIdeos = []
+for ideoConfig in config.getIdeoUnits():
+    ideo = Ideo.Ideo(PrintAndSerialOutInt(1, ser), ideoConfig.device, ideoConfig.channel)
+    print("  " + ideoConfig.topic + ": device " + str(ideoConfig.device) + ", channel " + str(ideoConfig.channel))
+    ideo.setMaxAirflow(ideoConfig.maxAirflow)
+    ideo.setMinAirflow(ideoConfig.minAirflow)
+    mqttIdeo = Mqtt.Ideo(ideo, client, ideoConfig.topic)
+    ideo.register(mqttIdeo)
+    ideos.append(ideo)
+    mqttIdeos.append(mqttIdeo)
 
 # Start monitoring MQTT messages
 client.loop_start()
@@ -118,7 +142,20 @@ class LoopManager:
 
 loop = LoopManager()
 
+# Host times are taken on the monotonic clock: intervals are not affected by clock adjustments
+def monotonicUs():
+    return time.monotonic_ns() // 1000
+
+# Ask the gateway for its clock now and then, which keeps the device clock mapping
+# of tools/rflatency.cpp up to date when no packet is received
+ClockInterval = 10.0
+isClockSupported = "clock" in link.capabilities()
+clockRequestTime = None
+
 while loop.run():
+    if isClockSupported and (clockRequestTime is None or monotonicUs() - clockRequestTime >= ClockInterval * 1000000):
+        clockRequestTime = monotonicUs()
+        ser.write(b"clock\n")
     # Read one line from the RF-to-serial interface
     #try:
     input_message = ser.readline()
@@ -128,15 +165,27 @@ while loop.run():
     if input_message != b'':
         # Strip all whitespace and newline from the received message
         input_string = input_message.decode('utf-8').rstrip()
+        read_time = monotonicUs()
         print("Serial > " + input_string)
+        # Reply to the clock request: "clock,<device time>"
+        if input_string.startswith("clock,"):
+            print("Clock > " + input_string[6:] + "," + str(clockRequestTime) + "," + str(read_time))
+            continue
+        # Received packets end with their device timing "|<received>,<decode us>,<emit us>"
+        input_string, _, timing = input_string.partition("|")
         # Try parsing the InOne message
         try:
             if input_string.startswith("0>"):
                 parser.parse(input_string[2:])
             if input_string.startswith("1>"):
-                ideo.parseIncomingMessage(input_string[2:])
+                for ideo in ideos:
+                    ideo.parseIncomingMessage(input_string[2:])
         except Exception as e:
             print("Exception while parsing the message:" + str(e))
+        # Host read and publish times (us of the monotonic clock), see tools/rflatency.cpp
+        if timing:
+            print("Timing > " + timing + "," + str(read_time) + "," + str(monotonicUs()))
 
-mqttIdeo.stopTimer()
+for mqttIdeo in mqttIdeos:
+    mqttIdeo.stopTimer()
 client.loop_stop()
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef _CLOCKSYNC_H
+#define _CLOCKSYNC_H
+
+/*---------------------------------------------------------------------------
+ * Maps the gateway clock (microseconds since its startup) to the host clock
+ *
+ * Each line read from the gateway gives a bound: the host read it after the device emitted it,
+ * so host - device is an upper bound of the clock offset. The smallest bound of each window is
+ * the closest to the true offset (plus the shortest serial transfer), and a line fitted through
+ * the last window minimums follows the drift of the gateway crystal.
+ */
+#include <cstdint>
+
+class ClockSync
+{
+public:
+  // Window length of the host clock, and number of windows kept for the drift estimate
+  static const int64_t c_windowUs = 30000000;
+  static const unsigned c_maxWindows = 20;
+
+  ClockSync() : m_windowCount(0), m_windowStart(0), m_isWindowOpen(false) {}
+
+  // A line emitted at deviceUs was read at hostUs
+  void addSample(uint64_t deviceUs, int64_t hostUs)
+  {
+    int64_t offset = hostUs - (int64_t)deviceUs;
+    if (!this->m_isWindowOpen || hostUs - this->m_windowStart >= c_windowUs)
+    {
+      this->openWindow(hostUs);
+      this->m_current.deviceUs = deviceUs;
+      this->m_current.offset = offset;
+    }
+    else if (offset < this->m_current.offset)
+    {
+      this->m_current.deviceUs = deviceUs;
+      this->m_current.offset = offset;
+    }
+  }
+
+  bool isValid() { return this->m_isWindowOpen; }
+
+  // Host time of a device time, using the closed windows and the current one
+  int64_t toHost(uint64_t deviceUs)
+  {
+    unsigned count = 0;
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    double x0 = (double)this->m_current.deviceUs;
+    for (unsigned i = 0; i <= this->m_windowCount; i++)
+    {
+      const Point &point = i == this->m_windowCount ? this->m_current : this->m_windows[i];
+      // Relative to the current point, to keep the precision of the doubles
+      double x = (double)point.deviceUs - x0;
+      double y = (double)(point.offset - this->m_current.offset);
+      sumX += x;
+      sumY += y;
+      sumXX += x * x;
+      sumXY += x * y;
+      count++;
+    }
+
+    double slope = 0;
+    double denominator = count * sumXX - sumX * sumX;
+    if (count >= 2 && denominator > 0)
+      slope = (count * sumXY - sumX * sumY) / denominator;
+    double intercept = (sumY - slope * sumX) / count;
+
+    double x = (double)deviceUs - x0;
+    return (int64_t)deviceUs + this->m_current.offset + (int64_t)(intercept + slope * x);
+  }
+
+private:
+  struct Point
+  {
+    uint64_t deviceUs;
+    int64_t offset;
+  };
+
+  void openWindow(int64_t hostUs)
+  {
+    if (this->m_isWindowOpen)
+    {
+      // Keep the last c_maxWindows minimums, oldest first
+      if (this->m_windowCount == c_maxWindows)
+      {
+        for (unsigned i = 1; i < c_maxWindows; i++)
+          this->m_windows[i - 1] = this->m_windows[i];
+        this->m_windowCount--;
+      }
+      this->m_windows[this->m_windowCount++] = this->m_current;
+    }
+    this->m_windowStart = hostUs;
+    this->m_isWindowOpen = true;
+  }
+
+  Point m_windows[c_maxWindows];
+  unsigned m_windowCount;
+  Point m_current;
+  int64_t m_windowStart;
+  bool m_isWindowOpen;
+};
+
+#endif //_CLOCKSYNC_H
@@ -0,0 +1,142 @@
+#ifndef _CORPUS_H
+#define _CORPUS_H
+
+/*---------------------------------------------------------------------------
+ * Capture corpus of the InOne host tools
+ * A capture file holds consecutive c_rfRxPacketSize-byte windows, as read from the radio FIFO after the sync word.
+ * It is memory-mapped read-only. A corpus can also be generated: frames encoded by the firmware code
+ * (Packet::toRaw, LegrandProtocol::Encode, encodeFrame), with random bit flips
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "InOneCodec.h"
+
+class Corpus
+{
+public:
+  static const size_t c_windowSize = InOne::c_rfRxPacketSize;
+
+  Corpus() : m_data(NULL), m_size(0), m_mapped(NULL) {}
+  ~Corpus()
+  {
+    if (this->m_mapped != NULL)
+      munmap(this->m_mapped, this->m_size);
+  }
+
+  bool map(const char *path)
+  {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      perror(path);
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)c_windowSize)
+    {
+      fprintf(stderr, "%s: no complete window\n", path);
+      close(fd);
+      return false;
+    }
+    // A trailing partial window is ignored
+    this->m_size = st.st_size - st.st_size % c_windowSize;
+    this->m_mapped = mmap(NULL, this->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (this->m_mapped == MAP_FAILED)
+    {
+      this->m_mapped = NULL;
+      perror(path);
+      return false;
+    }
+    madvise(this->m_mapped, this->m_size, MADV_SEQUENTIAL);
+    this->m_data = (const uint8_t *)this->m_mapped;
+    return true;
+  }
+
+  // count frames of random switches, each bit flipped with the given probability
+  void generate(size_t count, double bitErrorRate, unsigned seed)
+  {
+    std::mt19937 random(seed);
+    this->m_generated.resize(count * c_windowSize);
+    for (size_t i = 0; i < count; i++)
+    {
+      uint8_t *window = &this->m_generated[i * c_windowSize];
+      randomWindow(random, window);
+      flipBits(random, window, c_windowSize, bitErrorRate);
+    }
+    this->m_data = this->m_generated.data();
+    this->m_size = this->m_generated.size();
+  }
+
+  // Append a window to a generated corpus, returns its index
+  size_t add(const uint8_t *window)
+  {
+    this->m_generated.insert(this->m_generated.end(), window, window + c_windowSize);
+    this->m_data = this->m_generated.data();
+    this->m_size = this->m_generated.size();
+    return this->count() - 1;
+  }
+
+  size_t count() const { return this->m_size / c_windowSize; }
+  const uint8_t *window(size_t index) const { return this->m_data + index * c_windowSize; }
+
+  static InOne::Packet randomPacket(std::mt19937 &random)
+  {
+    InOne::Packet packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.sequenceIndex = random() & 0xF;
+    packet.id = random() & InOne::c_maxId;
+    packet.type = (InOne::PacketType)(random() % 3);
+    static const InOne::Command commands[] = {InOne::Command::On, InOne::Command::Off, InOne::Command::DimStart, InOne::Command::DimStop};
+    packet.command = commands[random() % 4];
+    packet.channel = (InOne::Channel)(1 + random() % 2);
+    for (unsigned i = 0; i < sizeof(packet.data); i++)
+      packet.data[i] = random();
+    return packet;
+  }
+
+  // The received window of a packet: its radio frame, repeated as the radio transmits it
+  static void encodeWindow(InOne::Packet *packet, uint8_t *window)
+  {
+    uint8_t rawData[InOne::c_maxRawPacketSize];
+    uint8_t framedData[12];
+    uint8_t frame[InOne::c_rfTxFrameSize];
+    uint8_t length = packet->toRaw(rawData);
+    LegrandProtocol::Encode(rawData, framedData, length);
+    uint8_t frameSize = InOne::encodeFrame(framedData, length, frame) / 2;
+    for (size_t i = 0; i < c_windowSize; i++)
+      window[i] = frame[i % frameSize];
+  }
+
+  static void randomWindow(std::mt19937 &random, uint8_t *window)
+  {
+    InOne::Packet packet = randomPacket(random);
+    encodeWindow(&packet, window);
+  }
+
+  static void flipBits(std::mt19937 &random, uint8_t *buffer, size_t size, double bitErrorRate)
+  {
+    if (bitErrorRate <= 0)
+      return;
+    // Distance between flipped bits
+    std::geometric_distribution<size_t> gap(bitErrorRate);
+    for (size_t bit = gap(random); bit < size * 8; bit += 1 + gap(random))
+      buffer[bit / 8] ^= 0x80 >> (bit % 8);
+  }
+
+private:
+  const uint8_t *m_data;
+  size_t m_size;
+  void *m_mapped;
+  std::vector<uint8_t> m_generated;
+};
+
+#endif //_CORPUS_H
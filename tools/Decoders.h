@@ -0,0 +1,118 @@
+#ifndef _DECODERS_H
+#define _DECODERS_H
+
+/*---------------------------------------------------------------------------
+ * Alternative InOne frame decoders of the host tools, built on InOne::decodeFrame
+ * The firmware only decodes the first copy of the frame, at its nominal bit position. The alternatives also try
+ * bit offsets around it, and the second copy of the frame sent after the second sync word
+ */
+#include <cstdint>
+#include <cstring>
+#include "Corpus.h"
+#include "InOneCodec.h"
+
+// dst bit i = src bit i + offset (MSB first), 0 outside of the window
+static inline void shiftBits(const uint8_t *src, uint8_t *dst, int offset)
+{
+  for (int i = 0; i < (int)Corpus::c_windowSize; i++)
+  {
+    int bit = i * 8 + offset + 64;
+    int index = bit / 8 - 8;
+    int shift = bit % 8;
+    unsigned high = index >= 0 && index < (int)Corpus::c_windowSize ? src[index] : 0;
+    unsigned low = index + 1 >= 0 && index + 1 < (int)Corpus::c_windowSize ? src[index + 1] : 0;
+    dst[i] = (high << shift) | (low >> (8 - shift));
+  }
+}
+
+enum class Copies : uint8_t
+{
+  None,
+  Second,
+  Merge
+};
+static const char *const copiesNames[] = {"none", "second", "merge"};
+
+// Replace the invalid pairs of a in [first, first + count) by the valid pairs of b
+static inline void mergePairs(const uint8_t *a, const uint8_t *b, uint8_t *merged, unsigned first, unsigned count)
+{
+  memcpy(merged, a, Corpus::c_windowSize);
+  for (unsigned pair = first; pair < first + count; pair++)
+  {
+    unsigned shift = 6 - 2 * (pair % 4);
+    uint8_t pairA = (a[pair / 4] >> shift) & 3;
+    uint8_t pairB = (b[pair / 4] >> shift) & 3;
+    if ((pairA == 0 || pairA == 3) && (pairB == 1 || pairB == 2))
+      merged[pair / 4] = (merged[pair / 4] & ~(3 << shift)) | (pairB << shift);
+  }
+}
+
+static inline bool decodeCopies(const uint8_t *window, Copies copies, uint8_t *rawData, uint8_t *length)
+{
+  uint8_t detail;
+  if (InOne::decodeFrame(window, rawData, length, &detail) == InOne::DecodeStatus::Ok)
+    return true;
+  if (copies == Copies::None)
+    return false;
+
+  // The position of the second copy depends on the packet length: try each length
+  static const uint8_t lengths[] = {6, 7, 9};
+  for (uint8_t copyLength : lengths)
+  {
+    // Nibbles before the second copy, as in encodeFrame(), minus the sync nibble before the first copy
+    uint8_t second[Corpus::c_windowSize];
+    shiftBits(window, second, 4 * ((copyLength * 10 + 1) / 2 + 6) - 4);
+    const uint8_t *candidate = second;
+    uint8_t merged[Corpus::c_windowSize];
+    if (copies == Copies::Merge)
+    {
+      mergePairs(window, second, merged, 2, copyLength * 10);
+      candidate = merged;
+    }
+    if (InOne::decodeFrame(candidate, rawData, length, &detail) == InOne::DecodeStatus::Ok && *length == copyLength)
+      return true;
+  }
+  return false;
+}
+
+// Frame decoding at the nominal position, then at the bit offsets up to offsetTolerance
+static inline bool decodeWindow(const uint8_t *window, uint8_t offsetTolerance, Copies copies, uint8_t *rawData, uint8_t *length)
+{
+  uint8_t shifted[Corpus::c_windowSize];
+  for (int step = 0; step <= 2 * offsetTolerance; step++)
+  {
+    // 0, +1, -1, +2, -2...
+    int offset = (step + 1) / 2 * (step & 1 ? 1 : -1);
+    const uint8_t *frame = window;
+    if (offset != 0)
+    {
+      shiftBits(window, shifted, offset);
+      frame = shifted;
+    }
+    if (decodeCopies(frame, copies, rawData, length))
+      return true;
+  }
+  return false;
+}
+
+// Checksum only: Manchester and framing errors are ignored, the invalid pairs decode to 0
+static inline bool decodeLenient(const uint8_t *window, uint8_t *rawData, uint8_t *length)
+{
+  uint8_t manDecBuffer[12];
+  uint8_t errorCount;
+  Manchester::Decode(window, manDecBuffer, 60, 2, &errorCount);
+  LegrandProtocol::Decode(manDecBuffer, rawData, 6, &errorCount);
+  static const uint8_t extraByteCounts[] = {0, 1, 3, 0};
+  uint8_t code = rawData[4] >> 6;
+  if (code == 3)
+    return false;
+  *length = 6 + extraByteCounts[code];
+  if (*length > 6)
+  {
+    Manchester::Decode(window, manDecBuffer, 10 * extraByteCounts[code], 62, &errorCount);
+    LegrandProtocol::Decode(manDecBuffer, &rawData[6], extraByteCounts[code], &errorCount);
+  }
+  return InOne::Packet::checksum(rawData, *length - 1) == rawData[*length - 1];
+}
+
+#endif //_DECODERS_H
@@ -0,0 +1,217 @@
+/*---------------------------------------------------------------------------
+ * Host benchmark of the bit stream cursors
+ * Runs the Manchester and Legrand codecs of the firmware (InOneCodec.cpp), which use BitStream, and the indexed
+ * bit functions they replaced (each access computing its byte index, bit shift and bit order), checks that both
+ * produce the same output, and prints the cost per bit of each. The transmitted frames of encodeFrame() are also
+ * checked against the sync word insertion with one setNibble() call per nibble that it replaced
+ *
+ * Build: g++ -O2 -I../firmware -o bitbench bitbench.cpp ../firmware/InOneCodec.cpp ../firmware/InOne.cpp
+ * Usage: bitbench [iterations]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "InOneCodec.h"
+
+//--------------------------- Indexed bit functions ---------------------------
+namespace Indexed
+{
+  // msb_first: bit 0 is 0x80 of the first byte
+  static void def_bit(uint8_t *buffer, uint16_t bit_index, uint8_t value, uint8_t msb_first)
+  {
+    uint8_t byte_index = bit_index / 8;
+    uint8_t shift = msb_first ? 7 - bit_index % 8 : bit_index % 8;
+    buffer[byte_index] &= ~(1 << shift);
+    buffer[byte_index] |= (value & 1) << shift;
+  }
+
+  static uint8_t get_bit(const uint8_t *buffer, uint16_t bit_index, uint8_t msb_first)
+  {
+    uint8_t byte_index = bit_index / 8;
+    uint8_t shift = msb_first ? 7 - bit_index % 8 : bit_index % 8;
+    return (buffer[byte_index] >> shift) & 1;
+  }
+
+  static void manchesterDecode(const uint8_t *in, uint8_t *out, uint16_t length, uint16_t in_offset, uint8_t *n_errors)
+  {
+    uint8_t errors = 0;
+    for (uint16_t b = 0; b < length; b++)
+    {
+      uint16_t in_ptr = (b + in_offset) * 2;
+      uint8_t in_data = get_bit(in, in_ptr, true) << 1 | get_bit(in, in_ptr + 1, true);
+      if (in_data != 0b01 && in_data != 0b10)
+        errors++;
+      def_bit(out, b, in_data == 0b10, false);
+    }
+    *n_errors = errors;
+  }
+
+  static void manchesterEncode(const uint8_t *in, uint8_t *out, uint16_t length, uint16_t out_offset)
+  {
+    uint16_t out_ptr = out_offset;
+    for (uint16_t i = 0; i < length; i++)
+    {
+      uint8_t bit = get_bit(in, i, false);
+      def_bit(out, out_ptr++, bit, true);
+      def_bit(out, out_ptr++, bit ^ 1, true);
+    }
+  }
+
+  static void legrandDecode(const uint8_t *in, uint8_t *out, uint8_t length, uint8_t *n_errors)
+  {
+    uint8_t errors = 0;
+    for (uint8_t n = 0; n < length * 2; n++)
+    {
+      if (get_bit(in, n * 5, false) != 1)
+        errors++;
+      for (uint8_t i = 1; i < 5; i++)
+        def_bit(out, n * 4 + i - 1, get_bit(in, n * 5 + i, false), false);
+    }
+    *n_errors = errors;
+  }
+
+  static void legrandEncode(const uint8_t *in, uint8_t *out, uint8_t length)
+  {
+    uint8_t out_ptr = 0;
+    for (uint8_t i = 0; i < length * 8; i++)
+    {
+      if (i % 4 == 0)
+        def_bit(out, out_ptr++, 1, false);
+      def_bit(out, out_ptr++, get_bit(in, i, false), false);
+    }
+    def_bit(out, out_ptr++, 1, false);
+  }
+
+  // lsn_first: nibble 0 is the high nibble of the first byte
+  static void setNibble(uint8_t *buffer, uint16_t nib_index, uint8_t value, uint8_t lsn_first)
+  {
+    uint8_t byte_index = nib_index / 2;
+    uint8_t bit_in_byte = (4 * (nib_index % 2));
+    value &= 0xF;
+    if (lsn_first)
+    {
+      buffer[byte_index] &= ~(0xF << (4 - bit_in_byte));
+      buffer[byte_index] |= value << (4 - bit_in_byte);
+    }
+    else
+    {
+      buffer[byte_index] &= ~(0xF << bit_in_byte);
+      buffer[byte_index] |= value << bit_in_byte;
+    }
+  }
+
+  // The frame construction of sendPacket() before InOne::encodeFrame()
+  static uint8_t encodeFrame(const uint8_t *framedData, uint8_t length, uint8_t *frame)
+  {
+    memset(frame, 0, InOne::c_rfTxFrameSize);
+    frame[0] = 0xF0;
+    manchesterEncode(framedData, frame, length * 10 + 1, 4);
+    uint8_t nibbleCount = (length * 10 + 1) / 2 + 1;
+    setNibble(frame, nibbleCount + 0, 0x8, true);
+    setNibble(frame, nibbleCount + 1, 0x3, true);
+    setNibble(frame, nibbleCount + 2, 0xE, true);
+    setNibble(frame, nibbleCount + 3, 0x0, true);
+    setNibble(frame, nibbleCount + 4, 0xF, true);
+    nibbleCount += 5;
+    manchesterEncode(framedData, frame, length * 10 + 1, nibbleCount * 4);
+    nibbleCount += (length * 10 + 1) / 2;
+    return nibbleCount;
+  }
+} // namespace Indexed
+
+//--------------------------------- Benchmark ---------------------------------
+static unsigned errorCount = 0;
+
+static void check(const char *name, const uint8_t *a, const uint8_t *b, size_t size)
+{
+  if (memcmp(a, b, size) != 0)
+  {
+    printf("MISMATCH in %s\n", name);
+    errorCount++;
+  }
+}
+
+template <class F>
+static double nsPerBit(F f, unsigned iterations, unsigned bitsPerCall)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; i++)
+    f();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations / bitsPerCall;
+}
+
+// Keeps the optimizer from removing the benchmarked calls
+static volatile uint8_t sink;
+
+int main(int argc, char **argv)
+{
+  unsigned iterations = argc > 1 ? atoi(argv[1]) : 200000;
+  srand(1);
+
+  // Random frames: check both implementations on every offset and length used by the InOne manager
+  for (unsigned round = 0; round < 1000; round++)
+  {
+    uint8_t in[64], a[64], b[64];
+    for (unsigned i = 0; i < sizeof(in); i++)
+      in[i] = rand();
+    uint8_t length = 6 + rand() % 4;
+    uint16_t offset = rand() % 70;
+    uint8_t errorsA, errorsB;
+
+    memset(a, 0x5A, sizeof(a));
+    memset(b, 0x5A, sizeof(b));
+    Indexed::manchesterDecode(in, a, length * 10, offset, &errorsA);
+    Manchester::Decode(in, b, length * 10, offset, &errorsB);
+    check("Manchester decode", a, b, sizeof(a));
+    check("Manchester decode errors", &errorsA, &errorsB, 1);
+
+    memset(a, 0xA5, sizeof(a));
+    memset(b, 0xA5, sizeof(b));
+    Indexed::manchesterEncode(in, a, length * 10 + 1, offset);
+    Manchester::Encode(in, b, length * 10 + 1, offset);
+    check("Manchester encode", a, b, sizeof(a));
+
+    memset(a, 0x5A, sizeof(a));
+    memset(b, 0x5A, sizeof(b));
+    Indexed::legrandDecode(in, a, length, &errorsA);
+    LegrandProtocol::Decode(in, b, length, &errorsB);
+    check("Legrand decode", a, b, sizeof(a));
+    check("Legrand decode errors", &errorsA, &errorsB, 1);
+
+    memset(a, 0xA5, sizeof(a));
+    memset(b, 0xA5, sizeof(b));
+    Indexed::legrandEncode(in, a, length);
+    LegrandProtocol::Encode(in, b, length);
+    check("Legrand encode", a, b, sizeof(a));
+
+    // The second sync word lands on a nibble boundary which depends on the packet length
+    uint8_t countA = Indexed::encodeFrame(in, length, a);
+    uint8_t countB = InOne::encodeFrame(in, length, b);
+    check("Frame encode", a, b, InOne::c_rfTxFrameSize);
+    check("Frame encode nibble count", &countA, &countB, 1);
+  }
+  if (errorCount != 0)
+    return 1;
+
+  // The largest InOne frame: 9 bytes, 90 framed bits, 180 Manchester bits
+  uint8_t in[64], out[64], errors;
+  for (unsigned i = 0; i < sizeof(in); i++)
+    in[i] = rand();
+
+  printf("%-20s %10s %10s (ns/bit)\n", "", "indexed", "firmware");
+  printf("%-20s %10.2f %10.2f\n", "Manchester decode",
+         nsPerBit([&] { Indexed::manchesterDecode(in, out, 90, 0, &errors); sink = out[0]; }, iterations, 90),
+         nsPerBit([&] { Manchester::Decode(in, out, 90, 0, &errors); sink = out[0]; }, iterations, 90));
+  printf("%-20s %10.2f %10.2f\n", "Manchester encode",
+         nsPerBit([&] { Indexed::manchesterEncode(in, out, 91, 4); sink = out[0]; }, iterations, 91),
+         nsPerBit([&] { Manchester::Encode(in, out, 91, 4); sink = out[0]; }, iterations, 91));
+  printf("%-20s %10.2f %10.2f\n", "Legrand decode",
+         nsPerBit([&] { Indexed::legrandDecode(in, out, 9, &errors); sink = out[0]; }, iterations, 90),
+         nsPerBit([&] { LegrandProtocol::Decode(in, out, 9, &errors); sink = out[0]; }, iterations, 90));
+  printf("%-20s %10.2f %10.2f\n", "Legrand encode",
+         nsPerBit([&] { Indexed::legrandEncode(in, out, 9); sink = out[0]; }, iterations, 72),
+         nsPerBit([&] { LegrandProtocol::Encode(in, out, 9); sink = out[0]; }, iterations, 72));
+  return 0;
+}
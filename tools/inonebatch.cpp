@@ -0,0 +1,369 @@
+/*---------------------------------------------------------------------------
+ * Batch decoder of InOne capture corpora
+ * Decodes the windows of a capture file (see Corpus.h) in batches: a SIMD kernel validates the Manchester pairs and
+ * extracts the data bits of the whole batch, then each frame is deframed from 64-bit words and checked with a
+ * table-driven CRC. The results are checked against the firmware decoder (InOne::decodeFrame) frame by frame,
+ * and the decode rate of each implementation is printed.
+ *
+ * Build: g++ -O2 -I../firmware -o inonebatch inonebatch.cpp ../firmware/InOneCodec.cpp ../firmware/InOne.cpp
+ * Usage: inonebatch [-d] <capture file>
+ *        inonebatch [-d] -g <frame count> [bit error rate]    (generated corpus, default rate 0.0005)
+ *        -d prints the decoded packets as "<window index>,<raw bytes>"
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Corpus.h"
+#include "InOneCodec.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+using InOne::DecodeStatus;
+
+static const char *const statusNames[] = {"ok", "manchester errors", "framing errors", "extra byte count",
+                                          "extra manchester errors", "extra framing errors", "checksum fail"};
+static const unsigned statusCount = sizeof(statusNames) / sizeof(statusNames[0]);
+
+// Frames per batch: the bit streams of a batch stay in the L1 cache
+static const size_t batchSize = 256;
+// Bytes of each bit stream per window: one bit per Manchester pair
+static const size_t streamSize = Corpus::c_windowSize / 2;
+
+struct Result
+{
+  DecodeStatus status;
+  uint8_t length;
+  uint8_t detail;
+  uint8_t rawData[InOne::c_maxRawPacketSize];
+};
+
+static bool isSameResult(const Result *a, const Result *b)
+{
+  if (a->status != b->status || a->detail != b->detail)
+    return false;
+  // The packet bytes are only complete once the framing is checked
+  if (a->status == DecodeStatus::Ok || a->status == DecodeStatus::ChecksumFail)
+    return a->length == b->length && memcmp(a->rawData, b->rawData, a->length) == 0;
+  return true;
+}
+
+//------------------------------ Manchester pairs ------------------------------
+/* Each window byte holds 4 Manchester pairs, first pair in the 2 most significant bits. A pair is valid when its
+ * bits differ, and decodes to its first bit (an invalid pair decodes to 0, as in Manchester::Decode).
+ * The kernels output two bit streams in the LSB first order of the decoded data: the decoded bits and the valid flags.
+ * Two window bytes give one byte of each stream */
+typedef void (*PairKernel)(const uint8_t *windows, size_t size, uint8_t *values, uint8_t *valid);
+
+static uint8_t valueNibbles[256];
+static uint8_t validNibbles[256];
+
+static void initPairTables()
+{
+  for (unsigned x = 0; x < 256; x++)
+  {
+    valueNibbles[x] = 0;
+    validNibbles[x] = 0;
+    for (unsigned pair = 0; pair < 4; pair++)
+    {
+      unsigned first = (x >> (7 - 2 * pair)) & 1;
+      unsigned second = (x >> (6 - 2 * pair)) & 1;
+      valueNibbles[x] |= (first & !second) << pair;
+      validNibbles[x] |= (first ^ second) << pair;
+    }
+  }
+}
+
+static void scalarPairs(const uint8_t *windows, size_t size, uint8_t *values, uint8_t *valid)
+{
+  for (size_t i = 0; i < size; i += 2)
+  {
+    values[i / 2] = valueNibbles[windows[i]] | valueNibbles[windows[i + 1]] << 4;
+    valid[i / 2] = validNibbles[windows[i]] | validNibbles[windows[i + 1]] << 4;
+  }
+}
+
+#ifdef HAVE_X86_KERNELS
+/* The pair flags of a byte are at bits 6, 4, 2, 0 (first pair at bit 6): they are moved to bits 0 to 3.
+ * 16-bit shifts move bits across bytes, the masks keep only the bits of each byte */
+__attribute__((target("sse2"))) static inline __m128i nibblesSse2(__m128i v)
+{
+  return _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 6), _mm_set1_epi8(1)),
+                                   _mm_and_si128(_mm_srli_epi16(v, 3), _mm_set1_epi8(2))),
+                      _mm_or_si128(_mm_and_si128(v, _mm_set1_epi8(4)),
+                                   _mm_and_si128(_mm_slli_epi16(v, 3), _mm_set1_epi8(8))));
+}
+
+// Two nibbles per byte, then 16 bytes from the 32 nibbles of a and b
+__attribute__((target("sse2"))) static inline __m128i packSse2(__m128i a, __m128i b)
+{
+  a = _mm_or_si128(_mm_and_si128(a, _mm_set1_epi16(0x000F)), _mm_and_si128(_mm_srli_epi16(a, 4), _mm_set1_epi16(0x00F0)));
+  b = _mm_or_si128(_mm_and_si128(b, _mm_set1_epi16(0x000F)), _mm_and_si128(_mm_srli_epi16(b, 4), _mm_set1_epi16(0x00F0)));
+  return _mm_packus_epi16(a, b);
+}
+
+__attribute__((target("sse2"))) static void sse2Pairs(const uint8_t *windows, size_t size, uint8_t *values, uint8_t *valid)
+{
+  const __m128i mask = _mm_set1_epi8(0x55);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32)
+  {
+    __m128i nibbleValues[2], nibbleValid[2];
+    for (unsigned half = 0; half < 2; half++)
+    {
+      __m128i x = _mm_loadu_si128((const __m128i *)(windows + i + 16 * half));
+      __m128i first = _mm_and_si128(_mm_srli_epi16(x, 1), mask);
+      __m128i second = _mm_and_si128(x, mask);
+      nibbleValues[half] = nibblesSse2(_mm_andnot_si128(second, first));
+      nibbleValid[half] = nibblesSse2(_mm_xor_si128(first, second));
+    }
+    _mm_storeu_si128((__m128i *)(values + i / 2), packSse2(nibbleValues[0], nibbleValues[1]));
+    _mm_storeu_si128((__m128i *)(valid + i / 2), packSse2(nibbleValid[0], nibbleValid[1]));
+  }
+  scalarPairs(windows + i, size - i, values + i / 2, valid + i / 2);
+}
+
+__attribute__((target("avx2"))) static inline __m256i nibblesAvx2(__m256i v)
+{
+  return _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(v, 6), _mm256_set1_epi8(1)),
+                                         _mm256_and_si256(_mm256_srli_epi16(v, 3), _mm256_set1_epi8(2))),
+                         _mm256_or_si256(_mm256_and_si256(v, _mm256_set1_epi8(4)),
+                                         _mm256_and_si256(_mm256_slli_epi16(v, 3), _mm256_set1_epi8(8))));
+}
+
+__attribute__((target("avx2"))) static inline __m256i packAvx2(__m256i a, __m256i b)
+{
+  a = _mm256_maddubs_epi16(a, _mm256_set1_epi16(0x1001));
+  b = _mm256_maddubs_epi16(b, _mm256_set1_epi16(0x1001));
+  // packus works on each 128-bit lane: restore the order of the 64-bit quarters
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+__attribute__((target("avx2"))) static void avx2Pairs(const uint8_t *windows, size_t size, uint8_t *values, uint8_t *valid)
+{
+  const __m256i mask = _mm256_set1_epi8(0x55);
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64)
+  {
+    __m256i nibbleValues[2], nibbleValid[2];
+    for (unsigned half = 0; half < 2; half++)
+    {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(windows + i + 32 * half));
+      __m256i first = _mm256_and_si256(_mm256_srli_epi16(x, 1), mask);
+      __m256i second = _mm256_and_si256(x, mask);
+      nibbleValues[half] = nibblesAvx2(_mm256_andnot_si256(second, first));
+      nibbleValid[half] = nibblesAvx2(_mm256_xor_si256(first, second));
+    }
+    _mm256_storeu_si256((__m256i *)(values + i / 2), packAvx2(nibbleValues[0], nibbleValues[1]));
+    _mm256_storeu_si256((__m256i *)(valid + i / 2), packAvx2(nibbleValid[0], nibbleValid[1]));
+  }
+  sse2Pairs(windows + i, size - i, values + i / 2, valid + i / 2);
+}
+#endif // HAVE_X86_KERNELS
+
+//--------------------------------- Framing ---------------------------------
+static uint8_t crcTable[256];
+
+// Dallas/Maxim CRC-8 of Packet::checksum(), one table lookup per byte
+static void initCrcTable()
+{
+  for (unsigned i = 0; i < 256; i++)
+  {
+    uint8_t byte = i;
+    crcTable[i] = InOne::Packet::checksum(&byte, 1);
+  }
+}
+
+static uint8_t tableChecksum(const uint8_t *data, uint8_t length)
+{
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < length; i++)
+    crc = crcTable[crc ^ data[i]];
+  return crc;
+}
+
+// count bits of a stream from bit position, count + position % 8 <= 64 (little-endian host)
+static inline uint64_t streamBits(const uint8_t *stream, unsigned position, unsigned count)
+{
+  uint64_t word;
+  memcpy(&word, stream + position / 8, sizeof(word));
+  return (word >> (position % 8)) & ((1ULL << count) - 1);
+}
+
+// Nibbles framed by a '1' bit, as LegrandProtocol::Decode(): returns the framing error count
+static unsigned deframe(uint64_t bits, unsigned nibbleCount, uint8_t *data)
+{
+  unsigned errorCount = 0;
+  for (unsigned i = 0; i < nibbleCount; i++, bits >>= 5)
+  {
+    errorCount += !(bits & 1);
+    if (i & 1)
+      data[i / 2] |= ((bits >> 1) & 0xF) << 4;
+    else
+      data[i / 2] = (bits >> 1) & 0xF;
+  }
+  return errorCount;
+}
+
+// Same steps and results as InOne::decodeFrame(), on the bit streams of a window
+static void decodeStreams(const uint8_t *values, const uint8_t *valid, Result *result)
+{
+  result->length = 6;
+  result->detail = 60 - __builtin_popcountll(streamBits(valid, 2, 60));
+  if (result->detail != 0)
+  {
+    result->status = DecodeStatus::ManchesterErrors;
+    return;
+  }
+  result->detail = deframe(streamBits(values, 2, 60), 12, result->rawData);
+  if (result->detail != 0)
+  {
+    result->status = DecodeStatus::FramingErrors;
+    return;
+  }
+
+  static const uint8_t extraByteCounts[] = {0, 1, 3, 0};
+  uint8_t code = result->rawData[4] >> 6;
+  if (code == 3)
+  {
+    result->detail = code;
+    result->status = DecodeStatus::ExtraByteCount;
+    return;
+  }
+  unsigned extraByteCount = extraByteCounts[code];
+  if (extraByteCount != 0)
+  {
+    unsigned bitCount = 10 * extraByteCount;
+    result->detail = bitCount - __builtin_popcountll(streamBits(valid, 62, bitCount));
+    if (result->detail != 0)
+    {
+      result->status = DecodeStatus::ExtraManchesterErrors;
+      return;
+    }
+    result->detail = deframe(streamBits(values, 62, bitCount), 2 * extraByteCount, &result->rawData[6]);
+    if (result->detail != 0)
+    {
+      result->status = DecodeStatus::ExtraFramingErrors;
+      return;
+    }
+    result->length += extraByteCount;
+  }
+
+  result->detail = tableChecksum(result->rawData, result->length - 1);
+  result->status = result->detail == result->rawData[result->length - 1] ? DecodeStatus::Ok : DecodeStatus::ChecksumFail;
+}
+
+static void decodeBatches(const Corpus &corpus, PairKernel kernel, Result *results)
+{
+  static uint8_t values[batchSize * streamSize + 8];
+  static uint8_t valid[batchSize * streamSize + 8];
+  for (size_t first = 0; first < corpus.count(); first += batchSize)
+  {
+    size_t count = corpus.count() - first < batchSize ? corpus.count() - first : batchSize;
+    kernel(corpus.window(first), count * Corpus::c_windowSize, values, valid);
+    for (size_t i = 0; i < count; i++)
+      decodeStreams(&values[i * streamSize], &valid[i * streamSize], &results[first + i]);
+  }
+}
+
+static void decodeFirmware(const Corpus &corpus, Result *results)
+{
+  for (size_t i = 0; i < corpus.count(); i++)
+  {
+    Result *result = &results[i];
+    result->status = InOne::decodeFrame(corpus.window(i), result->rawData, &result->length, &result->detail);
+  }
+}
+
+//---------------------------------- Main ----------------------------------
+template <class F>
+static double seconds(F f)
+{
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+  bool isDumping = argc > 1 && strcmp(argv[1], "-d") == 0;
+  int arg = isDumping ? 2 : 1;
+
+  Corpus corpus;
+  if (arg + 1 < argc && strcmp(argv[arg], "-g") == 0)
+    corpus.generate(strtoul(argv[arg + 1], NULL, 0), arg + 2 < argc ? atof(argv[arg + 2]) : 0.0005, 1);
+  else if (arg < argc)
+  {
+    if (!corpus.map(argv[arg]))
+      return 1;
+  }
+  else
+  {
+    fprintf(stderr, "Usage: %s [-d] <capture file> | [-d] -g <frame count> [bit error rate]\n", argv[0]);
+    return 1;
+  }
+
+  initPairTables();
+  initCrcTable();
+
+  std::vector<Result> reference(corpus.count());
+  std::vector<Result> results(corpus.count());
+  size_t frameCount = corpus.count();
+  double referenceTime = seconds([&] { decodeFirmware(corpus, reference.data()); });
+  printf("%zu frames\n", frameCount);
+  printf("%-10s %14s %10s\n", "decoder", "frames/s", "mismatches");
+  printf("%-10s %14.0f %10s\n", "firmware", frameCount / referenceTime, "-");
+
+  struct
+  {
+    const char *name;
+    PairKernel kernel;
+    bool isSupported;
+  } kernels[] = {
+      {"scalar", scalarPairs, true},
+#ifdef HAVE_X86_KERNELS
+      {"sse2", sse2Pairs, (bool)__builtin_cpu_supports("sse2")},
+      {"avx2", avx2Pairs, (bool)__builtin_cpu_supports("avx2")},
+#endif
+  };
+  unsigned totalMismatches = 0;
+  for (auto &kernel : kernels)
+  {
+    if (!kernel.isSupported)
+    {
+      printf("%-10s %14s\n", kernel.name, "unsupported");
+      continue;
+    }
+    double time = seconds([&] { decodeBatches(corpus, kernel.kernel, results.data()); });
+    unsigned mismatches = 0;
+    for (size_t i = 0; i < frameCount; i++)
+      mismatches += !isSameResult(&reference[i], &results[i]);
+    totalMismatches += mismatches;
+    printf("%-10s %14.0f %10u\n", kernel.name, frameCount / time, mismatches);
+  }
+
+  size_t statusCounts[statusCount] = {0};
+  for (size_t i = 0; i < frameCount; i++)
+    statusCounts[(unsigned)reference[i].status]++;
+  for (unsigned status = 0; status < statusCount; status++)
+    printf("%-24s %10zu\n", statusNames[status], statusCounts[status]);
+
+  if (isDumping)
+  {
+    for (size_t i = 0; i < frameCount; i++)
+    {
+      if (reference[i].status != DecodeStatus::Ok)
+        continue;
+      printf("%zu,", i);
+      for (uint8_t j = 0; j < reference[i].length; j++)
+        printf("%02X", reference[i].rawData[j]);
+      printf("\n");
+    }
+  }
+  return totalMismatches != 0;
+}
@@ -0,0 +1,292 @@
+/*---------------------------------------------------------------------------
+ * Robustness benchmark of the InOne frame decoders
+ * Valid frames are generated by the firmware code (Packet::toRaw, LegrandProtocol::Encode, Manchester::Encode
+ * through encodeFrame), then impaired at sweeping rates:
+ *   flip      each bit inverted with the given probability
+ *   slip      a bit dropped or repeated (receiver clock slip) with the given probability per bit
+ *   truncate  probability that the frame stops at a random bit, the rest of the window being noise
+ *   noise     random windows only (false accepts of a sync word detected on noise)
+ * For each decoder (firmware decodeFrame and the alternatives of Decoders.h), the curve gives the rate of frames
+ * decoded to the sent packet (success) and to another packet (false accept), in percent.
+ * The frames are seeded per point, so that a run gives the same curve for the same code and frame count.
+ *   -n  frames per point (20000)
+ *   -o  save the curve as CSV
+ *   -c  check the curve against a saved one: a lower success or a higher false accept rate than the saved one
+ *       (beyond c_tolerance) is a regression. The exit code is 1 on a regression, or when the saved curve has no
+ *       point of this run (other impairment rates or decoders)
+ * The baseline of the current decoders is inonerobust_curve.csv, saved with the default frame count.
+ *
+ * Build: g++ -O2 -I../firmware -o inonerobust inonerobust.cpp ../firmware/InOneCodec.cpp ../firmware/InOne.cpp
+ * Usage: inonerobust [-n frames per point] [-o curve.csv] [-c curve.csv]
+ *        inonerobust -c inonerobust_curve.csv
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "Corpus.h"
+#include "Decoders.h"
+#include "InOneCodec.h"
+
+using namespace InOne;
+
+// Allowed change of a rate before it is reported as a regression (percentage points)
+static const double c_tolerance = 0.1;
+
+//-------------------------------- Decoders ---------------------------------
+struct Decoder
+{
+  const char *name;
+  bool (*decode)(const uint8_t *window, uint8_t *rawData, uint8_t *length);
+};
+
+static const Decoder decoders[] = {
+    {"firmware", [](const uint8_t *window, uint8_t *rawData, uint8_t *length) {
+       uint8_t detail;
+       return decodeFrame(window, rawData, length, &detail) == DecodeStatus::Ok;
+     }},
+    {"offset1", [](const uint8_t *window, uint8_t *rawData, uint8_t *length) { return decodeWindow(window, 1, Copies::None, rawData, length); }},
+    {"second", [](const uint8_t *window, uint8_t *rawData, uint8_t *length) { return decodeWindow(window, 0, Copies::Second, rawData, length); }},
+    {"merge", [](const uint8_t *window, uint8_t *rawData, uint8_t *length) { return decodeWindow(window, 0, Copies::Merge, rawData, length); }},
+    {"lenient", decodeLenient},
+};
+static const unsigned decoderCount = sizeof(decoders) / sizeof(decoders[0]);
+
+//------------------------------- Impairments -------------------------------
+enum class Impairment : uint8_t
+{
+  Flip,
+  Slip,
+  Truncate,
+  Noise
+};
+static const char *const impairmentNames[] = {"flip", "slip", "truncate", "noise"};
+
+static void randomBytes(std::mt19937 &random, uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    buffer[i] = random();
+}
+
+static uint8_t getBit(const uint8_t *buffer, size_t bit) { return (buffer[bit / 8] >> (7 - bit % 8)) & 1; }
+static void setBit(uint8_t *buffer, size_t bit, uint8_t value)
+{
+  buffer[bit / 8] = (buffer[bit / 8] & ~(0x80 >> (bit % 8))) | (value << (7 - bit % 8));
+}
+
+// Bits dropped or repeated: the window is refilled from the frame, noise after its end
+static void slipBits(std::mt19937 &random, uint8_t *window, double rate)
+{
+  uint8_t sent[Corpus::c_windowSize];
+  memcpy(sent, window, sizeof(sent));
+  randomBytes(random, window, Corpus::c_windowSize);
+  std::geometric_distribution<size_t> gap(rate);
+  size_t nextSlip = gap(random);
+  size_t in = 0;
+  for (size_t out = 0; out < Corpus::c_windowSize * 8 && in < Corpus::c_windowSize * 8; out++, in++)
+  {
+    if (in == nextSlip)
+    {
+      nextSlip = in + 1 + gap(random);
+      if (random() & 1)
+      {
+        // Dropped bit
+        if (++in == Corpus::c_windowSize * 8)
+          break;
+      }
+      else
+      {
+        // Repeated bit
+        setBit(window, out++, getBit(sent, in));
+        if (out == Corpus::c_windowSize * 8)
+          break;
+      }
+    }
+    setBit(window, out, getBit(sent, in));
+  }
+}
+
+static void impair(std::mt19937 &random, uint8_t *window, Impairment impairment, double rate)
+{
+  std::uniform_real_distribution<double> uniform(0, 1);
+  switch (impairment)
+  {
+  case Impairment::Flip:
+    Corpus::flipBits(random, window, Corpus::c_windowSize, rate);
+    break;
+  case Impairment::Slip:
+    slipBits(random, window, rate);
+    break;
+  case Impairment::Truncate:
+    if (uniform(random) < rate)
+    {
+      size_t end = random() % (Corpus::c_windowSize * 8);
+      for (size_t bit = end; bit < Corpus::c_windowSize * 8; bit++)
+        setBit(window, bit, random() & 1);
+    }
+    break;
+  case Impairment::Noise:
+    randomBytes(random, window, Corpus::c_windowSize);
+    break;
+  }
+}
+
+//--------------------------------- Curve -----------------------------------
+struct Point
+{
+  Impairment impairment;
+  double rate;
+  // Filled by measure()
+  double success[decoderCount] = {};
+  double falseAccept[decoderCount] = {};
+};
+
+static void measure(Point *point, size_t frameCount, unsigned seed)
+{
+  std::mt19937 random(seed);
+  size_t successCounts[decoderCount] = {0};
+  size_t falseAcceptCounts[decoderCount] = {0};
+  for (size_t i = 0; i < frameCount; i++)
+  {
+    Packet packet = Corpus::randomPacket(random);
+    uint8_t sent[c_maxRawPacketSize];
+    uint8_t sentLength = packet.toRaw(sent);
+    uint8_t window[Corpus::c_windowSize];
+    Corpus::encodeWindow(&packet, window);
+    impair(random, window, point->impairment, point->rate);
+
+    for (unsigned d = 0; d < decoderCount; d++)
+    {
+      uint8_t rawData[c_maxRawPacketSize];
+      uint8_t length;
+      if (!decoders[d].decode(window, rawData, &length))
+        continue;
+      // Noise windows have no sent packet
+      if (point->impairment != Impairment::Noise && length == sentLength && memcmp(rawData, sent, length) == 0)
+        successCounts[d]++;
+      else
+        falseAcceptCounts[d]++;
+    }
+  }
+  for (unsigned d = 0; d < decoderCount; d++)
+  {
+    point->success[d] = 100.0 * successCounts[d] / frameCount;
+    point->falseAccept[d] = 100.0 * falseAcceptCounts[d] / frameCount;
+  }
+}
+
+static bool saveCurve(const char *path, const std::vector<Point> &curve)
+{
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+  {
+    perror(path);
+    return false;
+  }
+  fprintf(file, "impairment,rate,decoder,success,false_accept\n");
+  for (const Point &point : curve)
+    for (unsigned d = 0; d < decoderCount; d++)
+      fprintf(file, "%s,%g,%s,%.4f,%.4f\n", impairmentNames[(uint8_t)point.impairment], point.rate, decoders[d].name,
+              point.success[d], point.falseAccept[d]);
+  fclose(file);
+  return true;
+}
+
+// Returns the number of regressions, or -1 if the file cannot be read
+static int checkCurve(const char *path, const std::vector<Point> &curve)
+{
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  int regressionCount = 0;
+  unsigned comparedCount = 0;
+  char line[128];
+  fgets(line, sizeof(line), file);
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    char impairment[16], decoder[16];
+    double rate, success, falseAccept;
+    if (sscanf(line, "%15[^,],%lf,%15[^,],%lf,%lf", impairment, &rate, decoder, &success, &falseAccept) != 5)
+      continue;
+    for (const Point &point : curve)
+      for (unsigned d = 0; d < decoderCount; d++)
+      {
+        if (strcmp(impairment, impairmentNames[(uint8_t)point.impairment]) != 0 || strcmp(decoder, decoders[d].name) != 0 ||
+            fabs(rate - point.rate) > 1e-9 * rate)
+          continue;
+        comparedCount++;
+        if (point.success[d] < success - c_tolerance || point.falseAccept[d] > falseAccept + c_tolerance)
+        {
+          printf("REGRESSION %s %g %s: success %.4f (was %.4f), false accept %.4f (was %.4f)\n", impairment, rate, decoder,
+                 point.success[d], success, point.falseAccept[d], falseAccept);
+          regressionCount++;
+        }
+      }
+  }
+  fclose(file);
+  if (comparedCount == 0)
+  {
+    printf("No point of this run in %s\n", path);
+    return -1;
+  }
+  printf("%u points compared\n", comparedCount);
+  return regressionCount;
+}
+
+//---------------------------------- Main -----------------------------------
+int main(int argc, char **argv)
+{
+  size_t frameCount = 20000;
+  const char *savePath = NULL;
+  const char *checkPath = NULL;
+  for (int arg = 1; arg + 1 < argc; arg += 2)
+  {
+    if (strcmp(argv[arg], "-n") == 0)
+      frameCount = strtoul(argv[arg + 1], NULL, 0);
+    else if (strcmp(argv[arg], "-o") == 0)
+      savePath = argv[arg + 1];
+    else if (strcmp(argv[arg], "-c") == 0)
+      checkPath = argv[arg + 1];
+  }
+
+  std::vector<Point> curve;
+  for (double rate : {0.0, 1e-4, 3e-4, 1e-3, 3e-3, 1e-2, 3e-2})
+    curve.push_back({Impairment::Flip, rate});
+  for (double rate : {1e-4, 3e-4, 1e-3, 3e-3, 1e-2})
+    curve.push_back({Impairment::Slip, rate});
+  for (double rate : {0.01, 0.03, 0.1, 0.3, 1.0})
+    curve.push_back({Impairment::Truncate, rate});
+  curve.push_back({Impairment::Noise, 1.0});
+
+  printf("%zu frames per point, success%% / false accept%%\n%-9s %7s", frameCount, "", "rate");
+  for (unsigned d = 0; d < decoderCount; d++)
+    printf(" %16s", decoders[d].name);
+  printf("\n");
+  for (size_t i = 0; i < curve.size(); i++)
+  {
+    Point *point = &curve[i];
+    // Each point has its own seed: the frames of a point do not depend on the other points
+    measure(point, frameCount, 1 + i);
+    printf("%-9s %7g", impairmentNames[(uint8_t)point->impairment], point->rate);
+    for (unsigned d = 0; d < decoderCount; d++)
+      printf(" %8.3f/%7.4f", point->success[d], point->falseAccept[d]);
+    printf("\n");
+  }
+
+  if (savePath != NULL && !saveCurve(savePath, curve))
+    return 1;
+  if (checkPath != NULL)
+  {
+    int regressionCount = checkCurve(checkPath, curve);
+    if (regressionCount != 0)
+      return 1;
+    printf("No regression against %s\n", checkPath);
+  }
+  return 0;
+}
@@ -0,0 +1,316 @@
+/*---------------------------------------------------------------------------
+ * Parameter sweep of the InOne receive path
+ * Replays a corpus through a model of InOne::Manager reception (rfRxCallback filling the 60-byte buffer, the
+ * receiver reset of isPacketAvailable, decodeFrame, and the repeat filter of BindingTable::process) under every
+ * combination of the tuning knobs, on a pool of worker threads sharing the corpus:
+ *   tol     bit offsets tried around the nominal frame position (0, +1, -1, ... up to tol)
+ *   copies  none: first copy only (firmware), second: decode the second copy when the first fails,
+ *           merge: replace the invalid Manchester pairs of the first copy with those of the second
+ *   reset   idle time after which a partial buffer is dropped (ms, 0 never), firmware 600
+ *   dedup   window of the repeat filter (ms), firmware c_bindingDedupMs
+ * A generated corpus simulates wall switch presses: each press is sent 3 times, with bit errors, bit slips,
+ * truncated frames and noise windows. Its ground truth gives the rate of correctly decoded frames, the rate of
+ * wrong packets among the decoded ones, the rate of presses acted upon and the extra actions per 100 presses.
+ * A capture file only gives the rate of decoded windows (its windows are assumed 100 ms apart).
+ * cpu is the thread time of the replay per received window.
+ *
+ * Build: g++ -O2 -pthread -I../firmware -o inonesweep inonesweep.cpp ../firmware/InOneCodec.cpp ../firmware/InOne.cpp
+ * Usage: inonesweep [-j threads] <capture file>
+ *        inonesweep [-j threads] -g <press count> [bit error rate]    (generated corpus, default rate 0.0005)
+ */
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include "Corpus.h"
+#include "Decoders.h"
+#include "InOneCodec.h"
+
+using namespace InOne;
+
+//--------------------------------- Traffic ---------------------------------
+// Wall switch behaviour and radio impairments of the generated corpus
+static const unsigned switchCount = 16;
+static const double pressMeanGapMs = 1000;
+static const unsigned repeatCount = 3;
+static const uint32_t repeatGapMs = 40;
+static const double slipRate = 0.03;
+static const double truncationRate = 0.005;
+// Noise windows (sync word detected on noise) per press
+static const double noiseRate = 0.2;
+static const uint32_t captureGapMs = 100;
+
+struct Press
+{
+  uint8_t rawData[c_maxRawPacketSize];
+  uint8_t length;
+};
+
+// A window received by the radio: at most c_windowSize bytes of a corpus window
+struct Event
+{
+  uint32_t window;
+  uint32_t time;
+  uint8_t byteCount;
+  // Press sent, -1 for noise or unknown
+  int32_t press;
+};
+
+struct Traffic
+{
+  Corpus corpus;
+  std::vector<Event> events;
+  std::vector<Press> presses;
+  bool hasTruth;
+};
+
+static void generateTraffic(Traffic *traffic, size_t pressCount, double bitErrorRate)
+{
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::exponential_distribution<double> pressGap(1 / pressMeanGapMs);
+
+  Packet switches[switchCount];
+  for (unsigned i = 0; i < switchCount; i++)
+    switches[i] = Corpus::randomPacket(random);
+
+  double time = 0;
+  uint8_t window[Corpus::c_windowSize];
+  uint8_t slipped[Corpus::c_windowSize];
+  for (size_t i = 0; i < pressCount; i++)
+  {
+    time += pressGap(random);
+    Packet *packet = &switches[random() % switchCount];
+    // Each press of a switch uses the next sequence index, as InOne::Switch does
+    packet->sequenceIndex = (packet->sequenceIndex + 1) & 0x3;
+    static const Command commands[] = {Command::On, Command::Off, Command::DimStart, Command::DimStop};
+    packet->command = commands[random() % 4];
+    for (unsigned j = 0; j < sizeof(packet->data); j++)
+      packet->data[j] = random();
+
+    Press press;
+    press.length = packet->toRaw(press.rawData);
+    traffic->presses.push_back(press);
+    for (unsigned repeat = 0; repeat < repeatCount; repeat++)
+    {
+      Corpus::encodeWindow(packet, window);
+      if (uniform(random) < slipRate)
+      {
+        static const int slips[] = {-2, -1, 1, 2};
+        shiftBits(window, slipped, slips[random() % 4]);
+        memcpy(window, slipped, sizeof(window));
+      }
+      Corpus::flipBits(random, window, sizeof(window), bitErrorRate);
+
+      Event event;
+      event.window = traffic->corpus.add(window);
+      event.time = time + repeat * repeatGapMs;
+      event.byteCount = uniform(random) < truncationRate ? 1 + random() % (Corpus::c_windowSize - 1) : Corpus::c_windowSize;
+      event.press = i;
+      traffic->events.push_back(event);
+    }
+    if (uniform(random) < noiseRate)
+    {
+      for (size_t j = 0; j < sizeof(window); j++)
+        window[j] = random();
+      Event event;
+      event.window = traffic->corpus.add(window);
+      event.time = time + uniform(random) * pressMeanGapMs;
+      event.byteCount = Corpus::c_windowSize;
+      event.press = -1;
+      traffic->events.push_back(event);
+    }
+  }
+  // Presses may overlap: collisions are not modelled, the frames are received in time order
+  std::stable_sort(traffic->events.begin(), traffic->events.end(), [](const Event &a, const Event &b) { return a.time < b.time; });
+  traffic->hasTruth = true;
+}
+
+static void captureTraffic(Traffic *traffic)
+{
+  for (size_t i = 0; i < traffic->corpus.count(); i++)
+  {
+    Event event;
+    event.window = i;
+    event.time = i * captureGapMs;
+    event.byteCount = Corpus::c_windowSize;
+    event.press = -1;
+    traffic->events.push_back(event);
+  }
+  traffic->hasTruth = false;
+}
+
+//------------------------------ Configurations ------------------------------
+struct Config
+{
+  uint8_t offsetTolerance;
+  Copies copies;
+  uint32_t resetMs;
+  uint32_t dedupMs;
+};
+
+//--------------------------------- Replay ----------------------------------
+struct Outcome
+{
+  size_t decodedCount;
+  size_t wrongCount;
+  size_t actedPressCount;
+  size_t extraActionCount;
+  double cpuSeconds;
+};
+
+static double threadSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool isPress(const Traffic &traffic, int32_t press, const uint8_t *rawData, uint8_t length)
+{
+  if (press < 0)
+    return false;
+  const Press *sent = &traffic.presses[press];
+  return sent->length == length && memcmp(sent->rawData, rawData, length) == 0;
+}
+
+static void replay(const Traffic &traffic, const Config &config, Outcome *outcome)
+{
+  memset(outcome, 0, sizeof(*outcome));
+  std::vector<uint16_t> actionCounts(traffic.presses.size());
+  uint8_t buffer[Corpus::c_windowSize];
+  size_t bufferCount = 0;
+  int32_t bufferPress = -1;
+  uint32_t lastRxTime = 0;
+  Packet lastAction;
+  memset(&lastAction, 0, sizeof(lastAction));
+  uint32_t lastActionTime = 0;
+  bool hasAction = false;
+  double start = threadSeconds();
+
+  for (const Event &event : traffic.events)
+  {
+    // isPacketAvailable: drop a partial frame after the reset time without radio data
+    if (config.resetMs != 0 && event.time - lastRxTime > config.resetMs)
+      bufferCount = 0;
+    lastRxTime = event.time;
+
+    // rfRxCallback: the window bytes complete the buffer
+    const uint8_t *window = traffic.corpus.window(event.window);
+    for (uint8_t i = 0; i < event.byteCount; i++)
+    {
+      if (bufferCount == 0)
+        bufferPress = event.press;
+      buffer[bufferCount++] = window[i];
+      if (bufferCount < Corpus::c_windowSize)
+        continue;
+      bufferCount = 0;
+
+      uint8_t rawData[c_maxRawPacketSize];
+      uint8_t length;
+      if (!decodeWindow(buffer, config.offsetTolerance, config.copies, rawData, &length))
+        continue;
+      outcome->decodedCount++;
+      int32_t press = isPress(traffic, event.press, rawData, length) ? event.press : isPress(traffic, bufferPress, rawData, length) ? bufferPress
+                                                                                                                                   : -1;
+      if (press < 0)
+        outcome->wrongCount++;
+
+      // BindingTable::process: repeated frames of a press are ignored during the dedup window
+      Packet packet;
+      Packet::fromRaw(&packet, rawData, length);
+      if (hasAction && event.time - lastActionTime < config.dedupMs &&
+          packet.id == lastAction.id && packet.channel == lastAction.channel &&
+          packet.command == lastAction.command && packet.sequenceIndex == lastAction.sequenceIndex)
+        continue;
+      lastAction = packet;
+      lastActionTime = event.time;
+      hasAction = true;
+      if (press >= 0)
+        actionCounts[press]++;
+    }
+  }
+
+  for (uint16_t count : actionCounts)
+  {
+    outcome->actedPressCount += count != 0;
+    outcome->extraActionCount += count > 1 ? count - 1 : 0;
+  }
+  outcome->cpuSeconds = threadSeconds() - start;
+}
+
+//---------------------------------- Main -----------------------------------
+int main(int argc, char **argv)
+{
+  unsigned threadCount = std::thread::hardware_concurrency();
+  int arg = 1;
+  if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0)
+  {
+    threadCount = atoi(argv[arg + 1]);
+    arg += 2;
+  }
+  if (threadCount == 0)
+    threadCount = 1;
+
+  Traffic traffic;
+  if (arg + 1 < argc && strcmp(argv[arg], "-g") == 0)
+    generateTraffic(&traffic, strtoul(argv[arg + 1], NULL, 0), arg + 2 < argc ? atof(argv[arg + 2]) : 0.0005);
+  else if (arg < argc)
+  {
+    if (!traffic.corpus.map(argv[arg]))
+      return 1;
+    captureTraffic(&traffic);
+  }
+  else
+  {
+    fprintf(stderr, "Usage: %s [-j threads] <capture file> | [-j threads] -g <press count> [bit error rate]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<Config> configs;
+  for (uint8_t tolerance : {0, 1, 2})
+    for (Copies copies : {Copies::None, Copies::Second, Copies::Merge})
+      for (uint32_t reset : {0, 150, 600, 2000})
+        for (uint32_t dedup : {0, 250, 1000})
+          configs.push_back({tolerance, copies, reset, dedup});
+
+  // Worker threads take the next configuration until all are done
+  std::vector<Outcome> outcomes(configs.size());
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threadCount; i++)
+    workers.emplace_back([&] {
+      for (size_t config = next++; config < configs.size(); config = next++)
+        replay(traffic, configs[config], &outcomes[config]);
+    });
+  for (std::thread &worker : workers)
+    worker.join();
+
+  size_t frameCount = 0;
+  for (const Event &event : traffic.events)
+    frameCount += !traffic.hasTruth || event.press >= 0;
+  printf("%zu windows, %zu presses, %u threads\n", traffic.events.size(), traffic.presses.size(), threadCount);
+  printf("%4s %-7s %6s %6s %9s %9s %9s %9s %9s\n", "tol", "copies", "reset", "dedup", "decoded%", "wrong%", "pressed%", "extra/100", "cpu us");
+  for (size_t i = 0; i < configs.size(); i++)
+  {
+    const Config &config = configs[i];
+    const Outcome &outcome = outcomes[i];
+    bool isFirmware = config.offsetTolerance == 0 && config.copies == Copies::None && config.resetMs == 600 && config.dedupMs == 1000;
+    printf("%4u %-7s %6u %6u", config.offsetTolerance, copiesNames[(uint8_t)config.copies], config.resetMs, config.dedupMs);
+    if (traffic.hasTruth)
+      printf(" %9.3f %9.4f %9.3f %9.2f",
+             100.0 * (outcome.decodedCount - outcome.wrongCount) / frameCount,
+             outcome.decodedCount ? 100.0 * outcome.wrongCount / outcome.decodedCount : 0.0,
+             100.0 * outcome.actedPressCount / traffic.presses.size(),
+             100.0 * outcome.extraActionCount / traffic.presses.size());
+    else
+      printf(" %9.3f %9s %9s %9s", 100.0 * outcome.decodedCount / frameCount, "-", "-", "-");
+    printf(" %9.3f%s\n", 1e6 * outcome.cpuSeconds / traffic.events.size(), isFirmware ? "  *firmware" : "");
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------
+ * Host decoder for the firmware log records
+ * Reads the gateway serial output on stdin, turns the "!<id>,<ms>,<arg>..." hex records back into text
+ * with the message table of the firmware, and copies the other lines unchanged
+ *
+ * Build: g++ -I../firmware -o logdecode logdecode.cpp
+ * Usage: logdecode < /dev/ttyUSB0
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char *const formats[] = {
+#define LOG_MESSAGE(id, format) format,
+#include "LogMessages.h"
+#undef LOG_MESSAGE
+};
+
+static const unsigned formatCount = sizeof(formats) / sizeof(formats[0]);
+
+// Matches c_maxLogArgs in the firmware
+static const unsigned maxArgs = 4;
+
+static bool decode(const char *line)
+{
+  unsigned values[2 + maxArgs] = {0};
+  unsigned count = 0;
+  const char *p = line + 1;
+  while (count < 2 + maxArgs)
+  {
+    char *end;
+    values[count++] = strtoul(p, &end, 16);
+    if (end == p)
+      return false;
+    if (*end != ',')
+      break;
+    p = end + 1;
+  }
+  if (count < 2 || values[0] >= formatCount)
+    return false;
+
+  printf("[%u ms] ", values[1]);
+  printf(formats[values[0]], values[2], values[3], values[4], values[5]);
+  printf("\n");
+  return true;
+}
+
+int main()
+{
+  char line[256];
+  while (fgets(line, sizeof(line), stdin) != NULL)
+  {
+    line[strcspn(line, "\r\n")] = 0;
+    if (line[0] != '!' || !decode(line))
+      printf("%s\n", line);
+    fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+#---------------------------------------------------------------------------
+# RAM and flash usage of the firmware, per section and per symbol
+#
+# Build the firmware first, e.g.:
+#   arduino-cli compile --fqbn arduino:avr:uno --output-dir build firmware
+# Usage: tools/memreport.sh [build/firmware.ino.elf] [symbol count]
+#
+# RAM holds .data (also stored in flash, to initialize it) and .bss, the stack uses the rest:
+# compare with the free stack minimum reported by the "memory" serial command
+
+ELF=${1:-build/firmware.ino.elf}
+COUNT=${2:-20}
+NM=${AVR_NM:-avr-nm}
+SIZE=${AVR_SIZE:-avr-size}
+
+if [ ! -f "$ELF" ]; then
+  echo "$ELF not found" >&2
+  exit 1
+fi
+
+"$SIZE" -A "$ELF" | awk '$1 ~ /^\.(text|data|bss|noinit)$/ { print }'
+echo
+
+# Symbol types: d/D .data, b/B .bss, t/T/r/R/W/w code and flash constants
+echo "Largest RAM symbols (bytes):"
+"$NM" -C -S -t d --size-sort "$ELF" | awk '$3 ~ /^[dDbB]$/ { size = $2 + 0; $1 = $2 = $3 = ""; printf "%6d %s\n", size, substr($0, 4) }' | sort -rn | head -n "$COUNT"
+echo
+
+echo "Largest flash symbols (bytes):"
+"$NM" -C -S -t d --size-sort "$ELF" | awk '$3 ~ /^[tTrRwW]$/ { size = $2 + 0; $1 = $2 = $3 = ""; printf "%6d %s\n", size, substr($0, 4) }' | sort -rn | head -n "$COUNT"
@@ -0,0 +1,110 @@
+/*---------------------------------------------------------------------------
+ * RF to MQTT latency of the gateway packets
+ * Reads the service output on stdin, and uses its "Timing > <received>,<decode us>,<emit us>,<read us>,<publish us>"
+ * lines: the device times of each packet, followed by the host times it was read from the serial link and published.
+ * Host times are on its monotonic clock. The device clock is mapped to the host clock with ClockSync, from the packet
+ * lines and from the "Clock > <device time>,<request us>,<read us>" replies to the periodic "clock" requests, then the
+ * latency distribution of each stage is printed every 100 packets and at the end of the input.
+ *
+ * Build: g++ -O2 -o rflatency rflatency.cpp
+ * Usage: python3 rf2mqtt.py | rflatency
+ *
+ * The serial stage is measured from the fastest line of each sync window, so it is the time above the shortest transfer
+ */
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ClockSync.h"
+
+static const char *const stageNames[] = {"decode", "emit", "serial", "publish", "total"};
+enum
+{
+  STAGE_DECODE,
+  STAGE_EMIT,
+  STAGE_SERIAL,
+  STAGE_PUBLISH,
+  STAGE_TOTAL,
+  STAGE_COUNT
+};
+
+static const unsigned reportInterval = 100;
+
+static std::vector<int64_t> latencies[STAGE_COUNT];
+
+static int64_t percentile(std::vector<int64_t> &values, unsigned percent)
+{
+  size_t index = (values.size() - 1) * percent / 100;
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+static void printReport()
+{
+  printf("%-8s %8s %8s %8s %8s %8s (us)\n", "stage", "count", "p50", "p90", "p99", "max");
+  for (unsigned stage = 0; stage < STAGE_COUNT; stage++)
+  {
+    std::vector<int64_t> &values = latencies[stage];
+    if (values.empty())
+      continue;
+    printf("%-8s %8zu %8" PRId64 " %8" PRId64 " %8" PRId64 " %8" PRId64 "\n", stageNames[stage], values.size(),
+           percentile(values, 50), percentile(values, 90), percentile(values, 99),
+           *std::max_element(values.begin(), values.end()));
+  }
+  fflush(stdout);
+}
+
+int main()
+{
+  static const char prefix[] = "Timing > ";
+  static const char clockPrefix[] = "Clock > ";
+  ClockSync sync;
+  uint64_t lastReceived = 0;
+  unsigned packetCount = 0;
+  char line[256];
+
+  while (fgets(line, sizeof(line), stdin) != NULL)
+  {
+    // The clock replies carry no packet, but keep the clock mapping up to date between packets
+    uint64_t deviceUs;
+    int64_t readUs;
+    if (strncmp(line, clockPrefix, sizeof(clockPrefix) - 1) == 0 &&
+        sscanf(line + sizeof(clockPrefix) - 1, "%" SCNx64 ",%*d,%" SCNd64, &deviceUs, &readUs) == 2)
+    {
+      if (deviceUs < lastReceived)
+        sync = ClockSync();
+      lastReceived = deviceUs;
+      sync.addSample(deviceUs, readUs);
+      continue;
+    }
+    if (strncmp(line, prefix, sizeof(prefix) - 1) != 0)
+      continue;
+
+    uint64_t received;
+    uint32_t decodeUs, emitUs;
+    int64_t publishUs;
+    if (sscanf(line + sizeof(prefix) - 1, "%" SCNx64 ",%" SCNu32 ",%" SCNu32 ",%" SCNd64 ",%" SCNd64,
+               &received, &decodeUs, &emitUs, &readUs, &publishUs) != 5)
+      continue;
+
+    // The gateway has restarted, its clock is no longer related to the previous samples
+    if (received < lastReceived)
+      sync = ClockSync();
+    lastReceived = received;
+
+    sync.addSample(received + emitUs, readUs);
+    int64_t receivedHost = sync.toHost(received);
+    latencies[STAGE_DECODE].push_back(decodeUs);
+    latencies[STAGE_EMIT].push_back(emitUs);
+    latencies[STAGE_SERIAL].push_back(readUs - (receivedHost + emitUs));
+    latencies[STAGE_PUBLISH].push_back(publishUs - readUs);
+    latencies[STAGE_TOTAL].push_back(publishUs - receivedHost);
+
+    if (++packetCount % reportInterval == 0)
+      printReport();
+  }
+
+  printReport();
+  return 0;
+}
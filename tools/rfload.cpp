@@ -0,0 +1,449 @@
+/*---------------------------------------------------------------------------
+ * Synthetic RF load on the gateway firmware, run in the host simulator (sim/)
+ * The firmware sources and the sketch itself are compiled unchanged for the host: the InOne and Ideo managers share
+ * one CC1101, modelled at the SPI level (sim/MockCC1101.h), and the tasks of firmware.ino run on the simulated clock
+ * with the time spent writing to the LCD. No keypad button is pressed.
+ * Simulated devices put frames on the air:
+ *   InOne    wall switch presses, each repeated (-R) every 40 ms or after the previous frame, with short, medium
+ *            and long packets (-l weights)
+ *   Ideo     unsolicited frames of a ventilation unit, on the default channel
+ * and a ventilation unit answers the Ideo polls 20 ms after each request. The host sends a poll command on the serial
+ * link every -i ms (0 disables them), overlapping the InOne presses.
+ * Arrivals (-p) at each rate of -r (presses per second, InOne share -m):
+ *   poisson  independent presses
+ *   burst    groups of -b presses starting within -w ms, e.g. the lights of a whole floor switched off at once
+ *   b2b      groups of -b presses whose frames follow each other, 1 ms apart
+ * Each rate runs in a fresh process for -d seconds, and gives a CSV row on stdout:
+ *   drops     presses never printed on the serial link, in percent
+ *   outcomes  fate of the frames at the radio (see Mock::Outcome): not listening (other protocol slot, TX,
+ *             calibration), busy with another frame, RX FIFO overflow, aborted by a strobe, corrupted by an overlap
+ *   delay     from the last byte of the frame received by the radio to the end of the packet line on the serial
+ *             link, in ms
+ *   headroom  main loop passes with no task due, and interrupt handler time, in percent of the run time
+ *   polls     Ideo poll commands and their timeouts
+ * Firmware run time is the host time multiplied by the CPU factor (-k), an approximation of the AVR speed which
+ * can be tuned so that the decode times of the packet lines match those of the board (see rflatency). The timings
+ * are not exactly reproducible from one run to the next.
+ *
+ * Build: g++ -O2 -DSTATS_ENABLED=0 -Isim -I../firmware -o rfload rfload.cpp sim/Sim.cpp sim/Arduino.cpp
+ *        sim/MockCC1101.cpp ../firmware/CC1101.cpp ../firmware/Clock.cpp ../firmware/Display.cpp
+ *        ../firmware/IdeoCache.cpp ../firmware/IdeoDecoder.cpp ../firmware/IdeoManager.cpp ../firmware/IdeoSerial.cpp
+ *        ../firmware/InOne.cpp ../firmware/InOneBinding.cpp ../firmware/InOneCodec.cpp ../firmware/InOneGesture.cpp
+ *        ../firmware/InOneManager.cpp ../firmware/InOneSerial.cpp ../firmware/InOneSwitch.cpp ../firmware/Keypad.cpp
+ *        ../firmware/Log.cpp ../firmware/Memory.cpp ../firmware/Protocol.cpp ../firmware/Scheduler.cpp
+ *        ../firmware/SerialLine.cpp ../firmware/TimerWheel.cpp
+ *        Add -DIDEO_SS_PIN=15 -DIDEO_INT_PIN=16 for a board with a dedicated Ideo TRX (DUAL_RADIO in firmware.ino):
+ *        each protocol then has its own chip, and not_listening also counts every frame at the chip of the other
+ *        protocol.
+ * Usage: rfload [-p poisson|burst|b2b] [-r rate,rate...] [-d seconds] [-m InOne share] [-l short,medium,long]
+ *               [-b burst size] [-w burst ms] [-R repeats] [-i Ideo poll ms] [-k cpu factor] [-s seed] > load.csv
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "EnableInterrupt.h"
+#include "MockCC1101.h"
+#include "Corpus.h"
+#include "InOneManager.h"
+#include "IdeoManager.h"
+#include "Protocol.h"
+#include "TimerWheel.h"
+#include "Scheduler.h"
+#include "SerialLine.h"
+#include "Log.h"
+#include "Clock.h"
+
+static const uint32_t c_repeatGapUs = 40000;
+static const uint32_t c_b2bGuardUs = 1000;
+static const uint32_t c_ideoResponseUs = 20000;
+// The firmware is started, and the last frames are given time to be printed
+static const Sim::Time c_warmupUs = 1000000;
+static const Sim::Time c_drainUs = 2000000;
+
+static const uint32_t c_inOneBitRate = 19200;
+static const uint32_t c_ideoBitRate = 9600;
+static const uint16_t c_ideoSyncWord = 0x2D00;
+static const uint8_t c_preambleBytes = 4;
+// Ideo frames answering the polls, not part of the load
+static const uint32_t c_responseTag = 0xFFFFFFFF;
+static const char c_unsolicitedDevice = 'U';
+static const char *const c_pollLine = "1>A,33,00000001\n";
+
+enum class Process : uint8_t
+{
+  Poisson,
+  Burst,
+  BackToBack
+};
+static const char *const processNames[] = {"poisson", "burst", "b2b"};
+
+struct Options
+{
+  Process process = Process::Poisson;
+  std::vector<double> rates = {1, 2, 5, 10, 20, 50};
+  double duration = 30;
+  double inOneShare = 0.9;
+  double lengthWeights[3] = {1, 1, 1};
+  unsigned burstSize = 24;
+  unsigned burstWindowMs = 500;
+  unsigned repeats = 3;
+  unsigned pollMs = 1000;
+  double cpuFactor = 300;
+  uint32_t seed = 1;
+};
+
+/** A switch press or an unsolicited Ideo frame, delivered if any of its frames gets printed */
+struct Press
+{
+  bool isInOne;
+  // Times at which the radio got the last byte of one of its frames
+  std::vector<Sim::Time> receptionEnds;
+  Sim::Time delivered;
+};
+
+static Options options;
+static std::vector<Press> presses;
+static uint32_t outcomeCounts[(uint8_t)Mock::Outcome::Count];
+static uint32_t strayCount;
+static uint32_t pollCount;
+static std::mt19937 loadRandom;
+
+static void onDelivered(uint32_t tag, bool isInOne, Sim::Time time)
+{
+  if (tag == 0 || tag > presses.size() || presses[tag - 1].isInOne != isInOne)
+  {
+    strayCount++;
+    return;
+  }
+  Press *press = &presses[tag - 1];
+  if (press->delivered == 0)
+    press->delivered = time;
+}
+
+//-------------------------------- Firmware ---------------------------------
+// The sketch itself, with its objects, tasks and interrupt handlers. The STATS hooks are compiled out
+#include "firmware.ino"
+
+// loop() without its STATS hooks
+static bool loopPass()
+{
+  return scheduler.run();
+}
+
+// Packet lines on the serial link: "0>" InOne packets tagged by their switch ID, "1>" Ideo frames of the
+// unsolicited device tagged by their params. Other lines are the replies to the polls and the traces
+static void onSerialOutput(uint8_t c, Sim::Time time)
+{
+  static std::string line;
+  if (c != '\n')
+  {
+    line += (char)c;
+    return;
+  }
+  if (line.compare(0, 2, "0>") == 0)
+  {
+    size_t id = line.find(',');
+    if (id != std::string::npos)
+      onDelivered(strtoul(line.c_str() + id + 1, NULL, 10), true, time);
+  }
+  else if (line.compare(0, 2, "1>") == 0 && line.size() > 3 && line[2] == c_unsolicitedDevice && line[3] == ',')
+  {
+    size_t params = line.find(',', 4);
+    if (params != std::string::npos)
+      onDelivered(strtoul(line.substr(params + 1, 8).c_str(), NULL, 16), false, time);
+  }
+  line.clear();
+}
+
+// Host polling a ventilation unit
+static void schedulePoll(Sim::Time time)
+{
+  Sim::schedule(time, [time]() {
+    pollCount++;
+    Serial.receive(c_pollLine);
+    schedulePoll(time + options.pollMs * 1000ULL);
+  });
+}
+
+//-------------------------------- Devices ----------------------------------
+static void ideoPayload(char device, uint8_t command, const char *params, std::vector<uint8_t> *payload)
+{
+  static const char nibbles[] = "0123456789ABCDEF";
+  // Header 0x3001, device, command, params, checksum as two hex digits, footer 0x0003 (little endian)
+  uint8_t bytes[16] = {0x01, 0x30, (uint8_t)device, command};
+  memcpy(&bytes[4], params, 8);
+  uint8_t checksum = 0;
+  for (uint8_t i = 0; i < 12; i++)
+    checksum += bytes[i];
+  bytes[12] = nibbles[checksum >> 4];
+  bytes[13] = nibbles[checksum & 0xF];
+  bytes[14] = 0x03;
+  bytes[15] = 0x00;
+  payload->assign(bytes, bytes + sizeof(bytes));
+}
+
+static void inOnePayload(uint32_t id, std::vector<uint8_t> *payload)
+{
+  InOne::Packet packet = Corpus::randomPacket(loadRandom);
+  packet.id = id & InOne::c_maxId;
+  packet.command = loadRandom() & 1 ? InOne::Command::On : InOne::Command::Off;
+  packet.isLearnMode = false;
+  std::discrete_distribution<int> length(options.lengthWeights, options.lengthWeights + 3);
+  packet.type = (InOne::PacketType)length(loadRandom);
+
+  uint8_t rawData[InOne::c_maxRawPacketSize];
+  uint8_t framedData[12];
+  uint8_t frame[InOne::c_rfTxFrameSize];
+  uint8_t rawLength = packet.toRaw(rawData);
+  LegrandProtocol::Encode(rawData, framedData, rawLength);
+  uint8_t frameSize = InOne::encodeFrame(framedData, rawLength, frame) / 2;
+  // The frame is written twice to the TX FIFO, as InOne::Manager::sendPacket() does
+  payload->assign(frame, frame + frameSize);
+  payload->insert(payload->end(), frame, frame + frameSize);
+}
+
+static Sim::Time sendAt(uint32_t tag, bool isInOne, const std::vector<uint8_t> &payload, Sim::Time start)
+{
+  Mock::Transmission tx;
+  tx.tag = tag;
+  tx.syncWord = isInOne ? 0x83E0 : c_ideoSyncWord;
+  tx.bitRate = isInOne ? c_inOneBitRate : c_ideoBitRate;
+  tx.preambleBytes = c_preambleBytes;
+  tx.payload = payload;
+  tx.start = start;
+  tx.source = NULL;
+  Sim::schedule(start, [tx]() { Mock::send(tx); });
+  return start + (tx.preambleBytes + 2 + payload.size()) * 8000000ULL / tx.bitRate;
+}
+
+// A new press at the given time, returns the end of its last frame. Back to back frames follow each other
+static Sim::Time addPress(Sim::Time start, bool isBackToBack)
+{
+  uint32_t tag = presses.size() + 1;
+  Press press;
+  press.isInOne = std::uniform_real_distribution<double>(0, 1)(loadRandom) < options.inOneShare;
+  press.delivered = 0;
+  std::vector<uint8_t> payload;
+  unsigned frameCount = 1;
+  if (press.isInOne)
+  {
+    inOnePayload(tag, &payload);
+    frameCount = options.repeats;
+  }
+  else
+  {
+    char params[9];
+    snprintf(params, sizeof(params), "%08X", tag);
+    ideoPayload(c_unsolicitedDevice, 0x33, params, &payload);
+  }
+
+  Sim::Time end = start;
+  for (unsigned i = 0; i < frameCount; i++)
+  {
+    // Long frames last more than the repeat period
+    Sim::Time frameStart = i == 0 ? start : end + c_b2bGuardUs;
+    if (!isBackToBack && frameStart < start + i * c_repeatGapUs)
+      frameStart = start + i * c_repeatGapUs;
+    end = sendAt(tag, press.isInOne, payload, frameStart);
+  }
+  presses.push_back(press);
+  return end;
+}
+
+static void generateLoad(double rate, Sim::Time start, Sim::Time end)
+{
+  unsigned groupSize = options.process == Process::Poisson ? 1 : options.burstSize;
+  std::exponential_distribution<double> gap(rate / groupSize / 1e6);
+  for (Sim::Time group = start + gap(loadRandom); group < end; group += gap(loadRandom))
+  {
+    Sim::Time trainEnd = group;
+    for (unsigned i = 0; i < groupSize; i++)
+    {
+      if (options.process == Process::BackToBack)
+        trainEnd = addPress(i == 0 ? group : trainEnd + c_b2bGuardUs, true);
+      else if (options.process == Process::Burst)
+        addPress(group + loadRandom() % (options.burstWindowMs * 1000 + 1), false);
+      else
+        addPress(group, false);
+    }
+  }
+}
+
+// The ventilation unit answers the Ideo frames transmitted by the gateway with the same fields
+static void onTransmit(const Mock::Transmission &tx)
+{
+  if (tx.source == NULL || (tx.syncWord >> 8) != (c_ideoSyncWord >> 8) || tx.payload.size() != 16)
+    return;
+  std::vector<uint8_t> payload;
+  ideoPayload((char)tx.payload[2], tx.payload[3], (const char *)&tx.payload[4], &payload);
+  Mock::Transmission response = tx;
+  response.tag = c_responseTag;
+  response.bitRate = c_ideoBitRate;
+  response.payload = payload;
+  response.start = tx.end + c_ideoResponseUs;
+  response.source = NULL;
+  Sim::schedule(response.start, [response]() { Mock::send(response); });
+}
+
+static void onOutcome(const Mock::Transmission &tx, Mock::Outcome outcome)
+{
+  if (tx.tag == 0 || tx.tag > presses.size())
+    return;
+  outcomeCounts[(uint8_t)outcome]++;
+  if (outcome == Mock::Outcome::Received || outcome == Mock::Outcome::Collided)
+    presses[tx.tag - 1].receptionEnds.push_back(Sim::time());
+}
+
+//---------------------------------- Run ------------------------------------
+static double percentile(std::vector<double> &values, double p)
+{
+  if (values.empty())
+    return 0;
+  size_t index = std::min(values.size() - 1, (size_t)(p / 100 * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+static void runLoad(double rate)
+{
+  Sim::begin(options.cpuFactor, options.seed);
+  loadRandom.seed(options.seed);
+  Mock::Chip chip(IOBL_SS_PIN, IOBL_INT_PIN, options.seed);
+#ifdef DUAL_RADIO
+  Mock::Chip ideoChip(IDEO_SS_PIN, IDEO_INT_PIN, options.seed + 1);
+#endif
+  Mock::onTransmit = onTransmit;
+  Mock::onOutcome = onOutcome;
+  Serial.setOutput(onSerialOutput);
+  setup();
+
+  Sim::Time start = c_warmupUs;
+  Sim::Time end = start + (Sim::Time)(options.duration * 1e6);
+  generateLoad(rate, start, end);
+  if (options.pollMs != 0)
+    schedulePoll(start);
+  Sim::runLoop(start, loopPass);
+  Sim::Time idleStart = Sim::idleTime();
+  Sim::Time interruptStart = Sim::interruptTime();
+  Sim::runLoop(end, loopPass);
+  double runTime = Sim::time() - start;
+  double headroom = 100.0 * (Sim::idleTime() - idleStart) / runTime;
+  double interruptShare = 100.0 * (Sim::interruptTime() - interruptStart) / runTime;
+  Sim::runLoop(end + c_drainUs, loopPass);
+  Serial.flush();
+
+  uint32_t sent[2] = {0, 0};
+  uint32_t delivered[2] = {0, 0};
+  std::vector<double> delays;
+  for (const Press &press : presses)
+  {
+    sent[press.isInOne]++;
+    if (press.delivered == 0)
+      continue;
+    delivered[press.isInOne]++;
+    // Delay from the reception of the frame which got through
+    Sim::Time receptionEnd = press.delivered;
+    for (Sim::Time end : press.receptionEnds)
+      if (end <= press.delivered)
+        receptionEnd = end;
+    delays.push_back((press.delivered - receptionEnd) / 1000.0);
+  }
+
+  Ideo::Unit *unit = ideoManager.findUnit(0, 'A');
+  printf("%s,%g,%g", processNames[(uint8_t)options.process], rate, options.duration);
+  for (int inOne = 1; inOne >= 0; inOne--)
+    printf(",%u,%u,%.2f", sent[inOne], delivered[inOne], sent[inOne] ? 100.0 * (sent[inOne] - delivered[inOne]) / sent[inOne] : 0.0);
+  for (uint8_t outcome = (uint8_t)Mock::Outcome::NotListening; outcome < (uint8_t)Mock::Outcome::Count; outcome++)
+    printf(",%u", outcomeCounts[outcome]);
+  printf(",%u", strayCount);
+  double p50 = percentile(delays, 50);
+  double p99 = percentile(delays, 99);
+  double max = delays.empty() ? 0 : *std::max_element(delays.begin(), delays.end());
+  printf(",%.1f,%.1f,%.1f,%.1f,%.2f", p50, p99, max, headroom, interruptShare);
+  printf(",%u,%u,%u\n", pollCount, unit != NULL ? unit->timeoutCount : 0, SerialLine::packetOutput.delayedCount());
+  fflush(stdout);
+}
+
+static bool parseList(const char *text, std::vector<double> *values)
+{
+  values->clear();
+  std::string list(text);
+  size_t position = 0;
+  while (position <= list.size())
+  {
+    size_t comma = list.find(',', position);
+    if (comma == std::string::npos)
+      comma = list.size();
+    values->push_back(strtod(list.substr(position, comma - position).c_str(), NULL));
+    position = comma + 1;
+  }
+  return !values->empty();
+}
+
+int main(int argc, char **argv)
+{
+  for (int arg = 1; arg + 1 < argc; arg += 2)
+  {
+    const char *value = argv[arg + 1];
+    if (strcmp(argv[arg], "-p") == 0)
+    {
+      for (uint8_t i = 0; i < 3; i++)
+        if (strcmp(value, processNames[i]) == 0)
+          options.process = (Process)i;
+    }
+    else if (strcmp(argv[arg], "-r") == 0)
+      parseList(value, &options.rates);
+    else if (strcmp(argv[arg], "-d") == 0)
+      options.duration = strtod(value, NULL);
+    else if (strcmp(argv[arg], "-m") == 0)
+      options.inOneShare = strtod(value, NULL);
+    else if (strcmp(argv[arg], "-l") == 0)
+    {
+      std::vector<double> weights;
+      parseList(value, &weights);
+      for (size_t i = 0; i < 3; i++)
+        options.lengthWeights[i] = i < weights.size() ? weights[i] : 0;
+    }
+    else if (strcmp(argv[arg], "-b") == 0)
+      options.burstSize = std::max(1UL, strtoul(value, NULL, 0));
+    else if (strcmp(argv[arg], "-w") == 0)
+      options.burstWindowMs = strtoul(value, NULL, 0);
+    else if (strcmp(argv[arg], "-R") == 0)
+      options.repeats = std::max(1UL, strtoul(value, NULL, 0));
+    else if (strcmp(argv[arg], "-i") == 0)
+      options.pollMs = strtoul(value, NULL, 0);
+    else if (strcmp(argv[arg], "-k") == 0)
+      options.cpuFactor = strtod(value, NULL);
+    else if (strcmp(argv[arg], "-s") == 0)
+      options.seed = strtoul(value, NULL, 0);
+  }
+
+  printf("process,rate,duration_s,inone_sent,inone_delivered,inone_drop_pct,ideo_sent,ideo_delivered,ideo_drop_pct,"
+         "not_listening,busy,overflow,aborted,collided,stray,delay_p50_ms,delay_p99_ms,delay_max_ms,"
+         "headroom_pct,isr_pct,polls,poll_timeouts,output_delayed\n");
+  fflush(stdout);
+  // Each rate starts from the power-on state of the firmware globals
+  for (double rate : options.rates)
+  {
+    pid_t child = fork();
+    if (child == 0)
+    {
+      runLoad(rate);
+      _exit(0);
+    }
+    int status;
+    if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fprintf(stderr, "rate %g: simulation failed\n", rate);
+      return 1;
+    }
+  }
+  return 0;
+}
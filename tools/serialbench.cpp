@@ -0,0 +1,317 @@
+/*---------------------------------------------------------------------------
+ * Serial command benchmark of the gateway firmware, run in the host simulator (sim/)
+ * The sketch is compiled unchanged for the host as in rfload, and the host sends InOne commands
+ * ("0>0,<id>,1,1") on the serial link at each rate of -r (commands per second, 0 sends them back to back at the
+ * baud rate) for -d seconds. The CC1101 is modelled at the SPI level (sim/MockCC1101.h), and the frames it
+ * transmits are decoded to find the command they belong to.
+ * With -x 1, the host first requests XON/XOFF flow control ("hello,xonxoff") and stops sending after the byte in
+ * progress when it gets XOFF. The 64-byte UART receive buffer of the core is modelled: bytes arriving while it is
+ * full are lost.
+ * Each rate runs in a fresh process, and gives a CSV row on stdout:
+ *   commands  sent by the host, transmitted on the air, and lost in percent of the sent ones. The backlog
+ *             commands were still waiting in the host at the end of the drain time, held back by flow control
+ *   overruns  bytes lost in the UART receive buffer, and lines dropped by the line assembler
+ *   stray     transmitted frames matching no command, or a command already transmitted
+ *   rate      transmitted commands per second, from the first newline to the last transmission
+ *   latency   from the end of the newline byte of the command to the start of its transmission by
+ *             InOne::Manager::sendPacket() (after the clear channel assessment), in ms
+ *   headroom  main loop passes with no task due, in percent of the run time
+ * Firmware run time is the host time multiplied by the CPU factor (-k), see rfload.
+ *
+ * Build: g++ -O2 -DSTATS_ENABLED=0 -Isim -I../firmware -o serialbench serialbench.cpp sim/Sim.cpp sim/Arduino.cpp
+ *        sim/MockCC1101.cpp ../firmware/CC1101.cpp ../firmware/Clock.cpp ../firmware/Display.cpp
+ *        ../firmware/IdeoCache.cpp ../firmware/IdeoDecoder.cpp ../firmware/IdeoManager.cpp ../firmware/IdeoSerial.cpp
+ *        ../firmware/InOne.cpp ../firmware/InOneBinding.cpp ../firmware/InOneCodec.cpp ../firmware/InOneGesture.cpp
+ *        ../firmware/InOneManager.cpp ../firmware/InOneSerial.cpp ../firmware/InOneSwitch.cpp ../firmware/Keypad.cpp
+ *        ../firmware/Log.cpp ../firmware/Memory.cpp ../firmware/Protocol.cpp ../firmware/Scheduler.cpp
+ *        ../firmware/SerialLine.cpp ../firmware/TimerWheel.cpp
+ * Usage: serialbench [-r rate,rate...] [-d seconds] [-x 0|1] [-k cpu factor] [-s seed] > serial.csv
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "EnableInterrupt.h"
+#include "MockCC1101.h"
+#include "InOneManager.h"
+#include "IdeoManager.h"
+#include "Protocol.h"
+#include "TimerWheel.h"
+#include "Scheduler.h"
+#include "SerialLine.h"
+#include "Log.h"
+#include "Clock.h"
+
+// The firmware is started, and the last commands are given time to be transmitted
+static const Sim::Time c_warmupUs = 1000000;
+static const Sim::Time c_drainUs = 5000000;
+// The host stops sending this long before the end, so that every command it sent can be transmitted
+static const Sim::Time c_settleUs = 1000000;
+
+struct Options
+{
+  std::vector<double> rates = {5, 10, 20, 50, 100, 0};
+  double duration = 10;
+  bool isFlowControlEnabled = false;
+  double cpuFactor = 300;
+  uint32_t seed = 1;
+};
+
+/** A command line sent by the host, tagged by its switch ID */
+struct Command
+{
+  Sim::Time newline;
+  Sim::Time transmitted;
+};
+
+static Options options;
+static std::vector<Command> commands;
+static uint32_t strayCount;
+
+//-------------------------------- Firmware ---------------------------------
+// The sketch itself, with its objects, tasks and interrupt handlers. The STATS hooks are compiled out
+#include "firmware.ino"
+
+// loop() without its STATS hooks
+static bool loopPass()
+{
+  return scheduler.run();
+}
+
+//---------------------------------- Host -----------------------------------
+// Bytes waiting to be sent, and the tags of their lines (0 for the other lines)
+static std::string hostOutput;
+static std::deque<uint32_t> hostTags;
+static bool isHostSending;
+static bool isHostPaused;
+// Back to back commands: the host sends the next one as soon as the previous one is out, until this time
+static Sim::Time backToBackEnd;
+
+static void hostSend(const char *line, uint32_t tag);
+
+static void sendCommand()
+{
+  uint32_t tag = commands.size() + 1;
+  char line[32];
+  snprintf(line, sizeof(line), "0>0,%u,1,1\n", tag);
+  commands.push_back({0, 0});
+  hostSend(line, tag);
+}
+
+static void onSerialOutput(uint8_t c, Sim::Time)
+{
+  if (c == SerialLine::c_xoff)
+    isHostPaused = true;
+  else if (c == SerialLine::c_xon)
+    isHostPaused = false;
+}
+
+// One byte per byte time. While paused, the host keeps watching the link for XON
+static void sendNextByte()
+{
+  // Bytes the firmware transmitted up to now reach the host
+  Serial.availableForWrite();
+  if (!isHostPaused)
+  {
+    if (hostOutput.empty() && Sim::time() < backToBackEnd)
+      sendCommand();
+    if (hostOutput.empty())
+    {
+      isHostSending = false;
+      return;
+    }
+    char data[2] = {hostOutput[0], 0};
+    hostOutput.erase(0, 1);
+    Serial.receive(data);
+    if (data[0] == '\n')
+    {
+      uint32_t tag = hostTags.front();
+      hostTags.pop_front();
+      if (tag != 0)
+        commands[tag - 1].newline = Sim::time() + Serial.byteUs();
+    }
+  }
+  Sim::schedule(Sim::time() + Serial.byteUs(), sendNextByte);
+}
+
+static void hostSend(const char *line, uint32_t tag)
+{
+  hostOutput += line;
+  hostTags.push_back(tag);
+  if (isHostSending)
+    return;
+  isHostSending = true;
+  Sim::schedule(Sim::time(), sendNextByte);
+}
+
+// The rest of the backlog stays in the host
+static void stopHost()
+{
+  size_t newline = hostOutput.find('\n');
+  if (newline != std::string::npos)
+  {
+    hostOutput.erase(newline + 1);
+    hostTags.resize(1);
+  }
+  backToBackEnd = 0;
+}
+
+static void scheduleCommands(double rate, Sim::Time start, Sim::Time end)
+{
+  if (rate <= 0)
+  {
+    backToBackEnd = end;
+    Sim::schedule(start, sendCommand);
+    return;
+  }
+  for (Sim::Time time = start; time < end; time += (Sim::Time)(1e6 / rate))
+    Sim::schedule(time, sendCommand);
+}
+
+// Frames transmitted by the gateway carry the switch ID of their command
+static void onTransmit(const Mock::Transmission &tx)
+{
+  if (tx.source == NULL)
+    return;
+  uint8_t window[InOne::c_rfRxPacketSize] = {0};
+  memcpy(window, tx.payload.data(), std::min(tx.payload.size(), sizeof(window)));
+  uint8_t rawData[InOne::c_maxRawPacketSize];
+  uint8_t length;
+  uint8_t detail;
+  InOne::Packet packet;
+  if (InOne::decodeFrame(window, rawData, &length, &detail) == InOne::DecodeStatus::Ok)
+    InOne::Packet::fromRaw(&packet, rawData, length);
+  else
+    packet.id = 0;
+
+  if (packet.id == 0 || packet.id > commands.size() || commands[packet.id - 1].transmitted != 0)
+  {
+    strayCount++;
+    return;
+  }
+  commands[packet.id - 1].transmitted = Sim::time();
+}
+
+//---------------------------------- Run ------------------------------------
+static double percentile(std::vector<double> &values, double p)
+{
+  if (values.empty())
+    return 0;
+  size_t index = std::min(values.size() - 1, (size_t)(p / 100 * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+static void runRate(double rate)
+{
+  Sim::begin(options.cpuFactor, options.seed);
+  Mock::Chip chip(IOBL_SS_PIN, IOBL_INT_PIN, options.seed);
+#ifdef DUAL_RADIO
+  Mock::Chip ideoChip(IDEO_SS_PIN, IDEO_INT_PIN, options.seed + 1);
+#endif
+  Mock::onTransmit = onTransmit;
+  Serial.setOutput(onSerialOutput);
+  setup();
+  if (options.isFlowControlEnabled)
+    hostSend("hello,xonxoff\n", 0);
+
+  Sim::Time start = c_warmupUs;
+  Sim::Time end = start + (Sim::Time)(options.duration * 1e6);
+  scheduleCommands(rate, start, end);
+  Sim::schedule(end + c_drainUs - c_settleUs, stopHost);
+  Sim::runLoop(start, loopPass);
+  Sim::Time idleStart = Sim::idleTime();
+  Sim::runLoop(end, loopPass);
+  double headroom = 100.0 * (Sim::idleTime() - idleStart) / (Sim::time() - start);
+  Sim::runLoop(end + c_drainUs, loopPass);
+
+  uint32_t sent = 0;
+  uint32_t transmitted = 0;
+  Sim::Time first = 0;
+  Sim::Time last = 0;
+  std::vector<double> latencies;
+  for (const Command &command : commands)
+  {
+    if (command.newline == 0)
+      continue;
+    sent++;
+    if (first == 0 || command.newline < first)
+      first = command.newline;
+    if (command.transmitted == 0)
+      continue;
+    transmitted++;
+    last = std::max(last, command.transmitted);
+    latencies.push_back((command.transmitted - command.newline) / 1000.0);
+  }
+
+  printf("%g,%u,%u,%u,%.2f,%zu", rate, options.isFlowControlEnabled, sent, transmitted,
+         sent ? 100.0 * (sent - transmitted) / sent : 0.0, commands.size() - sent);
+  printf(",%u,%u,%u", Serial.rxOverrunCount(), serialInput.overrunCount(), strayCount);
+  printf(",%.1f", last > first ? transmitted * 1e6 / (last - first) : 0.0);
+  double p50 = percentile(latencies, 50);
+  double p99 = percentile(latencies, 99);
+  double max = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+  printf(",%.1f,%.1f,%.1f,%.1f\n", p50, p99, max, headroom);
+  fflush(stdout);
+}
+
+static bool parseList(const char *text, std::vector<double> *values)
+{
+  values->clear();
+  std::string list(text);
+  size_t position = 0;
+  while (position <= list.size())
+  {
+    size_t comma = list.find(',', position);
+    if (comma == std::string::npos)
+      comma = list.size();
+    values->push_back(strtod(list.substr(position, comma - position).c_str(), NULL));
+    position = comma + 1;
+  }
+  return !values->empty();
+}
+
+int main(int argc, char **argv)
+{
+  for (int arg = 1; arg + 1 < argc; arg += 2)
+  {
+    const char *value = argv[arg + 1];
+    if (strcmp(argv[arg], "-r") == 0)
+      parseList(value, &options.rates);
+    else if (strcmp(argv[arg], "-d") == 0)
+      options.duration = strtod(value, NULL);
+    else if (strcmp(argv[arg], "-x") == 0)
+      options.isFlowControlEnabled = strtoul(value, NULL, 0) != 0;
+    else if (strcmp(argv[arg], "-k") == 0)
+      options.cpuFactor = strtod(value, NULL);
+    else if (strcmp(argv[arg], "-s") == 0)
+      options.seed = strtoul(value, NULL, 0);
+  }
+
+  printf("rate,xonxoff,sent,transmitted,lost_pct,backlog,uart_overruns,line_overruns,stray,commands_per_s,"
+         "latency_p50_ms,latency_p99_ms,latency_max_ms,headroom_pct\n");
+  fflush(stdout);
+  // Each rate starts from the power-on state of the firmware globals
+  for (double rate : options.rates)
+  {
+    pid_t child = fork();
+    if (child == 0)
+    {
+      runRate(rate);
+      _exit(0);
+    }
+    int status;
+    if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fprintf(stderr, "rate %g: simulation failed\n", rate);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include "Arduino.h"
+#include "EnableInterrupt.h"
+
+Sim::StatusRegister SREG;
+Sim::SpiDataRegister SPDR;
+uint8_t SPCR;
+uint8_t SPSR = 1 << SPIF;
+
+uint8_t ADMUX;
+uint8_t ADCSRA;
+uint8_t ADCSRB;
+uint8_t DIDR0;
+// No keypad button is pressed
+uint16_t ADC = 1023;
+
+HardwareSerial Serial;
+
+// AVR linker symbols of Memory.cpp, whose report is meaningless on the host
+uint8_t __stack;
+char *__brkval;
+
+//---------------------------------- Pins -----------------------------------
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+// Slave select pins select the SPI devices
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  Sim::digitalWrite(pin, value);
+}
+
+// MISO is low (radio crystal running), no button is pressed
+int digitalRead(uint8_t)
+{
+  return LOW;
+}
+
+int analogRead(uint8_t)
+{
+  Sim::spend(100);
+  return 1023;
+}
+
+void enableInterrupt(uint8_t pin, void (*handler)(), uint8_t)
+{
+  Sim::attachInterrupt(pin, handler);
+}
+
+void disableInterrupt(uint8_t pin)
+{
+  Sim::detachInterrupt(pin);
+}
+
+//---------------------------------- Time -----------------------------------
+unsigned long millis()
+{
+  Sim::spend(Sim::c_clockReadUs);
+  return Sim::now() / 1000;
+}
+
+unsigned long micros()
+{
+  Sim::spend(Sim::c_clockReadUs);
+  return Sim::now();
+}
+
+void delay(unsigned long ms)
+{
+  Sim::spend(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  Sim::spend(us);
+}
+
+long random(long max)
+{
+  return max > 0 ? Sim::randomEngine()() % max : 0;
+}
+
+long random(long min, long max)
+{
+  return min < max ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long)
+{
+}
+
+//---------------------------------- Print ----------------------------------
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    this->write(buffer[i]);
+  return size;
+}
+
+size_t Print::printNumber(unsigned long value, int base)
+{
+  char digits[8 * sizeof(long) + 1];
+  char *p = &digits[sizeof(digits) - 1];
+  *p = '\0';
+  if (base < 2)
+    base = 10;
+  do
+  {
+    uint8_t digit = value % base;
+    value /= base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+  } while (value != 0);
+  return this->write(p);
+}
+
+size_t Print::print(const __FlashStringHelper *string) { return this->write((const char *)string); }
+size_t Print::print(const char *string) { return this->write(string); }
+size_t Print::print(char c) { return this->write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base) { return this->printNumber(value, base); }
+size_t Print::print(unsigned int value, int base) { return this->printNumber(value, base); }
+size_t Print::print(unsigned long value, int base) { return this->printNumber(value, base); }
+size_t Print::print(int value, int base) { return this->print((long)value, base); }
+
+size_t Print::print(long value, int base)
+{
+  if (base != DEC)
+    return this->printNumber((unsigned long)value, base);
+  if (value >= 0)
+    return this->printNumber(value, DEC);
+  return this->write('-') + this->printNumber(-(unsigned long)value, DEC);
+}
+
+size_t Print::print(double value, int digits)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return this->write(buffer);
+}
+
+size_t Print::println() { return this->write('\n'); }
+size_t Print::println(const __FlashStringHelper *string) { return this->print(string) + this->println(); }
+size_t Print::println(const char *string) { return this->print(string) + this->println(); }
+size_t Print::println(char c) { return this->print(c) + this->println(); }
+size_t Print::println(unsigned char value, int base) { return this->print(value, base) + this->println(); }
+size_t Print::println(int value, int base) { return this->print(value, base) + this->println(); }
+size_t Print::println(unsigned int value, int base) { return this->print(value, base) + this->println(); }
+size_t Print::println(long value, int base) { return this->print(value, base) + this->println(); }
+size_t Print::println(unsigned long value, int base) { return this->print(value, base) + this->println(); }
+size_t Print::println(double value, int digits) { return this->print(value, digits) + this->println(); }
+
+//--------------------------------- Serial ----------------------------------
+static const size_t c_rxBufferSize = 64;
+
+void HardwareSerial::begin(unsigned long baudRate)
+{
+  this->drain();
+  // 10 bits per byte
+  this->m_byteUs = 10000000UL / baudRate;
+  this->m_lastDrainTime = Sim::now();
+}
+
+// Bytes transmitted since the last call leave the buffer
+void HardwareSerial::drain()
+{
+  Sim::Untimed untimed;
+  Sim::Time now = Sim::now();
+  if (this->m_count == 0)
+  {
+    this->m_lastDrainTime = now;
+    return;
+  }
+  while (this->m_count != 0 && now - this->m_lastDrainTime >= this->m_byteUs)
+  {
+    this->m_lastDrainTime += this->m_byteUs;
+    if (this->m_output != NULL)
+      this->m_output(this->m_buffer[this->m_head], this->m_lastDrainTime);
+    this->m_head = (this->m_head + 1) % sizeof(this->m_buffer);
+    this->m_count--;
+  }
+}
+
+int HardwareSerial::availableForWrite()
+{
+  this->drain();
+  return sizeof(this->m_buffer) - this->m_count;
+}
+
+// Blocks while the buffer is full, as the Arduino core does
+size_t HardwareSerial::write(uint8_t c)
+{
+  this->drain();
+  while (this->m_count == sizeof(this->m_buffer))
+  {
+    Sim::spend(this->m_byteUs / 4 + 1);
+    this->drain();
+  }
+  this->m_buffer[(this->m_head + this->m_count) % sizeof(this->m_buffer)] = c;
+  this->m_count++;
+  return 1;
+}
+
+void HardwareSerial::flush()
+{
+  while (this->m_count != 0)
+  {
+    Sim::spend(this->m_byteUs / 4 + 1);
+    this->drain();
+  }
+}
+
+void HardwareSerial::receive(const char *data)
+{
+  Sim::Untimed untimed;
+  Sim::Time time = Sim::now();
+  if (!this->m_input.empty() && this->m_input.back().first > time)
+    time = this->m_input.back().first;
+  for (; *data != '\0'; data++)
+  {
+    time += this->m_byteUs;
+    this->m_input.push_back(std::make_pair(time, (uint8_t)*data));
+  }
+}
+
+// Bytes which arrived since the last call enter the receive buffer, or are lost when it is full. Nothing is read
+// in between, so this gives the same buffer as the receive interrupt of the core
+void HardwareSerial::moveArrived()
+{
+  Sim::Time now = Sim::now();
+  while (!this->m_input.empty() && this->m_input.front().first <= now)
+  {
+    if (this->m_rxBuffer.size() < c_rxBufferSize)
+      this->m_rxBuffer.push_back(this->m_input.front().second);
+    else
+      this->m_rxOverrunCount++;
+    this->m_input.pop_front();
+  }
+}
+
+int HardwareSerial::available()
+{
+  this->moveArrived();
+  return this->m_rxBuffer.size();
+}
+
+int HardwareSerial::read()
+{
+  int c = this->peek();
+  if (c >= 0)
+    this->m_rxBuffer.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek()
+{
+  this->moveArrived();
+  if (this->m_rxBuffer.empty())
+    return -1;
+  return this->m_rxBuffer.front();
+}
@@ -0,0 +1,172 @@
+#ifndef _ARDUINO_H
+#define _ARDUINO_H
+
+/*---------------------------------------------------------------------------
+ * Subset of the Arduino core used by the firmware, on top of the host simulator
+ * Registers are objects of Sim.h: SREG masks the interrupts, SPDR transfers a byte to the selected SPI device.
+ * Flash strings are plain strings.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <utility>
+#include "Sim.h"
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define A0 14
+
+class __FlashStringHelper;
+#define F(string) ((const __FlashStringHelper *)(string))
+#define PROGMEM
+#define PSTR(string) (string)
+
+inline uint8_t pgm_read_byte(const void *p) { return *(const uint8_t *)p; }
+inline uint16_t pgm_read_word(const void *p) { return *(const uint16_t *)p; }
+inline uint32_t pgm_read_dword(const void *p) { return *(const uint32_t *)p; }
+inline const void *pgm_read_ptr(const void *p) { return *(const void *const *)p; }
+inline void *memcpy_P(void *dst, const void *src, size_t n) { return memcpy(dst, src, n); }
+inline int memcmp_P(const void *a, const void *b, size_t n) { return memcmp(a, b, n); }
+inline size_t strlen_P(const char *s) { return strlen(s); }
+inline int strcmp_P(const char *a, const char *b) { return strcmp(a, b); }
+inline int strncmp_P(const char *a, const char *b, size_t n) { return strncmp(a, b, n); }
+
+// Status register and SPI registers
+extern Sim::StatusRegister SREG;
+extern Sim::SpiDataRegister SPDR;
+extern uint8_t SPCR;
+// SPIF is always set: the transfer completes within the SPDR write
+extern uint8_t SPSR;
+#define SPIF 7
+#define SPI2X 0
+#define SPIE 7
+#define SPE 6
+#define DORD 5
+#define MSTR 4
+#define CPOL 3
+#define CPHA 2
+#define SPR1 1
+#define SPR0 0
+
+// ADC, free running from the keypad (Keypad.h): the conversion complete interrupt is not simulated
+extern uint8_t ADMUX;
+extern uint8_t ADCSRA;
+extern uint8_t ADCSRB;
+extern uint8_t DIDR0;
+extern uint16_t ADC;
+#define REFS0 6
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define ADTS2 2
+#define ADC0D 0
+
+inline void cli() { Sim::disableInterrupts(); }
+inline void sei() { Sim::enableInterrupts(); }
+inline void noInterrupts() { Sim::disableInterrupts(); }
+inline void interrupts() { Sim::enableInterrupts(); }
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+class Print
+{
+public:
+  virtual size_t write(uint8_t c) = 0;
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *string) { return this->write((const uint8_t *)string, strlen(string)); };
+
+  size_t print(const __FlashStringHelper *string);
+  size_t print(const char *string);
+  size_t print(char c);
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println(const __FlashStringHelper *string);
+  size_t println(const char *string);
+  size_t println(char c);
+  size_t println(unsigned char value, int base = DEC);
+  size_t println(int value, int base = DEC);
+  size_t println(unsigned int value, int base = DEC);
+  size_t println(long value, int base = DEC);
+  size_t println(unsigned long value, int base = DEC);
+  size_t println(double value, int digits = 2);
+  size_t println();
+
+private:
+  size_t printNumber(unsigned long value, int base);
+};
+
+/** UART with the 64-byte transmit and receive buffers of the Arduino core, the transmit buffer is drained at
+ *  the baud rate. Host commands are passed by the simulation to receive(), and arrive at the baud rate */
+class HardwareSerial : public Print
+{
+public:
+  void begin(unsigned long baudRate);
+  void end() {};
+  int available();
+  int read();
+  int peek();
+  int availableForWrite();
+  void flush();
+  size_t write(uint8_t c);
+  using Print::write;
+  operator bool() { return true; };
+
+  // Transmitted bytes are passed to the output, if any, with the time their transmission ended
+  void setOutput(void (*output)(uint8_t c, Sim::Time time)) { this->m_output = output; };
+  // Bytes sent by the host, the first one starts now or after the previous ones
+  void receive(const char *data);
+  uint32_t byteUs() { return this->m_byteUs; };
+  // Received bytes lost because the receive buffer was full
+  uint32_t rxOverrunCount() { return this->m_rxOverrunCount; };
+
+private:
+  void drain();
+  void moveArrived();
+
+  uint32_t m_byteUs = 87;
+  uint8_t m_buffer[64];
+  uint8_t m_head = 0;
+  uint8_t m_count = 0;
+  Sim::Time m_lastDrainTime = 0;
+  void (*m_output)(uint8_t c, Sim::Time time) = NULL;
+  // Bytes sent by the host, and the time at which each one is complete
+  std::deque<std::pair<Sim::Time, uint8_t>> m_input;
+  std::deque<uint8_t> m_rxBuffer;
+  uint32_t m_rxOverrunCount = 0;
+};
+
+extern HardwareSerial Serial;
+
+#endif //_ARDUINO_H
@@ -0,0 +1,10 @@
+#ifndef _ENABLEINTERRUPT_H
+#define _ENABLEINTERRUPT_H
+
+// Pin interrupts of the EnableInterrupt library, forwarded to the simulator
+#include <stdint.h>
+
+void enableInterrupt(uint8_t pin, void (*handler)(), uint8_t mode);
+void disableInterrupt(uint8_t pin);
+
+#endif //_ENABLEINTERRUPT_H
@@ -0,0 +1,25 @@
+#ifndef _LIQUIDCRYSTAL_H
+#define _LIQUIDCRYSTAL_H
+
+/*---------------------------------------------------------------------------
+ * HD44780 LCD of the Arduino LiquidCrystal library: only the time spent in the library is simulated
+ */
+#include "Arduino.h"
+
+class LiquidCrystal : public Print
+{
+public:
+  // Each command or character is followed by the 100 us wait of the library
+  static const uint32_t c_commandUs = 105;
+
+  LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t) {};
+
+  // Power-on wait and initialization sequence, then clear()
+  void begin(uint8_t, uint8_t) { Sim::spend(55000); this->clear(); };
+  void clear() { Sim::spend(2000); };
+  void setCursor(uint8_t, uint8_t) { Sim::spend(c_commandUs); };
+  size_t write(uint8_t) { Sim::spend(c_commandUs); return 1; };
+  using Print::write;
+};
+
+#endif //_LIQUIDCRYSTAL_H
@@ -0,0 +1,408 @@
+#include <string.h>
+#include <list>
+#include "MockCC1101.h"
+
+namespace Mock
+{
+
+  std::function<void(const Transmission &tx)> onTransmit;
+  std::function<void(const Transmission &tx, Outcome outcome)> onOutcome;
+
+  // Frames on the air, and the chips listening to them
+  static std::list<std::shared_ptr<const Transmission>> air;
+  static std::vector<Chip *> chips;
+
+  // Register values after a reset, from the datasheet
+  static const uint8_t resetRegisters[0x2F] = {
+      0x29, 0x2E, 0x3F, 0x07, 0xD3, 0x91, 0xFF, 0x04, 0x45, 0x00, 0x00, 0x0F, 0x00, 0x1E, 0xC4, 0xEC,
+      0x8C, 0x22, 0x02, 0x22, 0xF8, 0x47, 0x07, 0x30, 0x04, 0x36, 0x6C, 0x03, 0x40, 0x91, 0x87, 0x6B,
+      0xF8, 0x56, 0x10, 0xA9, 0x0A, 0x20, 0x0D, 0x41, 0x00, 0x59, 0x7F, 0x3F, 0x88, 0x31, 0x0B};
+
+  // MDMCFG1 NUM_PREAMBLE
+  static const uint8_t preambleBytes[8] = {2, 3, 4, 6, 8, 12, 16, 24};
+
+  // Frames overlapping [start, end), other than the given one
+  static bool isOverlapped(const Transmission *tx, Sim::Time start, Sim::Time end)
+  {
+    for (const std::shared_ptr<const Transmission> &other : air)
+      if (other.get() != tx && other->start < end && other->end > start)
+        return true;
+    return false;
+  }
+
+  void send(Transmission frame)
+  {
+    frame.end = frame.start + (frame.preambleBytes + 2 + frame.payload.size()) * 8000000ULL / frame.bitRate;
+    std::shared_ptr<const Transmission> tx = std::make_shared<const Transmission>(frame);
+
+    // Frames which cannot overlap the new ones are forgotten
+    Sim::Time now = Sim::time();
+    while (!air.empty() && air.front()->end + 100000 < now)
+      air.pop_front();
+    air.push_back(tx);
+
+    if (onTransmit)
+      onTransmit(*tx);
+    Sim::schedule(tx->syncEnd(), [tx]() {
+      for (Chip *chip : chips)
+        if (chip != tx->source)
+          chip->onSync(tx);
+    });
+  }
+
+  Chip::Chip(uint8_t ssPin, uint8_t gdo2Pin, uint32_t seed) : m_ssPin(ssPin),
+                                                              m_gdo2Pin(gdo2Pin),
+                                                              m_random(seed),
+                                                              m_isHeaderExpected(true),
+                                                              m_stateGeneration(0),
+                                                              m_rxGeneration(0)
+  {
+    this->reset();
+    chips.push_back(this);
+    Sim::addSpiDevice(ssPin, this);
+  }
+
+  void Chip::reset()
+  {
+    memcpy(this->m_registers, resetRegisters, sizeof(this->m_registers));
+    memset(this->m_paTable, 0, sizeof(this->m_paTable));
+    this->m_paIndex = 0;
+    this->m_rxHead = 0;
+    this->m_rxCount = 0;
+    this->m_txCount = 0;
+    this->m_gdo2 = false;
+    this->m_isEndOfPacket = false;
+    this->setState(State::Idle);
+  }
+
+  //----------------------------------- SPI -----------------------------------
+  void Chip::select()
+  {
+    this->m_isHeaderExpected = true;
+  }
+
+  void Chip::deselect()
+  {
+    this->m_isHeaderExpected = true;
+    this->m_paIndex = 0;
+  }
+
+  uint8_t Chip::transfer(uint8_t data)
+  {
+    uint8_t statusByte = (this->m_state == State::Rx ? 0x10 : this->m_state == State::Tx ? 0x20 : 0x00) |
+                         (this->m_rxCount < 15 ? this->m_rxCount : 15);
+    if (this->m_isHeaderExpected)
+    {
+      this->m_isRead = (data & 0x80) != 0;
+      this->m_isBurst = (data & 0x40) != 0;
+      this->m_address = data & 0x3F;
+      // Status registers share their addresses with the strobes, and are read with the burst bit
+      if (this->m_address >= 0x30 && this->m_address <= 0x3D && !(this->m_isRead && this->m_isBurst))
+        this->strobe(this->m_address);
+      else
+        this->m_isHeaderExpected = false;
+      return statusByte;
+    }
+
+    uint8_t result = 0;
+    if (this->m_address >= 0x30 && this->m_address <= 0x3D)
+      result = this->readStatus(this->m_address);
+    else if (this->m_address == 0x3E)
+    {
+      if (this->m_isRead)
+        result = this->m_paTable[this->m_paIndex];
+      else
+        this->m_paTable[this->m_paIndex] = data;
+      this->m_paIndex = (this->m_paIndex + 1) % sizeof(this->m_paTable);
+    }
+    else if (this->m_address == 0x3F)
+    {
+      if (this->m_isRead)
+      {
+        // Reading an empty FIFO returns the last byte again
+        result = this->m_rxFifo[this->m_rxHead];
+        if (this->m_rxCount != 0)
+        {
+          this->m_rxHead = (this->m_rxHead + 1) % c_fifoSize;
+          this->m_rxCount--;
+          this->updateGdo2();
+        }
+      }
+      else if (this->m_txCount < c_fifoSize)
+        this->m_txFifo[this->m_txCount++] = data;
+    }
+    else if (this->m_address < sizeof(this->m_registers))
+    {
+      if (this->m_isRead)
+        result = this->readRegister(this->m_address);
+      else
+        this->writeRegister(this->m_address, data);
+      if (this->m_isBurst)
+        this->m_address++;
+    }
+
+    if (!this->m_isBurst)
+      this->m_isHeaderExpected = true;
+    return result;
+  }
+
+  uint8_t Chip::readRegister(uint8_t address)
+  {
+    return this->m_registers[address];
+  }
+
+  void Chip::writeRegister(uint8_t address, uint8_t data)
+  {
+    this->m_registers[address] = data;
+  }
+
+  uint8_t Chip::readStatus(uint8_t address)
+  {
+    switch (address)
+    {
+    case 0x30: // PARTNUM
+      return 0x00;
+    case 0x31: // VERSION
+      return 0x14;
+    case 0x33: // LQI
+      return 0x80 | 20;
+    case 0x34: // RSSI
+      return (uint8_t)(((this->isCarrier() ? c_signalDbm : c_noiseDbm) + 74) * 2);
+    case 0x35: // MARCSTATE
+      switch (this->m_state)
+      {
+      case State::Idle:
+        return 0x01;
+      case State::Calibrating:
+        return 0x0C;
+      case State::Rx:
+        return 0x0D;
+      case State::Tx:
+        return 0x13;
+      case State::RxOverflow:
+        return 0x11;
+      }
+      return 0;
+    case 0x38: // PKTSTATUS: CS, CCA, SFD
+      return (this->m_state == State::Rx && this->isCarrier() ? 0x40 : 0) |
+             (this->isChannelClear() ? 0x10 : 0) |
+             (this->m_rx != NULL ? 0x08 : 0);
+    case 0x3A: // TXBYTES
+      return this->m_txCount;
+    case 0x3B: // RXBYTES
+      return (this->m_state == State::RxOverflow ? 0x80 : 0) | this->m_rxCount;
+    default:
+      return 0;
+    }
+  }
+
+  //--------------------------------- States ----------------------------------
+  void Chip::setState(State state)
+  {
+    if (this->m_rx != NULL && state != State::Rx)
+      this->endReception(state == State::RxOverflow ? Outcome::Overflow : Outcome::Aborted);
+    this->m_state = state;
+    this->m_stateGeneration++;
+  }
+
+  void Chip::calibrate(State next)
+  {
+    this->setState(State::Calibrating);
+    uint32_t generation = this->m_stateGeneration;
+    Sim::schedule(Sim::time() + c_calibrationUs, [this, generation, next]() {
+      if (generation != this->m_stateGeneration)
+        return;
+      if (next == State::Tx)
+        this->transmit();
+      else
+        this->setState(next);
+    });
+  }
+
+  void Chip::strobe(uint8_t command)
+  {
+    switch (command)
+    {
+    case 0x30: // SRES
+      this->reset();
+      break;
+    case 0x34: // SRX
+      if (this->m_state == State::Idle)
+        this->calibrate(State::Rx);
+      break;
+    case 0x35: // STX
+      if (this->m_state == State::Idle)
+        this->calibrate(State::Tx);
+      else if (this->m_state == State::Rx && ((this->m_registers[0x17] & 0x30) == 0 || this->isChannelClear()))
+        this->transmit();
+      break;
+    case 0x36: // SIDLE
+      this->setState(State::Idle);
+      break;
+    case 0x3A: // SFRX
+      this->m_rxHead = 0;
+      this->m_rxCount = 0;
+      if (this->m_state == State::RxOverflow)
+        this->setState(State::Idle);
+      this->updateGdo2();
+      break;
+    case 0x3B: // SFTX
+      this->m_txCount = 0;
+      break;
+    }
+  }
+
+  // Fixed packet length: PKTLEN bytes of the TX FIFO are sent, with the configured sync word and data rate
+  void Chip::transmit()
+  {
+    this->setState(State::Tx);
+    Transmission tx;
+    tx.tag = 0;
+    tx.syncWord = this->syncWord();
+    tx.bitRate = this->bitRate();
+    tx.preambleBytes = preambleBytes[(this->m_registers[0x13] >> 4) & 7];
+    uint8_t length = this->m_registers[0x06] < this->m_txCount ? this->m_registers[0x06] : this->m_txCount;
+    tx.payload.assign(this->m_txFifo, this->m_txFifo + length);
+    tx.start = Sim::time();
+    tx.end = 0;
+    tx.source = this;
+    this->m_txCount = 0;
+    send(tx);
+
+    // TXOFF_MODE: RX, or IDLE
+    Sim::Time end = tx.start + (tx.preambleBytes + 2 + length) * 8000000ULL / tx.bitRate;
+    uint32_t generation = this->m_stateGeneration;
+    Sim::schedule(end, [this, generation]() {
+      if (generation == this->m_stateGeneration)
+        this->setState((this->m_registers[0x17] & 0x03) == 3 ? State::Rx : State::Idle);
+    });
+  }
+
+  //-------------------------------- Reception --------------------------------
+  void Chip::onSync(std::shared_ptr<const Transmission> tx)
+  {
+    uint32_t rate = this->bitRate();
+    bool isRateMatching = tx->bitRate * 10 > rate * 9 && tx->bitRate * 9 < rate * 10;
+    if (this->m_state != State::Rx || tx->syncWord != this->syncWord() || !isRateMatching)
+    {
+      if (onOutcome)
+        onOutcome(*tx, Outcome::NotListening);
+      return;
+    }
+    if (this->m_rx != NULL)
+    {
+      if (onOutcome)
+        onOutcome(*tx, Outcome::Busy);
+      return;
+    }
+
+    this->m_rx = tx;
+    this->m_rxLength = this->m_registers[0x06];
+    this->m_isCollided = isOverlapped(tx.get(), tx->start, tx->syncEnd());
+    this->m_isEndOfPacket = false;
+    uint32_t generation = ++this->m_rxGeneration;
+    Sim::schedule(tx->syncEnd() + 8000000ULL / tx->bitRate, [this, generation]() { this->receiveByte(generation, 0); });
+  }
+
+  void Chip::receiveByte(uint32_t generation, uint8_t index)
+  {
+    if (generation != this->m_rxGeneration || this->m_rx == NULL)
+      return;
+
+    const Transmission *tx = this->m_rx.get();
+    uint64_t byteUs = 8000000ULL / tx->bitRate;
+    Sim::Time byteEnd = tx->syncEnd() + (index + 1) * byteUs;
+    // After the end of the frame, the demodulator outputs noise until PKTLEN bytes are received
+    uint8_t data = index < tx->payload.size() ? tx->payload[index] : (uint8_t)this->m_random();
+    if (isOverlapped(tx, byteEnd - byteUs, byteEnd))
+    {
+      data ^= 1 + this->m_random() % 255;
+      this->m_isCollided = true;
+    }
+
+    if (this->m_rxCount == c_fifoSize)
+    {
+      this->setState(State::RxOverflow);
+      return;
+    }
+    this->pushRxByte(data);
+
+    if (index + 1 < this->m_rxLength)
+    {
+      Sim::schedule(byteEnd + byteUs, [this, generation, index]() { this->receiveByte(generation, index + 1); });
+      return;
+    }
+
+    // Appended RSSI and LQI status bytes (PKTCTRL1 APPEND_STATUS)
+    if (this->m_registers[0x07] & 0x04)
+    {
+      this->pushRxByte((uint8_t)((c_signalDbm + 74) * 2));
+      this->pushRxByte(0x80 | 20);
+    }
+    this->m_isEndOfPacket = true;
+    this->updateGdo2();
+    this->endReception(this->m_isCollided ? Outcome::Collided : Outcome::Received);
+    // RXOFF_MODE: stay in RX, or IDLE
+    if ((this->m_registers[0x17] & 0x0C) != 0x0C)
+      this->setState(State::Idle);
+  }
+
+  void Chip::endReception(Outcome outcome)
+  {
+    std::shared_ptr<const Transmission> tx = this->m_rx;
+    this->m_rx = NULL;
+    this->m_rxGeneration++;
+    if (onOutcome)
+      onOutcome(*tx, outcome);
+  }
+
+  void Chip::pushRxByte(uint8_t data)
+  {
+    if (this->m_rxCount == c_fifoSize)
+      return;
+    this->m_rxFifo[(this->m_rxHead + this->m_rxCount) % c_fifoSize] = data;
+    this->m_rxCount++;
+    this->updateGdo2();
+  }
+
+  // IOCFG2 = 0x01: asserted at the RX FIFO threshold or at the end of packet, de-asserted once the FIFO is empty
+  void Chip::updateGdo2()
+  {
+    uint8_t threshold = 4 * ((this->m_registers[0x03] & 0x0F) + 1);
+    bool level = this->m_gdo2;
+    if (this->m_rxCount == 0)
+    {
+      level = false;
+      this->m_isEndOfPacket = false;
+    }
+    else if (this->m_rxCount >= threshold || this->m_isEndOfPacket)
+      level = true;
+    if (level && !this->m_gdo2 && this->m_registers[0x00] == 0x01)
+      Sim::raiseInterrupt(this->m_gdo2Pin);
+    this->m_gdo2 = level;
+  }
+
+  bool Chip::isCarrier()
+  {
+    Sim::Time now = Sim::time();
+    for (const std::shared_ptr<const Transmission> &tx : air)
+      if (tx->source != this && tx->start <= now && now < tx->end)
+        return true;
+    return false;
+  }
+
+  // CCA_MODE 3: clear unless the RSSI is above the threshold or a frame is being received
+  bool Chip::isChannelClear()
+  {
+    return this->m_state == State::Rx && !this->isCarrier() && this->m_rx == NULL;
+  }
+
+  // DRATE_M and DRATE_E of MDMCFG3/MDMCFG4, with a 26 MHz crystal
+  uint32_t Chip::bitRate()
+  {
+    uint32_t mantissa = 256 + this->m_registers[0x11];
+    uint8_t exponent = this->m_registers[0x10] & 0x0F;
+    return (uint32_t)(((uint64_t)mantissa << exponent) * 26000000ULL >> 28);
+  }
+
+} // namespace Mock
@@ -0,0 +1,150 @@
+#ifndef _MOCKCC1101_H
+#define _MOCKCC1101_H
+
+/*---------------------------------------------------------------------------
+ * CC1101 model on the simulated SPI bus, driven by the unmodified firmware driver
+ * Covered: register and burst accesses, the strobes used by the firmware, the RX and TX FIFOs, the IDLE/RX/TX
+ * states with the autocalibration delay, RXOFF/TXOFF modes and CCA (MCSM1), fixed length packets (PKTLEN) with
+ * the appended status bytes (PKTCTRL1), and GDO2 in mode 0x01 (RX FIFO threshold or end of packet).
+ * Frames on the air are Transmissions: the radio locks on a frame whose sync word and data rate match its
+ * configuration if it is in RX state when the sync word ends, and bytes overlapped by another frame are corrupted.
+ */
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Sim.h"
+
+namespace Mock
+{
+
+  class Chip;
+
+  // Bytes of the chip FIFOs
+  const uint8_t c_fifoSize = 64;
+  // Frequency synthesizer calibration when going from IDLE to RX or TX (FS_AUTOCAL = 1)
+  const uint32_t c_calibrationUs = 721;
+  // Signal strength of the frames, and noise floor, as reported by the RSSI status register
+  const int8_t c_signalDbm = -60;
+  const int8_t c_noiseDbm = -100;
+
+  /** Frame on the air */
+  struct Transmission
+  {
+    // Identifies the frame in the statistics of the caller
+    uint32_t tag;
+    uint16_t syncWord;
+    uint32_t bitRate;
+    uint8_t preambleBytes;
+    // Bytes after the sync word
+    std::vector<uint8_t> payload;
+    Sim::Time start;
+    // Set by send()
+    Sim::Time end;
+    // NULL for the frames of the simulated devices
+    const Chip *source;
+
+    Sim::Time syncEnd() const { return this->start + (this->preambleBytes + 2) * 8000000ULL / this->bitRate; };
+  };
+
+  // Fate of a frame at each chip
+  enum class Outcome : uint8_t
+  {
+    // All the bytes reached the RX FIFO, possibly corrupted by another frame (Collided)
+    Received,
+    // Not in RX state, or another sync word or data rate
+    NotListening,
+    // Already receiving another frame
+    Busy,
+    // RX FIFO full, the frame was dropped
+    Overflow,
+    // A strobe left the RX state during the frame
+    Aborted,
+    Collided,
+    Count
+  };
+
+  // Puts a frame on the air at tx.start, which must not be in the past
+  void send(Transmission tx);
+  // Called when a frame is put on the air, including those transmitted by the chips
+  extern std::function<void(const Transmission &tx)> onTransmit;
+  // Called once the fate of a frame at a chip is known
+  extern std::function<void(const Transmission &tx, Outcome outcome)> onOutcome;
+
+  class Chip : public Sim::SpiDevice
+  {
+  public:
+    Chip(uint8_t ssPin, uint8_t gdo2Pin, uint32_t seed);
+
+    void select();
+    uint8_t transfer(uint8_t data);
+    void deselect();
+
+    // Transmission of another source reached the end of its sync word
+    void onSync(std::shared_ptr<const Transmission> tx);
+
+  private:
+    enum class State : uint8_t
+    {
+      Idle,
+      Calibrating,
+      Rx,
+      Tx,
+      RxOverflow
+    };
+
+    void reset();
+    void strobe(uint8_t command);
+    uint8_t readStatus(uint8_t address);
+    uint8_t readRegister(uint8_t address);
+    void writeRegister(uint8_t address, uint8_t data);
+
+    void setState(State state);
+    void calibrate(State next);
+    void transmit();
+    void endReception(Outcome outcome);
+    void receiveByte(uint32_t generation, uint8_t index);
+    void pushRxByte(uint8_t data);
+    void updateGdo2();
+
+    bool isCarrier();
+    bool isChannelClear();
+    uint32_t bitRate();
+    uint16_t syncWord() { return (this->m_registers[0x04] << 8) | this->m_registers[0x05]; };
+
+    uint8_t m_ssPin;
+    uint8_t m_gdo2Pin;
+    std::mt19937 m_random;
+
+    // SPI transaction: waiting for a header, or the data bytes of an access
+    bool m_isHeaderExpected;
+    bool m_isRead;
+    bool m_isBurst;
+    uint8_t m_address;
+
+    uint8_t m_registers[0x2F];
+    uint8_t m_paTable[8];
+    uint8_t m_paIndex;
+    State m_state;
+    // Incremented on each state change, cancels the pending state events
+    uint32_t m_stateGeneration;
+
+    uint8_t m_rxFifo[c_fifoSize];
+    uint8_t m_rxHead;
+    uint8_t m_rxCount;
+    uint8_t m_txFifo[c_fifoSize];
+    uint8_t m_txCount;
+    bool m_gdo2;
+
+    // Frame being received, and its bytes
+    std::shared_ptr<const Transmission> m_rx;
+    uint32_t m_rxGeneration;
+    uint8_t m_rxLength;
+    bool m_isCollided;
+    bool m_isEndOfPacket;
+  };
+
+} // namespace Mock
+
+#endif //_MOCKCC1101_H
@@ -0,0 +1,296 @@
+#include <chrono>
+#include <cmath>
+#include <queue>
+#include <vector>
+#include "Sim.h"
+
+namespace Sim
+{
+
+  typedef std::chrono::steady_clock HostClock;
+
+  struct Event
+  {
+    Time time;
+    uint64_t sequence;
+    std::function<void()> handler;
+  };
+
+  // Events at the same time are processed in the order they were scheduled
+  struct Later
+  {
+    bool operator()(const Event &a, const Event &b) const
+    {
+      return a.time > b.time || (a.time == b.time && a.sequence > b.sequence);
+    }
+  };
+
+  static std::priority_queue<Event, std::vector<Event>, Later> events;
+  static uint64_t eventSequence;
+
+  static Time currentTime;
+  static double timeFraction;
+  static double cpuFactor;
+  static int untimedDepth;
+  static HostClock::time_point hostMark;
+
+  static bool isInterruptEnabled;
+  static bool isInInterrupt;
+  static void (*interruptHandlers[c_maxPins])();
+  static bool isInterruptPending[c_maxPins];
+
+  static SpiDevice *spiDevices[c_maxPins];
+  static SpiDevice *selectedDevice;
+
+  static Time idleSum;
+  static Time interruptSum;
+  static std::mt19937 engine;
+
+  // Host time spent in firmware code since the last call, scaled to the AVR speed
+  static void chargeFirmware()
+  {
+    if (untimedDepth != 0)
+      return;
+    HostClock::time_point host = HostClock::now();
+    double elapsed = std::chrono::duration<double, std::micro>(host - hostMark).count() * cpuFactor + timeFraction;
+    double whole = floor(elapsed);
+    currentTime += (Time)whole;
+    timeFraction = elapsed - whole;
+    hostMark = host;
+  }
+
+  // Firmware code called from the simulator (interrupt handlers) is charged again
+  static void runFirmware(void (*handler)())
+  {
+    int depth = untimedDepth;
+    untimedDepth = 0;
+    hostMark = HostClock::now();
+    handler();
+    chargeFirmware();
+    untimedDepth = depth;
+  }
+
+  static void dispatchInterrupts()
+  {
+    while (isInterruptEnabled && !isInInterrupt)
+    {
+      uint8_t pin = 0;
+      while (pin < c_maxPins && !(isInterruptPending[pin] && interruptHandlers[pin] != NULL))
+        pin++;
+      if (pin == c_maxPins)
+        return;
+
+      // The I bit is cleared on entry and set again by reti
+      isInterruptPending[pin] = false;
+      isInInterrupt = true;
+      isInterruptEnabled = false;
+      Time start = currentTime;
+      runFirmware(interruptHandlers[pin]);
+      interruptSum += currentTime - start;
+      isInterruptEnabled = true;
+      isInInterrupt = false;
+    }
+  }
+
+  static void processEvents(Time until)
+  {
+    while (!events.empty() && events.top().time <= until)
+    {
+      Event event = events.top();
+      events.pop();
+      if (event.time > currentTime)
+        currentTime = event.time;
+      event.handler();
+      dispatchInterrupts();
+    }
+  }
+
+  Untimed::Untimed()
+  {
+    if (untimedDepth++ == 0)
+      chargeFirmware();
+  }
+
+  Untimed::~Untimed()
+  {
+    if (--untimedDepth == 0)
+      hostMark = HostClock::now();
+  }
+
+  void begin(double factor, uint32_t seed)
+  {
+    events = decltype(events)();
+    eventSequence = 0;
+    currentTime = 0;
+    timeFraction = 0;
+    cpuFactor = factor;
+    untimedDepth = 0;
+    isInterruptEnabled = true;
+    isInInterrupt = false;
+    for (uint8_t pin = 0; pin < c_maxPins; pin++)
+    {
+      interruptHandlers[pin] = NULL;
+      isInterruptPending[pin] = false;
+      spiDevices[pin] = NULL;
+    }
+    selectedDevice = NULL;
+    idleSum = 0;
+    interruptSum = 0;
+    engine.seed(seed);
+    hostMark = HostClock::now();
+  }
+
+  Time now()
+  {
+    Untimed untimed;
+    processEvents(currentTime);
+    return currentTime;
+  }
+
+  Time time()
+  {
+    return currentTime;
+  }
+
+  void spend(uint32_t us)
+  {
+    Untimed untimed;
+    Time until = currentTime + us;
+    processEvents(until);
+    // Interrupt handlers run during a delay do not lengthen it
+    if (currentTime < until)
+      currentTime = until;
+  }
+
+  void schedule(Time time, std::function<void()> handler)
+  {
+    events.push({time, eventSequence++, handler});
+  }
+
+  void runLoop(Time until, bool (*pass)())
+  {
+    for (;;)
+    {
+      Time start;
+      Time interruptStart;
+      {
+        Untimed untimed;
+        processEvents(currentTime);
+        if (currentTime >= until)
+          return;
+        start = currentTime;
+        interruptStart = interruptSum;
+      }
+
+      bool isBusy = pass();
+
+      Untimed untimed;
+      // A task signaled by an interrupt handler during the pass runs on the next one
+      if (isBusy || interruptSum != interruptStart)
+        continue;
+      idleSum += currentTime - start;
+      Time next = (currentTime / 1000 + 1) * 1000;
+      if (!events.empty() && events.top().time < next)
+        next = events.top().time > currentTime ? events.top().time : currentTime;
+      if (next > until)
+        next = until;
+      idleSum += next - currentTime;
+      currentTime = next;
+    }
+  }
+
+  void attachInterrupt(uint8_t pin, void (*handler)())
+  {
+    interruptHandlers[pin] = handler;
+  }
+
+  void detachInterrupt(uint8_t pin)
+  {
+    interruptHandlers[pin] = NULL;
+  }
+
+  // The interrupt flag stays set while the interrupt is detached or masked
+  void raiseInterrupt(uint8_t pin)
+  {
+    isInterruptPending[pin] = true;
+  }
+
+  void disableInterrupts()
+  {
+    isInterruptEnabled = false;
+  }
+
+  void enableInterrupts()
+  {
+    Untimed untimed;
+    isInterruptEnabled = true;
+    dispatchInterrupts();
+  }
+
+  bool areInterruptsEnabled()
+  {
+    return isInterruptEnabled;
+  }
+
+  StatusRegister::operator uint8_t() const
+  {
+    return isInterruptEnabled ? 0x80 : 0;
+  }
+
+  StatusRegister &StatusRegister::operator=(uint8_t value)
+  {
+    if (value & 0x80)
+      enableInterrupts();
+    else
+      disableInterrupts();
+    return *this;
+  }
+
+  void addSpiDevice(uint8_t ssPin, SpiDevice *device)
+  {
+    spiDevices[ssPin] = device;
+  }
+
+  void digitalWrite(uint8_t pin, uint8_t value)
+  {
+    if (pin >= c_maxPins || spiDevices[pin] == NULL)
+      return;
+    Untimed untimed;
+    processEvents(currentTime);
+    if (value == 0)
+    {
+      selectedDevice = spiDevices[pin];
+      selectedDevice->select();
+    }
+    else if (selectedDevice == spiDevices[pin])
+    {
+      selectedDevice->deselect();
+      selectedDevice = NULL;
+    }
+  }
+
+  SpiDataRegister &SpiDataRegister::operator=(uint8_t data)
+  {
+    Untimed untimed;
+    processEvents(currentTime);
+    this->m_received = selectedDevice != NULL ? selectedDevice->transfer(data) : 0xFF;
+    spend(c_spiByteUs);
+    return *this;
+  }
+
+  Time idleTime()
+  {
+    return idleSum;
+  }
+
+  Time interruptTime()
+  {
+    return interruptSum;
+  }
+
+  std::mt19937 &randomEngine()
+  {
+    return engine;
+  }
+
+} // namespace Sim
@@ -0,0 +1,98 @@
+#ifndef _SIM_H
+#define _SIM_H
+
+/*---------------------------------------------------------------------------
+ * Host simulator of the gateway board, running the firmware sources unchanged
+ * The simulated time is in microseconds. While firmware code runs, it advances with the host time multiplied
+ * by the CPU factor (the AVR at 16 MHz is much slower than the host), delays and SPI transfers advance it by their
+ * modelled duration, and an idle main loop jumps to the next event.
+ * Events (radio bytes, transmissions) are processed in time order whenever the firmware calls into the simulator.
+ * Interrupts raised while they are masked (I bit of SREG), or while an interrupt handler runs, are latched and run
+ * as soon as they are unmasked, as on the AVR.
+ */
+#include <stdint.h>
+#include <functional>
+#include <random>
+
+namespace Sim
+{
+
+  typedef uint64_t Time;
+
+  // Duration of an SPI byte transfer at F_CPU / 4, including the polling loop
+  const uint32_t c_spiByteUs = 3;
+  // Minimum cost of a millis() or micros() call, so that polling loops always make progress
+  const uint32_t c_clockReadUs = 1;
+  const uint8_t c_maxPins = 20;
+
+  void begin(double cpuFactor, uint32_t seed);
+
+  // Current time, after processing the events which are due
+  Time now();
+  // Current time, without processing the events (device models)
+  Time time();
+  // Busy wait (delays, transfers): the events are processed, interrupts run if they are enabled
+  void spend(uint32_t us);
+  void schedule(Time time, std::function<void()> handler);
+
+  // Run the main loop until the given time. A pass returning false (no task was due) is idle time,
+  // and the time then jumps to the next millisecond or event
+  void runLoop(Time until, bool (*pass)());
+
+  // Interrupt handler of a pin, as attached by enableInterrupt() on the board
+  void attachInterrupt(uint8_t pin, void (*handler)());
+  void detachInterrupt(uint8_t pin);
+  void raiseInterrupt(uint8_t pin);
+  void disableInterrupts();
+  void enableInterrupts();
+  bool areInterruptsEnabled();
+
+  // AVR status register: only the I bit is simulated
+  class StatusRegister
+  {
+  public:
+    operator uint8_t() const;
+    StatusRegister &operator=(uint8_t value);
+  };
+
+  /** Device on the SPI bus, selected by its slave select pin */
+  class SpiDevice
+  {
+  public:
+    virtual void select() = 0;
+    virtual uint8_t transfer(uint8_t data) = 0;
+    virtual void deselect() = 0;
+  };
+
+  void addSpiDevice(uint8_t ssPin, SpiDevice *device);
+  void digitalWrite(uint8_t pin, uint8_t value);
+
+  // SPDR: writing transfers a byte to the selected device, reading returns the byte received
+  class SpiDataRegister
+  {
+  public:
+    operator uint8_t() const { return this->m_received; };
+    SpiDataRegister &operator=(uint8_t data);
+
+  private:
+    uint8_t m_received;
+  };
+
+  /** Simulator code called from the firmware (device models, hooks) is not charged as firmware run time */
+  class Untimed
+  {
+  public:
+    Untimed();
+    ~Untimed();
+  };
+
+  // Simulated time spent idle in the main loop, and in interrupt handlers
+  Time idleTime();
+  Time interruptTime();
+
+  // Random source of the firmware (random()), seeded by begin()
+  std::mt19937 &randomEngine();
+
+} // namespace Sim
+
+#endif //_SIM_H
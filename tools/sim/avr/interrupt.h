@@ -0,0 +1,7 @@
+#ifndef _AVR_INTERRUPT_H
+#define _AVR_INTERRUPT_H
+
+// Interrupt handlers are plain functions, called by the simulation if at all
+#define ISR(vector) extern "C" void vector(void); void vector(void)
+
+#endif //_AVR_INTERRUPT_H
@@ -0,0 +1,6 @@
+#ifndef _AVR_SLEEP_H
+#define _AVR_SLEEP_H
+
+// The firmware does not sleep: the simulated main loop jumps to the next event when idle
+
+#endif //_AVR_SLEEP_H
@@ -0,0 +1,2 @@
+// The driver includes its header in lower case, which only works on case insensitive file systems
+#include "CC1101.h"
@@ -0,0 +1,222 @@
+/*---------------------------------------------------------------------------
+ * Host benchmark and stress test of the firmware timer wheel (firmware/TimerWheel.cpp)
+ * The wheel runs unchanged on the simulated millis() clock (sim/).
+ *   benchmark  host cost of start (insert), stop (cancel) and of the expiry of running timers, per timer, for
+ *              several numbers of running timers. start includes a millis() call, whose cost is printed apart
+ *   stress     lights with auto-off timers, randomly retriggered, stopped or left to expire while the wheel is
+ *              updated every ms as the timer task does. Checks that no timer fires early, late by more than a tick,
+ *              or after it was stopped, that every due timer fires, and the running timer count
+ *
+ * Build: g++ -O2 -Isim -I../firmware -o timerbench timerbench.cpp sim/Sim.cpp sim/Arduino.cpp
+ *        ../firmware/TimerWheel.cpp
+ * Usage: timerbench [lights] [stress seconds] [seed]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Arduino.h"
+#include "TimerWheel.h"
+
+using Timer::Monostable;
+using Timer::c_tickMs;
+using Timer::wheel;
+
+// A timer fires at most one tick after its due time, plus the update period of the stress test
+static const uint32_t c_maxLateMs = c_tickMs + 1;
+// Auto-off durations of the stress test lights, up to several wheel revolutions
+static const uint32_t c_maxDurationMs = 300000;
+
+static std::mt19937 engine;
+static unsigned errorCount;
+
+template <typename F>
+static double nsPer(F f, size_t count)
+{
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / count;
+}
+
+//-------------------------------- Benchmark --------------------------------
+static unsigned expiredCount;
+
+static void onBenchExpired(Monostable *, void *)
+{
+  expiredCount++;
+}
+
+static void benchmark(size_t count)
+{
+  std::vector<Monostable> timers(count, Monostable(onBenchExpired, NULL));
+  std::uniform_int_distribution<uint32_t> duration(1, 10 * Timer::c_wheelSlots * c_tickMs);
+
+  volatile unsigned long sink = 0;
+  double clockNs = nsPer([&] {
+    for (size_t i = 0; i < count; i++)
+      sink += millis();
+  }, count);
+
+  std::vector<uint32_t> durations(count);
+  for (size_t i = 0; i < count; i++)
+    durations[i] = duration(engine);
+  double startNs = nsPer([&] {
+    for (size_t i = 0; i < count; i++)
+      timers[i].start(durations[i]);
+  }, count);
+
+  // Retrigger: unlink from one slot, link into another
+  double restartNs = nsPer([&] {
+    for (size_t i = 0; i < count; i++)
+      timers[i].start(durations[count - 1 - i]);
+  }, count);
+
+  double stopNs = nsPer([&] {
+    for (size_t i = 0; i < count; i++)
+      timers[i].stop();
+  }, count);
+
+  // Run all the timers to expiry: every tick visits the timers of its slot, including those of later revolutions
+  for (size_t i = 0; i < count; i++)
+    timers[i].start(durations[i]);
+  expiredCount = 0;
+  double expireNs = nsPer([&] {
+    while (wheel.runningCount() != 0)
+    {
+      delay(c_tickMs);
+      wheel.update();
+    }
+  }, count);
+  if (expiredCount != count)
+  {
+    printf("benchmark: %u of %zu timers expired\n", expiredCount, count);
+    errorCount++;
+  }
+
+  printf("%8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", count, clockNs, startNs, restartNs, stopNs,
+         expireNs);
+}
+
+//--------------------------------- Stress ----------------------------------
+struct Light
+{
+  Monostable timer;
+  bool isOn;
+  uint32_t offTime;
+};
+
+static std::vector<Light> lights;
+static unsigned firedCount;
+
+static void onOffTimer(Monostable *, void *context)
+{
+  Light *light = (Light *)context;
+  uint32_t now = millis();
+  firedCount++;
+  if (!light->isOn)
+  {
+    printf("stress: light %zu fired while off\n", light - lights.data());
+    errorCount++;
+  }
+  else if ((int32_t)(now - light->offTime) < 0 || now - light->offTime > c_maxLateMs)
+  {
+    printf("stress: light %zu fired at %u ms, due at %u ms\n", light - lights.data(), now, light->offTime);
+    errorCount++;
+  }
+  light->isOn = false;
+}
+
+static void stress(size_t count, uint32_t seconds)
+{
+  lights.resize(count);
+  for (Light &light : lights)
+  {
+    light.timer.setCallback(onOffTimer, &light);
+    light.isOn = false;
+  }
+
+  std::uniform_int_distribution<size_t> pick(0, count - 1);
+  std::uniform_int_distribution<uint32_t> duration(0, c_maxDurationMs);
+  // On average, each light is switched every minute
+  std::poisson_distribution<unsigned> actions(count / 60000.0);
+  unsigned startCount = 0;
+  unsigned stopCount = 0;
+  uint16_t maxRunning = 0;
+
+  uint32_t end = millis() + seconds * 1000;
+  while ((int32_t)(millis() - end) < 0)
+  {
+    for (unsigned n = actions(engine); n != 0; n--)
+    {
+      Light *light = &lights[pick(engine)];
+      // A third of the presses turn the light off, the others (re)start its timer
+      if (engine() % 3 == 0)
+      {
+        light->timer.stop();
+        light->isOn = false;
+        stopCount++;
+      }
+      else
+      {
+        uint32_t ms = duration(engine);
+        light->offTime = millis() + ms;
+        light->isOn = true;
+        light->timer.start(ms);
+        startCount++;
+      }
+    }
+    delay(1);
+    wheel.update();
+
+    uint16_t running = 0;
+    for (const Light &light : lights)
+      running += light.isOn;
+    if (running != wheel.runningCount())
+    {
+      printf("stress: %u lights on, %u timers running\n", running, wheel.runningCount());
+      errorCount++;
+      return;
+    }
+    if (running > maxRunning)
+      maxRunning = running;
+  }
+
+  // Every light still on must go off by its due time
+  for (uint32_t ms = 0; ms < c_maxDurationMs + c_maxLateMs; ms++)
+  {
+    delay(1);
+    wheel.update();
+  }
+  for (const Light &light : lights)
+    if (light.isOn)
+    {
+      printf("stress: light %zu never went off\n", &light - lights.data());
+      errorCount++;
+    }
+  printf("stress: %zu lights, %u s, %u starts, %u stops, %u expired, up to %u running\n", count, seconds, startCount,
+         stopCount, firedCount, maxRunning);
+}
+
+int main(int argc, char **argv)
+{
+  size_t lightCount = argc > 1 ? strtoul(argv[1], NULL, 0) : 5000;
+  uint32_t seconds = argc > 2 ? strtoul(argv[2], NULL, 0) : 3600;
+  uint32_t seed = argc > 3 ? strtoul(argv[3], NULL, 0) : 1;
+  engine.seed(seed);
+
+  // No firmware time is charged for the host time: the clock only moves with delay() and millis()
+  Sim::begin(0, seed);
+  printf("%8s %10s %10s %10s %10s %10s (ns per timer)\n", "timers", "millis", "start", "restart", "stop", "expire");
+  for (size_t count : {100, 1000, 10000, 60000})
+    benchmark(count);
+
+  stress(lightCount, seconds);
+  if (errorCount != 0)
+  {
+    printf("%u errors\n", errorCount);
+    return 1;
+  }
+  return 0;
+}